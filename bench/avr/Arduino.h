@@ -0,0 +1,34 @@
+#ifndef BENCH_AVR_ARDUINO_H
+#define BENCH_AVR_ARDUINO_H
+
+/**
+ * \file bench/avr/Arduino.h
+ * \author Matteo Ragni
+ *
+ * **Minimal Arduino core for the AVR benchmarks**
+ *
+ * The benchmarks run on a bare ATmega2560 under simavr, without the Arduino
+ * core (that would add the timer 0 interrupt of \p micros, and its jitter, to each
+ * measure). This header gives to the firmware modules under benchmark only
+ * the few symbols they use, on top of \p avr-libc.
+ *
+ * \warning This file is never compiled by the Arduino IDE.
+ */
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+typedef uint8_t byte;  /**< Arduino byte type */
+typedef bool boolean;  /**< Arduino boolean type */
+
+#define DEC 10 /**< Decimal base */
+
+inline void noInterrupts() { cli(); } /**< Disables the interrupts */
+inline void interrupts() { sei(); }   /**< Enables the interrupts */
+
+#endif /* BENCH_AVR_ARDUINO_H */
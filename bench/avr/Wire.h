@@ -0,0 +1,45 @@
+#ifndef BENCH_AVR_WIRE_H
+#define BENCH_AVR_WIRE_H
+
+/**
+ * \file bench/avr/Wire.h
+ * \author Matteo Ragni
+ *
+ * **Wire stand-in for the AVR benchmarks**
+ *
+ * \p communication_t::send runs inside the i2c interrupt of the Wire library.
+ * The benchmark measures the packing of the telemetry, thus \p write only copies
+ * the data in a buffer, as the Wire library does before the transmission.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/** \brief Wire stand-in for the AVR benchmarks (slave side only) */
+class TwoWire {
+  uint8_t tx[32]; /**< Transmission buffer */
+
+ public:
+  void begin(uint8_t) {}              /**< Joins the bus (nothing to do) */
+  void onReceive(void (*)(int)) {}    /**< Receive callback (never called) */
+  void onRequest(void (*)(void)) {}   /**< Request callback (never called) */
+  int available() { return 0; }       /**< Nothing to read */
+  int read() { return -1; }           /**< Nothing to read */
+  /**
+   * \brief Copies the data in the transmission buffer
+   * \param data the buffer
+   * \param size the buffer size
+   * \return the number of bytes written
+   */
+  size_t write(const uint8_t* data, size_t size) {
+    if (size > sizeof(tx))
+      size = sizeof(tx);
+    memcpy(tx, data, size);
+    return size;
+  }
+};
+
+extern TwoWire Wire;
+
+#endif /* BENCH_AVR_WIRE_H */
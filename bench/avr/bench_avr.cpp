@@ -0,0 +1,330 @@
+/**
+ * \file bench/avr/bench_avr.cpp
+ * \author Matteo Ragni
+ *
+ * **Cycle accurate benchmarks of the hot kernels on ATmega2560**
+ *
+ * The program is built with \p avr-g++ for the ATmega2560 (the same flags of the
+ * Arduino toolchain) and runs under \p simavr, that simulates the core
+ * cycle by cycle. Each kernel is executed \p BENCH_CALLS times on a fixed
+ * sequence of inputs, and its duration is measured with timer 1 running at
+ * the cpu clock (prescaler 1): the counts are exact cycles, and the simulation is
+ * deterministic, thus two runs of the same binary give the same numbers.
+ *
+ * The overhead of the measure (write and read of \p TCNT1) is calibrated
+ * with an empty kernel and subtracted. The inputs are read from \p volatile
+ * variables and the outputs are written in a \p volatile sink, thus the
+ * compiler cannot fold the kernel in a constant.
+ *
+ * The results are printed on the simavr console (register \p GPIOR0), one
+ * line per kernel:
+ *
+ * @code
+ * B <kernel> <calls> <min cycles> <mean cycles> <max cycles>
+ * @endcode
+ *
+ * The line \p E marks the end of the suite. The script \p check.sh prints the
+ * lines (target \p bench_avr_run), records them in \p bench/avr/baseline.txt
+ * (\p bench_avr_record), or compares them with that baseline (\p bench_avr_check).
+ *
+ * \note No baseline is stored in the repository, and no cycle count of this
+ * suite has been recorded yet: \p bench_avr_check is generated only after a
+ * baseline has been recorded with simavr.
+ *
+ * \warning This file is never compiled by the Arduino IDE (the bench
+ * folder is not part of the sketch).
+ */
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <avr/sleep.h>
+#include <simavr/avr/avr_mcu_section.h>
+
+#include "configurations.hpp"
+#include "types.hpp"
+
+#include "controller_t.hpp"
+#include "cyclic_array_t.hpp"
+#include "high_gain_obs_t.ino"
+#include "kalman_obs_t.ino"
+#include "lookup_table_t.ino"
+#include "communication_t.ino"
+#include "controller_t.ino"
+#include "ticker_t.ino"
+
+AVR_MCU(F_CPU, "atmega2560");
+AVR_MCU_SIMAVR_CONSOLE(&GPIOR0);
+
+#define BENCH_CALLS 64 /**< Calls of each kernel */
+
+TwoWire Wire;
+
+/** \brief Gains of the benchmarked observers (order 3, as if \p HG_L3 were -1.0) */
+struct bench_gains_t {
+  static constexpr size_t order = 3;                                   /**< Number of gains */
+  static constexpr double epsilon() { return HG_EPSILON; }             /**< High gain value */
+  static constexpr double l(const size_t i) { return (i == 0) ? HG_L1 : ((i == 1) ? HG_L2 : -1.0); } /**< Gains */
+};
+
+void* operator new(size_t size) { return malloc(size); }
+
+/** \brief Stand-in for \p erumby_t, with constant telemetry */
+class bench_erumby_t : public erumby_base_t {
+ public:
+  erumby_mode_t mode() { return Auto; }
+  float omega_r() { return 41.27; }
+  float omega_l() { return 39.81; }
+  float omega() { return 40.54; }
+  float variance_r() { return 0.149; }
+  float variance_l() { return 0.149; }
+  const cmd_t traction() const { return DUTY_ESC_IDLE + 512; }
+  void traction(cmd_t) {}
+  void speed(float) {}
+  void tune() {}
+  tune_state_t tuning() { return TuneIdle; }
+  const cmd_t steer() const { return DUTY_SERVO_MIDDLE; }
+  void steer(cmd_t) {}
+  void stop() {}
+  void alarm(const char*) {}
+  void alarm(const char*, const char*) {}
+};
+
+/** \brief Cycle statistics of a kernel */
+typedef struct stats_t {
+  uint16_t min;  /**< Minimum cycles */
+  uint16_t max;  /**< Maximum cycles */
+  uint32_t sum;  /**< Sum of the cycles */
+} stats_t;
+
+static uint16_t overhead = 0;        /**< Cycles of an empty measure */
+volatile float sink_f;               /**< Sink for float results */
+volatile cmd_t sink_c;               /**< Sink for integer results */
+volatile float input_f[BENCH_CALLS]; /**< Float inputs of the kernels */
+volatile q15_t::raw_t input_q15[BENCH_CALLS]; /**< Q15 inputs of the kernels */
+volatile q31_t::raw_t input_q31[BENCH_CALLS]; /**< Q31 inputs of the kernels */
+volatile q31_t::raw_t sink_q;        /**< Sink for fixed point results */
+float input_pair[BENCH_CALLS][2];    /**< Float inputs of the two channel observers (left and right wheel) */
+
+/** \brief Starts a measure: clears timer 1 */
+#define TIC() \
+  do {        \
+    TCNT1 = 0; \
+  } while (0)
+
+/** \brief Ends a measure and accumulates the cycles in \p s */
+#define TOC(s)                                   \
+  do {                                           \
+    uint16_t c_ = TCNT1 - overhead;              \
+    if (c_ < (s).min) (s).min = c_;              \
+    if (c_ > (s).max) (s).max = c_;              \
+    (s).sum += c_;                               \
+  } while (0)
+
+/** \brief Measures \p BENCH_CALLS calls of \p body, with input \p input_f[i] */
+#define BENCH(name, body)                        \
+  do {                                           \
+    stats_t s_ = {0xFFFF, 0, 0};                 \
+    for (uint8_t i = 0; i < BENCH_CALLS; i++) {  \
+      TIC();                                     \
+      body;                                      \
+      TOC(s_);                                   \
+    }                                            \
+    report(name, s_);                            \
+  } while (0)
+
+/** \brief Prints a string on the simavr console */
+static void print(const char* str) {
+  while (*str)
+    GPIOR0 = *str++;
+}
+
+/** \brief Prints an unsigned number on the simavr console */
+static void print(uint32_t n) {
+  char buf[11];
+  ultoa(n, buf, 10);
+  print(buf);
+}
+
+/** \brief Prints the line of a kernel */
+static void report(const char* name, const stats_t& s) {
+  print("B ");
+  print(name);
+  print(" ");
+  print(uint32_t(BENCH_CALLS));
+  print(" ");
+  print(uint32_t(s.min));
+  print(" ");
+  print((s.sum + BENCH_CALLS / 2) / BENCH_CALLS);
+  print(" ");
+  print(uint32_t(s.max));
+  print("\n");
+}
+
+/** \brief Inputs for the observers: the angle of a wheel accelerating
+ *
+ * The fixed point inputs are wrapped in a revolution, as in \p encoder_t.
+ */
+static void inputs_angle() {
+  const float q = 2 * M_PI / ENCODER_QUANTIZATION;
+  uint16_t ticks = 0;
+  for (uint8_t i = 0; i < BENCH_CALLS; i++) {
+    ticks += i / 4;
+    input_f[i] = q * ticks;
+    input_pair[i][0] = q * ticks;
+    input_pair[i][1] = q * (ticks - i / 8);
+    input_q15[i] = q15_t::from_float(q * (ticks % ENCODER_QUANTIZATION), HG_FIXED_THETA);
+    input_q31[i] = q31_t::from_float(q * (ticks % ENCODER_QUANTIZATION), HG_FIXED_THETA);
+  }
+}
+
+/** \brief One step of a two channel observer
+ * \param obs the observer
+ * \param i index of the inputs in \p input_pair
+ * \return the speed of the second channel
+ */
+template < typename O >
+static float step_pair(O& obs, const uint8_t i) {
+  float w[2];
+  obs(input_pair[i], w);
+  return w[1];
+}
+
+/** \brief Inputs for the controller and the maps: a ramp in [0, 1] (also in Q15, as a control) */
+static void inputs_ramp() {
+  for (uint8_t i = 0; i < BENCH_CALLS; i++) {
+    input_f[i] = float(i) / (BENCH_CALLS - 1);
+    input_q15[i] = q15_t::from_float(input_f[i], CTRL_FIXED_U);
+  }
+}
+
+int main() {
+  cli();
+  TCCR1A = 0;
+  TCCR1B = _BV(CS10);  // Normal mode, prescaler 1: one count per cycle
+
+  // Calibration of the measure (empty kernel)
+  {
+    stats_t s = {0xFFFF, 0, 0};
+    for (uint8_t i = 0; i < BENCH_CALLS; i++) {
+      TIC();
+      TOC(s);
+    }
+    overhead = s.min;
+  }
+
+  // High gain observers
+  inputs_angle();
+  {
+    high_gain_obs_t< 2, ENCODER_TIMING, float, bench_gains_t > hg2;
+    BENCH("high_gain_obs_t<2>::operator()", sink_f = hg2(input_f[i]));
+  }
+  {
+    high_gain_obs_t< 3, ENCODER_TIMING, float, bench_gains_t > hg3;
+    BENCH("high_gain_obs_t<3>::operator()", sink_f = hg3(input_f[i]));
+  }
+  {
+    high_gain_obs_t< 2, ENCODER_TIMING, q15_t, bench_gains_t > hg2;
+    BENCH("high_gain_obs_t<2,q15>::step", sink_q = hg2.step(input_q15[i]));
+  }
+  {
+    high_gain_obs_t< 2, ENCODER_TIMING, q31_t, bench_gains_t > hg2;
+    BENCH("high_gain_obs_t<2,q31>::step", sink_q = hg2.step(input_q31[i]));
+  }
+  {
+    high_gain_obs_t< 3, ENCODER_TIMING, q15_t, bench_gains_t > hg3;
+    BENCH("high_gain_obs_t<3,q15>::step", sink_q = hg3.step(input_q15[i]));
+  }
+  {
+    high_gain_obs_t< 3, ENCODER_TIMING, q31_t, bench_gains_t > hg3;
+    BENCH("high_gain_obs_t<3,q31>::step", sink_q = hg3.step(input_q31[i]));
+  }
+  {
+    kalman_obs_t< ENCODER_TIMING > kf;
+    BENCH("kalman_obs_t::operator()", sink_f = kf(input_f[i]));
+  }
+  {
+    high_gain_obs_t< 2, ENCODER_TIMING, float, bench_gains_t, 2 > hgp;
+    BENCH("high_gain_obs_t<2,C=2>::operator()", sink_f = step_pair(hgp, i));
+  }
+  {
+    kalman_obs_t< ENCODER_TIMING, 2 > kfp;
+    BENCH("kalman_obs_t<C=2>::operator()", sink_f = step_pair(kfp, i));
+  }
+
+  // Controller and its non linearity
+  inputs_ramp();
+  {
+    BENCH("controller_t::phi", sink_f = controller_t< float >::phi(input_f[i]));
+  }
+  {
+    // The analytic phi, that CTRL_NONLIN_LUT replaces with the table
+    BENCH("phi (sqrt)", sink_f = (sqrt((CTRL_NONLIN_A * CTRL_NONLIN_A) + (4 * CTRL_NONLIN_B) * input_f[i]) -
+                                  CTRL_NONLIN_A) / (2 * CTRL_NONLIN_B));
+  }
+  {
+    BENCH("lookup_table_t<phi>::eval", sink_f = (lookup_table_t< float, 257, ctrl_phi_t >::eval(input_f[i])));
+  }
+  {
+    BENCH("controller_t::phi_inv", sink_f = controller_t< float >::phi_inv(200 * input_f[i]));
+  }
+  {
+    controller_t< float > ctrl;
+    BENCH("controller_t::operator()", sink_f = ctrl(100 * input_f[i], 95 * input_f[i]));
+  }
+  {
+    controller_t< q15_t > ctrl;
+    BENCH("controller_t<q15>::phi", sink_q = ctrl.phi(input_q15[i]));
+  }
+  {
+    controller_t< q15_t > ctrl;
+    BENCH("controller_t<q15>::operator()", sink_f = ctrl(100 * input_f[i], 95 * input_f[i]));
+  }
+  {
+    controller_t< q31_t > ctrl;
+    BENCH("controller_t<q31>::operator()", sink_f = ctrl(100 * input_f[i], 95 * input_f[i]));
+  }
+
+  // Lookup tables (ESC map in float, radio map in integers)
+  {
+    const float x[] = {0.0, 1.0};
+    const float y[] = {float(DUTY_ESC_IDLE), float(DUTY_ESC_MAX)};
+    lookup_table_t< float, 2 > map(x, y);
+    BENCH("lookup_table_t<float,2>::eval", sink_f = map.eval(input_f[i]));
+  }
+  {
+    // Same shape of the radio motor map (REMOTE_MOTOR_LUT_X, disabled by REMOTE_NOT_WORKING)
+    cmd_t x[] = {1000, 1340, 2032};
+    cmd_t y[] = {DUTY_ESC_IDLE, DUTY_ESC_IDLE, DUTY_ESC_MAX};
+    lookup_table_t< cmd_t, 3 > map(x, y);
+    BENCH("lookup_table_t<cmd_t,3>::eval", sink_c = map.eval(980 + (i << 4)));
+  }
+
+  // Delay line of the Smith predictor
+  {
+    time_delay_t< CTRL_TIMING, CTRL_SYSTEM_DELAY > delay(0);
+    BENCH("cyclic_array_t::push_back", delay.push_back(input_f[i]));
+    sink_f = delay.back();
+  }
+  {
+    // A tick of the Smith predictor: delayed and predicted output, then the new one
+    time_delay_t< CTRL_TIMING, CTRL_SYSTEM_DELAY > delay(0);
+    BENCH("cyclic_array_t<20> tick", sink_f = delay.front() - delay.back(); delay.push_back(input_f[i]));
+  }
+  {
+    cyclic_array_t< float, 16 > delay(0);
+    BENCH("cyclic_array_t<16> tick", sink_f = delay.front() - delay.back(); delay.push_back(input_f[i]));
+  }
+
+  // Telemetry
+  {
+    bench_erumby_t m;
+    communication_t* comms = communication_t::create_comms(&m);
+    comms->loop_secure();
+    BENCH("communication_t::send", comms->send());
+  }
+
+  print("E\n");
+  sleep_enable();
+  sleep_cpu();  // Interrupts are disabled: simavr stops the simulation
+  return 0;
+}
@@ -0,0 +1,72 @@
+#!/bin/sh
+#
+# Runs the AVR benchmarks under simavr and compares them with the baseline.
+#
+# Usage: check.sh <simavr> <bench_avr.elf> <baseline.txt> [run|record]
+#
+# Each line of the suite is "B <kernel> <calls> <min> <mean> <max>" (cycles).
+# A kernel fails if its mean or its max is more than BENCH_TOLERANCE percent
+# (default 2) above the baseline. A kernel without baseline is reported but
+# does not fail. With "run" the suite is only printed, with "record" the
+# baseline is overwritten with the current run. The repository does not store
+# a baseline: without one the check is not a regression gate, and fails.
+
+SIMAVR="$1"
+ELF="$2"
+BASELINE="$3"
+MODE="$4"
+TOLERANCE="${BENCH_TOLERANCE:-2}"
+
+if [ -z "$SIMAVR" ] || [ -z "$ELF" ] || [ -z "$BASELINE" ]; then
+  echo "usage: $0 <simavr> <bench_avr.elf> <baseline.txt> [run|record]" >&2
+  exit 2
+fi
+
+RUN=$(mktemp)
+trap 'rm -f "$RUN"' EXIT
+
+# The simavr console lines are prefixed by the simulator (the prefix depends
+# on the simavr version): only the benchmark lines are kept.
+"$SIMAVR" -m atmega2560 -f 16000000 "$ELF" 2>&1 | sed -n \
+  -e 's/.*\(B [^ ]* [0-9]* [0-9]* [0-9]* [0-9]*\).*/\1/p' \
+  -e 's/^E$/E/p' -e 's/.*[^A-Za-z0-9]E$/E/p' > "$RUN"
+
+if ! grep -q '^E$' "$RUN"; then
+  echo "bench_avr: the suite did not complete under simavr" >&2
+  exit 1
+fi
+grep '^B ' "$RUN" > "$RUN.b" && mv "$RUN.b" "$RUN"
+
+if [ "$MODE" = "run" ]; then
+  cat "$RUN"
+  exit 0
+fi
+
+if [ "$MODE" = "record" ]; then
+  cp "$RUN" "$BASELINE"
+  echo "bench_avr: baseline recorded in $BASELINE"
+  cat "$BASELINE"
+  exit 0
+fi
+
+if [ ! -f "$BASELINE" ]; then
+  echo "bench_avr: no baseline in $BASELINE, nothing to compare (record one with the bench_avr_record target)" >&2
+  cat "$RUN"
+  exit 1
+fi
+
+awk -v tol="$TOLERANCE" '
+  NR == FNR { mean[$2] = $5; max[$2] = $6; next }
+  {
+    status = "ok"
+    if (!($2 in mean)) {
+      status = "new"
+    } else if ($5 > mean[$2] * (1 + tol / 100) || $6 > max[$2] * (1 + tol / 100)) {
+      status = "SLOWER"
+      failed = 1
+    }
+    printf "%-32s mean %6d (%6s) max %6d (%6s) %s\n", $2, $5, \
+      ($2 in mean) ? mean[$2] : "-", $6, ($2 in max) ? max[$2] : "-", status
+  }
+  END { exit failed }
+' "$BASELINE" "$RUN"
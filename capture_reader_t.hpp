@@ -0,0 +1,133 @@
+#ifndef CAPTURE_READER_T_HPP
+#define CAPTURE_READER_T_HPP
+
+/**
+ * \file capture_reader_t.hpp
+ * \author Matteo Ragni
+ *
+ * **Encoder edges through the input capture units of timers 4 and 5**
+ *
+ * The pin change path of \p pwm_reader_t timestamps an edge with \p micros
+ * inside the interrupt routine: the timestamp has the resolution of \p micros
+ * (4 us) and it is delayed by the latency of the routine (that depends
+ * on the other interrupts, and on the walk of the readers on the port). The input
+ * capture unit copies the counter of the timer in \p ICRn in hardware, on the
+ * edge: the routine only reads the copy, thus the timestamp has the resolution
+ * of the timer (0.5 us) and no latency jitter.
+ *
+ * The ATmega2560 has two free timers with the capture pin on the Arduino Mega
+ * header (timer 1 is used by the ESC and the servo, and timer 3 by \p ticker_t):
+ *
+ * | Pin | Timer | Capture input  | Vectors                                  |
+ * |-----|-------|----------------|------------------------------------------|
+ * | 49  | 4     | `ICP4` (`PL0`) | `TIMER4_CAPT_vect`, `TIMER4_OVF_vect`    |
+ * | 48  | 5     | `ICP5` (`PL1`) | `TIMER5_CAPT_vect`, `TIMER5_OVF_vect`    |
+ *
+ * The timers run freely in normal mode with prescaler 8, with the noise canceler
+ * enabled. The capture unit sees only one edge polarity: after each capture
+ * the routine flips the edge (\p ICESn), thus both edges are counted, as in the
+ * pin change path. The overflows of the timer extend the timestamp to 32 bit.
+ *
+ * The class has the same interface of \p pwm_reader_t used by \p encoder_t
+ * (counter of edges, last edge), and it is selected by
+ * the define \p ENCODER_INPUT_CAPTURE (the class is compiled only if it is defined).
+ *
+ * \warning The encoders must be wired on pins 48 and 49. The timers 4 and 5
+ * cannot be used for PWM outputs.
+ */
+
+#include <Arduino.h>
+#include "configurations.hpp"
+#include "pwm_reader_t.hpp"
+#include "types.hpp"
+
+#define CAPTURE_TICKS_PER_MS (F_CPU / 8000L) /**< Counts of the timers in a ms (prescaler 8) */
+
+/** \brief Encoder edges through the input capture units
+ *
+ * The timestamps are in counts of the timer (\p CAPTURE_TICKS_PER_MS).
+ * The timer is selected at compile time by the pin, thus the registers
+ * are accessed directly, and any pin but 48 and 49 does not compile.
+ *
+ * Usage example:
+ * @code
+ * capture_reader_t< 49 > enc;  // timer 4
+ *
+ * void real_time_loop() {
+ *   edge_stamp_t last = enc.last_edge();
+ *   ticks_t n = enc.take_counter();
+ * }
+ * @endcode
+ *
+ * \warning Only one reader for each pin.
+ * \tparam PIN the pin of the encoder (48 or 49)
+ */
+template < pin_t PIN >
+class capture_reader_t {
+  static_assert((PIN == 48) || (PIN == 49), "capture_reader_t: only pins 48 (timer 5) and 49 (timer 4) have an input capture unit");
+  static const bool timer4 = (PIN == 49); /**< The pin is the capture input of timer 4 (else timer 5) */
+
+  volatile ticks_t counter;   /**< free running counter of the edges */
+  ticks_t taken;              /**< value of \p counter at the last take (loop only) */
+  seqlock_t< edge_stamp_t > stamp; /**< count and timestamp of the last edge */
+
+ public:
+  static capture_reader_t* self;       /**< Reader of the pin. Never manually edit this value. */
+  static volatile uint16_t overflows;  /**< High word of the timestamps. Never manually edit this value. */
+
+  /** \brief Constructor for the input capture reader
+   *
+   * Configures the timer of the pin, and registers the reader
+   * for the capture routine of the timer.
+   */
+  capture_reader_t();
+
+  capture_reader_t(const capture_reader_t&) = delete;            /**< Not copyable (registered by address) */
+  capture_reader_t& operator=(const capture_reader_t&) = delete; /**< Not copyable (registered by address) */
+
+  /**
+   * \brief Get current counter value
+   * \return the number of edges since the last reset (or take)
+   */
+  inline const ticks_t get_counter() const { return read_counter(counter) - taken; }
+  /** \brief Resets the counter to 0 (the edges not yet taken are discarded) */
+  inline void reset_counter() { taken = read_counter(counter); }
+  /** \brief Takes the edges since the last take (or reset)
+   *
+   * The interrupt routine increments a free running counter, that is never
+   * written by the loop: the edges landing between two calls are counted by
+   * the next call, none is lost. The counter has 16 bit, and the difference is
+   * modular: it is exact up to 65535 edges between two takes.
+   *
+   * \return the number of edges since the last take (or reset)
+   */
+  inline const ticks_t take_counter() {
+    ticks_t c = read_counter(counter);
+    ticks_t n = c - taken;
+    taken = c;
+    return n;
+  }
+
+  /**
+   * \brief Current time, in the time base of the timestamps
+   * \return the current count of the timer, extended to 32 bit
+   */
+  timing_t now() const;
+
+  /** \brief Count and timestamp of the last edge (see \p pwm_reader_base_t::last_edge)
+   *
+   * \return the last edge (a count of 0 and time 0 if there are no edges)
+   */
+  inline const edge_stamp_t last_edge() const { return stamp.read(); }
+
+  /** \brief Capture routine
+   *
+   * \warning Never use directly this function.
+   *
+   * \param icr the captured count
+   * \param tov \p true if an overflow is pending (not yet counted)
+   */
+  static void capture_isr(const uint16_t icr, const bool tov);
+};
+
+#endif /* CAPTURE_READER_T_HPP */
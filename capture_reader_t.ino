@@ -0,0 +1,91 @@
+#include "capture_reader_t.hpp"
+
+#ifdef ENCODER_INPUT_CAPTURE
+
+// capture_reader_t - C++ implementation
+
+template < pin_t PIN >
+capture_reader_t< PIN >* capture_reader_t< PIN >::self = NULL;
+template < pin_t PIN >
+volatile uint16_t capture_reader_t< PIN >::overflows = 0;
+
+template < pin_t PIN >
+capture_reader_t< PIN >::capture_reader_t() : counter(0), taken(0), stamp() {
+  noInterrupts();
+  pinMode(PIN, INPUT_PULLUP);
+  // The first edge is the opposite of the current level
+  uint8_t edge = digitalRead(PIN) ? 0 : 1;
+  self = this;
+  if (timer4) {
+    TCCR4A = 0;
+    TCCR4B = _BV(ICNC4) | (edge << ICES4) | _BV(CS41);  // normal mode, prescaler 8
+    TCNT4 = 0;
+    TIFR4 = _BV(ICF4) | _BV(TOV4);
+    TIMSK4 = _BV(ICIE4) | _BV(TOIE4);
+  } else {
+    TCCR5A = 0;
+    TCCR5B = _BV(ICNC5) | (edge << ICES5) | _BV(CS51);  // normal mode, prescaler 8
+    TCNT5 = 0;
+    TIFR5 = _BV(ICF5) | _BV(TOV5);
+    TIMSK5 = _BV(ICIE5) | _BV(TOIE5);
+  }
+  interrupts();
+}
+
+template < pin_t PIN >
+timing_t capture_reader_t< PIN >::now() const {
+  uint16_t lo;
+  bool tov;
+  noInterrupts();
+  if (timer4) {
+    lo = TCNT4;
+    tov = TIFR4 & _BV(TOV4);
+  } else {
+    lo = TCNT5;
+    tov = TIFR5 & _BV(TOV5);
+  }
+  uint16_t hi = overflows;
+  interrupts();
+  if (tov && (lo < 0x8000))
+    hi++;
+  return (timing_t(hi) << 16) | lo;
+}
+
+template < pin_t PIN >
+void capture_reader_t< PIN >::capture_isr(const uint16_t icr, const bool tov) {
+  uint16_t hi = overflows;
+  // The overflow routine has a lower priority: an overflow before the
+  // capture may be still pending
+  if (tov && (icr < 0x8000))
+    hi++;
+  timing_t t = (timing_t(hi) << 16) | icr;
+  isr_guard_t guard;  // the counter is read-modify-write
+  ticks_t c = self->counter + 1;
+  self->counter = c;
+  self->stamp.write(edge_stamp_t{c, t});
+}
+
+ISR(TIMER4_CAPT_vect) {
+  uint16_t icr = ICR4;
+  TCCR4B ^= _BV(ICES4);  // next edge has the opposite polarity
+  TIFR4 = _BV(ICF4);     // changing the edge may raise a capture
+  capture_reader_t< 49 >::capture_isr(icr, TIFR4 & _BV(TOV4));
+}
+
+ISR(TIMER4_OVF_vect) { capture_reader_t< 49 >::overflows++; }
+
+ISR(TIMER5_CAPT_vect) {
+  uint16_t icr = ICR5;
+  TCCR5B ^= _BV(ICES5);  // next edge has the opposite polarity
+  TIFR5 = _BV(ICF5);     // changing the edge may raise a capture
+  capture_reader_t< 48 >::capture_isr(icr, TIFR5 & _BV(TOV5));
+}
+
+ISR(TIMER5_OVF_vect) { capture_reader_t< 48 >::overflows++; }
+
+// The readers of the two input capture pins, also for the users outside of
+// this translation unit (the host checks)
+template class capture_reader_t< 49 >;
+template class capture_reader_t< 48 >;
+
+#endif
@@ -23,7 +23,9 @@
  * | `traction`        | Value for wheel speed if positive, value for ESC pwm if negative |
  *
  * The `traction` value, if positive sends the required wheel speed for the closed loop
- * controller, while the negative value sends directly a value to the ESC.
+ * controller, while the negative value sends directly a value to the ESC. The value
+ * \p TUNE_COMMAND starts the identification of the speed controller (\p erumby_t::tune),
+ * that runs while the value is kept.
  *
  * \warning The reference in wheel speed is:
  * \f[\omega_{ref} = \frac{\mathrm{traction}}{100}\;(rad/s)\f]
@@ -32,11 +34,28 @@
  *
  * The current structure for the **output data**:
  *
- * | \p outdata_t field | Description                    |
- * |--------------------|--------------------------------|
- * | `omega_rr`         | Speed of the right wheel       |
- * | `omega_rl`         | Speed of the left wheel        |
- * | `input_esc`        | Current PWM written on the ESC |
+ * | \p outdata_t field | Description                                             |
+ * |--------------------|---------------------------------------------------------|
+ * | `omega_rr`         | Speed of the right wheel                                |
+ * | `omega_rl`         | Speed of the left wheel                                 |
+ * | `input_esc`        | Current PWM written on the ESC                          |
+ * | `missed`           | Iterations of the loop that missed the deadline         |
+ * | `lateness`         | Worst lateness of the loop start (us, saturated)        |
+ * | `var_rr`           | Variance of the speed of the right wheel                |
+ * | `var_rl`           | Variance of the speed of the left wheel                 |
+ * | `status`           | Identification state and flags (see below)              |
+ *
+ * The last five fields are appended at the end of the packet: a master that reads
+ * only the first 6 bytes is not affected. The counters are saturated at 0xFFFF.
+ * In degraded mode (see \p ticker_t) the wheel speeds and their variances are not updated,
+ * and `status` has the bit \p TELEMETRY_STALE set: the master must not use them as new
+ * measures. The low byte of `status` is the state of the identification of the speed
+ * controller (\p tune_state_t).
+ * The variances are in the square of the unit of the speeds, \f$\mathrm{round}(10^4 \sigma^2)\f$
+ * ((0.01 rad/s)\f$^2\f$), saturated: 0xFFFF if the variance is not estimated
+ * (see \p encoder_t::get_variance).
+ * The wheel speeds are signed (16 bit, two's complement, saturated): they are
+ * negative when the wheels turn backward (see \p ENCODER_DIRECTION).
  *
  * \warning The speed sent out is in the form:
  * \f{align}
@@ -48,8 +67,12 @@
 #include <Arduino.h>
 #include <Wire.h>
 #include "configurations.hpp"
+#include "isr_shared_t.hpp"
+#include "ticker_t.hpp"
 #include "types.hpp"
 
+#define TELEMETRY_STALE 0x0100 /**< Bit of `status`: the wheel speeds and variances are old (degraded mode) */
+
 /** \brief Class for the i2c communications in the vehicle
  *
  * The class implements the communication bus between the Raspberry PI
@@ -70,7 +93,9 @@
  * | `traction`        | Value for wheel speed if positive, value for ESC pwm if negative |
  *
  * The `traction` value, if positive sends the required wheel speed for the closed loop
- * controller, while the negative value sends directly a value to the ESC.
+ * controller, while the negative value sends directly a value to the ESC. The value
+ * \p TUNE_COMMAND starts the identification of the speed controller (\p erumby_t::tune),
+ * that runs while the value is kept.
  *
  * \warning The reference in wheel speed is:
  * \f[\omega_{ref} = \frac{\mathrm{traction}}{100}\;(rad/s)\f]
@@ -79,11 +104,28 @@
  *
  * The current structure for the **output data**:
  *
- * | \p outdata_t field | Description                    |
- * |--------------------|--------------------------------|
- * | `omega_rr`         | Speed of the right wheel       |
- * | `omega_rl`         | Speed of the left wheel        |
- * | `input_esc`        | Current PWM written on the ESC |
+ * | \p outdata_t field | Description                                             |
+ * |--------------------|---------------------------------------------------------|
+ * | `omega_rr`         | Speed of the right wheel                                |
+ * | `omega_rl`         | Speed of the left wheel                                 |
+ * | `input_esc`        | Current PWM written on the ESC                          |
+ * | `missed`           | Iterations of the loop that missed the deadline         |
+ * | `lateness`         | Worst lateness of the loop start (us, saturated)        |
+ * | `var_rr`           | Variance of the speed of the right wheel                |
+ * | `var_rl`           | Variance of the speed of the left wheel                 |
+ * | `status`           | Identification state and flags (see below)              |
+ *
+ * The last five fields are appended at the end of the packet: a master that reads
+ * only the first 6 bytes is not affected. The counters are saturated at 0xFFFF.
+ * In degraded mode (see \p ticker_t) the wheel speeds and their variances are not updated,
+ * and `status` has the bit \p TELEMETRY_STALE set: the master must not use them as new
+ * measures. The low byte of `status` is the state of the identification of the speed
+ * controller (\p tune_state_t).
+ * The variances are in the square of the unit of the speeds, \f$\mathrm{round}(10^4 \sigma^2)\f$
+ * ((0.01 rad/s)\f$^2\f$), saturated: 0xFFFF if the variance is not estimated
+ * (see \p encoder_t::get_variance).
+ * The wheel speeds are signed (16 bit, two's complement, saturated): they are
+ * negative when the wheels turn backward (see \p ENCODER_DIRECTION).
  *
  * \warning The speed sent out is in the form:
  * \f{align}
@@ -95,15 +137,24 @@
  * is opposite with respect to the one of the Raspberry PI, we have to swap LSB and MSB.
  * This is done in the receiving callback for the \p Wire library.
  *
+ * The callbacks of the \p Wire library run in the i2c interrupt: the input
+ * data are shared with the loop through a \p seqlock_t, and the output data
+ * through a \p double_buffer_t, thus neither side ever sees a half written packet.
+ *
  * \warning The class is implemented as a **Singleton**, since there can be only one
  * user of the i2c communication bus.
  */
 class communication_t {
   /** \brief Output data structure */
   typedef struct outdata_t {
-    output_t omega_rr;  /**< Rear right wheel angular speed: \f$\mathrm{round}\left( 100 \omega_{right} \right)\f$ */
-    output_t omega_rl;  /**< Rear right wheel angular speed: \f$\mathrm{round}\left( 100 \omega_{left} \right)\f$ */
+    omega_t omega_rr;   /**< Rear right wheel angular speed: \f$\mathrm{round}\left( 100 \omega_{right} \right)\f$ */
+    omega_t omega_rl;   /**< Rear right wheel angular speed: \f$\mathrm{round}\left( 100 \omega_{left} \right)\f$ */
     output_t input_esc; /**< Current PWM value on the ESC */
+    output_t missed;    /**< Missed deadlines of the real time loop (saturated) */
+    output_t lateness;  /**< Worst lateness of the real time loop in us (saturated) */
+    output_t var_rr;    /**< Variance of the rear right wheel speed: \f$\mathrm{round}\left( 10^4 \sigma^2_{right} \right)\f$ */
+    output_t var_rl;    /**< Variance of the rear left wheel speed: \f$\mathrm{round}\left( 10^4 \sigma^2_{left} \right)\f$ */
+    output_t status;    /**< State of the identification (\p tune_state_t, low byte) and \p TELEMETRY_STALE */
   } outdata_t;
 
   /** \brief Input data structure */
@@ -113,8 +164,8 @@ class communication_t {
   } indata_t;
 
   static communication_t* self;   /**< The single instance for i2c communication */
-  indata_t indata;                /**< Instance of the input structure */
-  outdata_t outdata;              /**< Instance of the output structure */
+  seqlock_t< indata_t > indata;      /**< Instance of the input structure (written in the i2c interrupt) */
+  double_buffer_t< outdata_t > outdata; /**< Instance of the output structure (read in the i2c interrupt) */
   byte input[sizeof(indata_t)];   /**< Input stream */
   byte output[sizeof(outdata_t)]; /**< Output stream */
   erumby_base_t* m;               /**< Pointer to the erumby main class instance */
@@ -154,6 +205,43 @@ class communication_t {
   /** \brief Loop to run in \p erumby_t::loop_auto */
   void loop_auto();
 
+ private:
+  /** \brief Packs the telemetry in the output structure
+   *
+   * The wheel speeds are not packed in degraded mode (\p DEGRADE_TELEMETRY),
+   * and the status marks them as stale (\p TELEMETRY_STALE), while the
+   * counters of the real time loop are always updated.
+   */
+  void pack();
+
+  /**
+   * \brief Converts a wheel speed for the telemetry
+   * \param omega the wheel speed (rad/s)
+   * \return \f$\mathrm{round}(100 \omega)\f$, saturated on 16 bit
+   */
+  static omega_t pack_omega(const float omega) {
+    float w = round(omega * 100);
+    if (w > 32767.0)
+      return 32767;
+    if (w < -32767.0)
+      return -32767;
+    return omega_t(w);
+  }
+
+  /**
+   * \brief Converts a variance of a wheel speed for the telemetry
+   * \param variance the variance of the wheel speed ((rad/s)\f$^2\f$, infinity if not estimated)
+   * \return \f$\mathrm{round}(10^4 \sigma^2)\f$, saturated at 0xFFFF
+   */
+  static output_t pack_variance(const float variance) {
+    float v = round(variance * 10000);
+    if (!(v < 65535.0))
+      return 0xFFFF;
+    return output_t(v);
+  }
+
+ public:
+
   /**
    * \brief Callback to run for receiving data from Wire library
    * \param size size of the message (in bytes)
@@ -167,13 +255,13 @@ class communication_t {
    * \brief Gets the last received traction value
    * \return the last received traction value
    */
-  cmd_t traction() { return indata.traction; }
+  cmd_t traction() { return indata.read().traction; }
 
   /** 
    * \brief Gets the last received steering value
    * \return the last receiving steering value
    */
-  cmd_t steer() { return indata.steering; }
+  cmd_t steer() { return indata.read().steering; }
 };
 
 #endif /* COMMUNICATIONS_T_HPP */
\ No newline at end of file
@@ -14,52 +14,82 @@ const communication_t * communication_t::get_comms() {
 }
 
 communication_t::communication_t(erumby_base_t * m_) : m(m_) {
-  indata.steering = DUTY_SERVO_MIDDLE;
-  indata.traction = DUTY_ESC_IDLE;
+  indata_t in;
+  in.steering = DUTY_SERVO_MIDDLE;
+  in.traction = DUTY_ESC_IDLE;
+  indata.write(in);
   Wire.begin(I2C_ADDR);
-  Wire.onRequest([]() -> void { communication_t::get_comms()->send(); });
-  Wire.onReceive([](int s) -> void { communication_t::get_comms()->receive(s); });
+  Wire.onRequest([]() -> void { const_cast< communication_t* >(communication_t::get_comms())->send(); });
+  Wire.onReceive([](int s) -> void { const_cast< communication_t* >(communication_t::get_comms())->receive(s); });
+}
+
+void communication_t::pack() {
+  outdata_t& out = outdata.back();
+  bool stale = ticker_t::degraded(DEGRADE_TELEMETRY);
+  if (!stale) {
+    out.omega_rr = pack_omega(m->omega_r());
+    out.omega_rl = pack_omega(m->omega_l());
+    out.var_rr = pack_variance(m->variance_r());
+    out.var_rl = pack_variance(m->variance_l());
+  }
+  out.input_esc = m->traction();
+  out.status = output_t(m->tuning()) | (stale ? TELEMETRY_STALE : 0);
+  out.missed = ticker_t::get_missed() > 0xFFFF ? 0xFFFF : ticker_t::get_missed();
+  out.lateness = ticker_t::get_jitter_max() > 0xFFFF ? 0xFFFF : ticker_t::get_jitter_max();
+  outdata.publish();
 }
 
 void communication_t::loop_secure() {
-  outdata.omega_rr = round(m->omega_r() * 100);
-  outdata.omega_rl = round(m->omega_l() * 100);
-  outdata.input_esc = m->traction();
+  pack();
 }
 
 void communication_t::loop_auto() {
-  outdata.omega_rr = round(m->omega_r() * 100);
-  outdata.omega_rl = round(m->omega_l() * 100);
-  outdata.input_esc = m->traction();
+  pack();
 
-  if (indata.traction > 0) {
-    m->speed(float(indata.traction) / 100.0);
+  indata_t in = indata.read();
+  if (in.traction == TUNE_COMMAND) {
+    m->tune();
+  } else if (in.traction > 0) {
+    m->speed(float(in.traction) / 100.0);
   } else {
-    m->traction(-indata.traction);
+    m->traction(-in.traction);
   }
-  m->steer(indata.steering);
+  m->steer(in.steering);
 }
 
-void communication_t::receive(int size) {        
+void communication_t::receive(int) {        
+  indata_t in = indata.peek();
   while (1 < Wire.available()) { 
     input[0] = Wire.read();
     input[1] = Wire.read();
     input[2] = Wire.read();
-    indata.traction = input[0];
-    indata.traction = indata.traction << 8 | input[1];
+    in.traction = input[0];
+    in.traction = in.traction << 8 | input[1];
   }
   input[3] = Wire.read();
 
-  indata.steering = input[2];
-  indata.steering = indata.steering << 8 | input[3]; 
+  in.steering = input[2];
+  in.steering = in.steering << 8 | input[3]; 
+  indata.write(in);
 }
 
 void communication_t::send() {
-  output[0] = (outdata.omega_rr >> 8) & 0xFF;
-  output[1] = outdata.omega_rr & 0xFF;
-  output[2] = (outdata.omega_rl >> 8) & 0xFF;
-  output[3] = outdata.omega_rl & 0xFF;
-  output[4] = (outdata.input_esc >> 8) & 0xFF;
-  output[5] = outdata.input_esc & 0xFF;
+  const outdata_t& out = outdata.front();
+  output[0] = (out.omega_rr >> 8) & 0xFF;
+  output[1] = out.omega_rr & 0xFF;
+  output[2] = (out.omega_rl >> 8) & 0xFF;
+  output[3] = out.omega_rl & 0xFF;
+  output[4] = (out.input_esc >> 8) & 0xFF;
+  output[5] = out.input_esc & 0xFF;
+  output[6] = (out.missed >> 8) & 0xFF;
+  output[7] = out.missed & 0xFF;
+  output[8] = (out.lateness >> 8) & 0xFF;
+  output[9] = out.lateness & 0xFF;
+  output[10] = (out.var_rr >> 8) & 0xFF;
+  output[11] = out.var_rr & 0xFF;
+  output[12] = (out.var_rl >> 8) & 0xFF;
+  output[13] = out.var_rl & 0xFF;
+  output[14] = (out.status >> 8) & 0xFF;
+  output[15] = out.status & 0xFF;
   Wire.write(output, sizeof(outdata_t)); 
 }
\ No newline at end of file
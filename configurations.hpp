@@ -15,6 +15,36 @@
  */
 #define I2C_ADDR 0x03
 
+/**
+ * \def ENCODER_INPUT_CAPTURE
+ *
+ * If defined, the encoders are read through the input capture units of
+ * timers 4 and 5 (\p capture_reader_t), that timestamp the edges in hardware.
+ * The encoders must be wired on pins 49 (left, \p ICP4) and 48 (right, \p ICP5).
+ * If not defined, the encoders are read through the pin change interrupts of
+ * port B (\p pwm_reader_t), on pins 53 and 52.
+ */
+// #define ENCODER_INPUT_CAPTURE
+
+#ifdef ENCODER_INPUT_CAPTURE
+/**
+ * \def L_WHEEL_ENCODER
+ *
+ * Defines the pin on the board where the left encoder is attached.
+ * This pin is the input capture pin of timer 4 (PL0).
+ * This pin is use in the class \p capture_reader_t.
+ */
+#define L_WHEEL_ENCODER 49
+
+/**
+ * \def R_WHEEL_ENCODER
+ *
+ * Defines the pin on the board where the right encoder is attached.
+ * This pin is the input capture pin of timer 5 (PL1).
+ * This pin is use in the class \p capture_reader_t.
+ */
+#define R_WHEEL_ENCODER 48
+#else
 /**
  * \def L_WHEEL_ENCODER
  *
@@ -34,6 +64,7 @@
  * This pin is use in the class \p pwm_reader_t.
  */
 #define R_WHEEL_ENCODER 52
+#endif
 
 /**
  * \def ENCODER_QUANTIZATION
@@ -44,6 +75,90 @@
  */
 #define ENCODER_QUANTIZATION 100
 
+/**
+ * \def ENCODER_EDGE_TIMEOUT
+ *
+ * Time without edges (in ms) after which the speed from the edge periods
+ * (\p encoder_t::get_omega_edge) is zero. It sets the minimum speed that
+ * can be measured: \f$ \pi / (\mathrm{ENCODER\_QUANTIZATION} \, t) \f$.
+ */
+#define ENCODER_EDGE_TIMEOUT 100
+
+#define ENCODER_DIRECTION_NONE 0       /**< The wheels always turn forward */
+#define ENCODER_DIRECTION_ESC 1        /**< Direction inferred from the ESC command */
+#define ENCODER_DIRECTION_QUADRATURE 2 /**< Direction from a second (quadrature) channel */
+
+/**
+ * \def ENCODER_DIRECTION
+ *
+ * Source of the direction of the wheels (the sign of the angle and of the
+ * speed of \p encoder_t):
+ *
+ * | Value                          | Direction                                              |
+ * |--------------------------------|--------------------------------------------------------|
+ * | `ENCODER_DIRECTION_NONE`       | always forward (single channel encoders)               |
+ * | `ENCODER_DIRECTION_ESC`        | sign of the ESC command, latched when the wheel stops  |
+ * | `ENCODER_DIRECTION_QUADRATURE` | level of the second channel on each edge of the first  |
+ *
+ * With the ESC the direction changes only after the wheel has been still for
+ * \p ENCODER_EDGE_TIMEOUT (the ESC brakes before reversing, and the wheel keeps
+ * its direction while braking). The quadrature channel needs the pin change
+ * path (\p ENCODER_INPUT_CAPTURE must not be defined).
+ */
+#define ENCODER_DIRECTION ENCODER_DIRECTION_ESC
+
+#if ENCODER_DIRECTION == ENCODER_DIRECTION_QUADRATURE
+#ifdef ENCODER_INPUT_CAPTURE
+#error "The quadrature encoders are read only through the pin change interrupts"
+#endif
+/**
+ * \def L_WHEEL_ENCODER_B
+ *
+ * Defines the pin of the second channel of the left encoder. It must be on
+ * the port of \p L_WHEEL_ENCODER (port B, PB2). The channel is read in the
+ * interrupt routine of the first channel, and it has no interrupt.
+ */
+#define L_WHEEL_ENCODER_B 51
+
+/**
+ * \def R_WHEEL_ENCODER_B
+ *
+ * Defines the pin of the second channel of the right encoder. It must be on
+ * the port of \p R_WHEEL_ENCODER (port B, PB3). The channel is read in the
+ * interrupt routine of the first channel, and it has no interrupt.
+ */
+#define R_WHEEL_ENCODER_B 50
+#endif
+
+#define ENCODER_SPEED_HG 0    /**< Speed from the high gain observer on the counted angle (M method) */
+#define ENCODER_SPEED_MT_HG 1 /**< Speed from the high gain observer on the angle interpolated with the edge timing */
+#define ENCODER_SPEED_MT 2    /**< Speed from the edge counts and timing (M/T method), no observer */
+#define ENCODER_SPEED_KF 3    /**< Speed from the steady state Kalman filter on the counted angle */
+
+/**
+ * \def ENCODER_SPEED
+ *
+ * Estimator of the wheel speed of \p encoder_t::get_omega (the feedback of
+ * the controller):
+ *
+ * | Value                 | Estimator                                                          |
+ * |-----------------------|--------------------------------------------------------------------|
+ * | `ENCODER_SPEED_HG`    | high gain observer on the edges counted in each tick               |
+ * | `ENCODER_SPEED_MT_HG` | high gain observer on the angle interpolated between the edges     |
+ * | `ENCODER_SPEED_MT`    | edges in the tick over the time between the last edges (M/T)       |
+ * | `ENCODER_SPEED_KF`    | steady state Kalman filter on the edges counted in each tick       |
+ *
+ * The count in a tick is very coarse at low speed (one edge every few ticks),
+ * while the M/T estimation measures the time of the edges, and it is exact
+ * at a constant speed. The interpolated angle is the angle of the last edge, plus
+ * the M/T speed times the time since the edge (at most one edge): the observer
+ * filters the noise of the M/T speed at high speed, without the quantization
+ * of the count at low speed. The Kalman filter (\p kalman_obs_t) replaces the
+ * high gain observer, and gives also the variance of the speed (see
+ * \p KF_PROCESS_NOISE and \p KF_MEASUREMENT_NOISE), sent in the telemetry.
+ */
+#define ENCODER_SPEED ENCODER_SPEED_HG
+
 /**
  * \def STEERING
  *
@@ -219,6 +334,101 @@
  */
 #define LOOP_TIMING 4
 
+/**
+ * \def ENCODER_PERIOD
+ *
+ * Period (in base ticks of \p LOOP_TIMING) of the rate group of the encoders
+ * (\p encoder_pair_t::loop). The high gain observer is discretized at compile time
+ * with the period of the group (\p ENCODER_TIMING).
+ */
+#define ENCODER_PERIOD 1
+
+/**
+ * \def CONTROL_PERIOD
+ *
+ * Period (in base ticks of \p LOOP_TIMING) of the rate group of the control:
+ * i2c communication (\p communication_t), speed controller (\p controller_t) and ESC
+ * (\p esc_t). The controller is discretized at compile time with the period of the
+ * group (\p CTRL_TIMING).
+ */
+#define CONTROL_PERIOD 1
+
+/**
+ * \def RADIO_PERIOD
+ *
+ * Period (in base ticks of \p LOOP_TIMING) of the rate group of the radio
+ * (\p radio_t). The receiver sends a frame every 20 ms, thus there is no
+ * reason to read the mode faster than that.
+ */
+#define RADIO_PERIOD 5
+
+/**
+ * \def SERVO_PERIOD
+ *
+ * Period (in base ticks of \p LOOP_TIMING) of the rate group of the servo
+ * (\p servo_t). The servo PWM runs at \p PWM_FREQUENCY (71 Hz, 14 ms), thus
+ * writing it faster than that has no effect.
+ */
+#define SERVO_PERIOD 4
+
+/**
+ * \def OVERRUN_DEGRADE
+ *
+ * Number of consecutive iterations of the real time loop that miss the deadline
+ * (overruns) before entering the degraded mode (see \p ticker_t).
+ */
+#define OVERRUN_DEGRADE 3
+
+/**
+ * \def OVERRUN_RECOVER
+ *
+ * Number of consecutive iterations on time before leaving the degraded mode.
+ */
+#define OVERRUN_RECOVER 250
+
+/**
+ * \def OVERRUN_ACTIONS
+ *
+ * Actions skipped in degraded mode, as a mask of \p DEGRADE_TELEMETRY (the wheel
+ * speeds are not packed for the i2c) and \p DEGRADE_PROFILER (the profiler does not
+ * print its report). Set to 0 for counting the overruns without degrading.
+ */
+#define OVERRUN_ACTIONS (DEGRADE_TELEMETRY | DEGRADE_PROFILER)
+
+/**
+ * \def PROFILER
+ *
+ * Enables the per stage profiler of the real time loop (\p profiler_t). The
+ * statistics of each task of the scheduler are printed on the Serial. The
+ * profiler reads the timer around each task and prints every
+ * \p PROFILER_PERIOD, thus it is not in the firmware of the car: uncomment the
+ * define for profiling on the bench. The host build defines it (see
+ * \p CMakeLists.txt).
+ */
+// #define PROFILER
+
+/**
+ * \def PROFILER_PERIOD
+ *
+ * Period (in base ticks of \p LOOP_TIMING) of the profiler report task. Each
+ * run prints the statistics of a single stage.
+ */
+#define PROFILER_PERIOD 25
+
+/**
+ * \def ENCODER_TIMING
+ *
+ * Discretization time (in ms) of the encoders rate group.
+ */
+#define ENCODER_TIMING (LOOP_TIMING * ENCODER_PERIOD)
+
+/**
+ * \def CTRL_TIMING
+ *
+ * Discretization time (in ms) of the control rate group.
+ */
+#define CTRL_TIMING (LOOP_TIMING * CONTROL_PERIOD)
+
 /**
  * \def SERIAL_SPEED
  *
@@ -366,6 +576,20 @@
  */
 #define CTRL_SYSTEM_DELAY 80
 
+/**
+ * \def CTRL_SYSTEM_DELAY_MAX
+ *
+ * Longest delay of the mechanical system (ms) that the speed controller can
+ * hold: the delay installed at runtime (see \p tuner_t) is in
+ * \f$[t_s, \mathrm{CTRL\_SYSTEM\_DELAY\_MAX}]\f$. The identification on the car
+ * measures also the lag of the speed observer (about 170 ms with the nominal
+ * system). It must be a multiple of \p CTRL_TIMING: the delay line of the Smith
+ * predictor takes one value for each step of the controller, thus its size in
+ * SRAM is \p CTRL_SYSTEM_DELAY_MAX / \p CTRL_TIMING values (50 floats, 200 bytes,
+ * with the float controller).
+ */
+#define CTRL_SYSTEM_DELAY_MAX 200
+
 /**
  * \def CTRL_KP
  *
@@ -410,6 +634,134 @@
  */
 #define CTRL_NONLIN_B 1.532e-05
 
+/**
+ * \def CTRL_NONLIN_LUT
+ *
+ * Breakpoints of the table of the non linearity \f$ \phi \f$ in the float
+ * controller (\p controller_t): the compiler builds the table in the flash
+ * from \p CTRL_NONLIN_A and \p CTRL_NONLIN_B, and the controller interpolates
+ * it instead of evaluating a square root and a division. The table takes
+ * \f$ 8 (B - 1) \f$ bytes of flash. Comment the define for the analytic \f$ \phi \f$.
+ *
+ * \warning The saving of cycles of the table is not measured yet: the AVR
+ * benchmarks (\p bench/avr, \p controller_t::phi against
+ * \p lookup_table_t<phi>::eval) have not been run under simavr. The error bound
+ * is checked (\p CTRL_NONLIN_LUT_ERROR), the speed up is only expected.
+ */
+#define CTRL_NONLIN_LUT 257
+
+/**
+ * \def CTRL_NONLIN_LUT_ERROR
+ *
+ * Maximum error of the table of \f$ \phi \f$ (rad/s) on \f$ [0, 1] \f$: the
+ * compiler checks the bound of the interpolation error of the table with
+ * \p CTRL_NONLIN_LUT breakpoints. The error is largest in the first segment,
+ * where the curvature of \f$ \phi \f$ is the largest (it scales as \f$ 1 / B^2 \f$).
+ */
+#define CTRL_NONLIN_LUT_ERROR 0.05
+
+/**
+ * \def CTRL_TYPE
+ *
+ * Arithmetic of the speed controller (the template parameter of \p controller_t):
+ *
+ * | Value   | Arithmetic                                              |
+ * |---------|---------------------------------------------------------|
+ * | `float` | software floating point (reference)                     |
+ * | `q15_t` | 16 bit fixed point, products in 32 bit (fastest)        |
+ * | `q31_t` | 32 bit fixed point, products in 64 bit (float accuracy) |
+ *
+ * The fixed point controllers represent the signals normalized to the full
+ * scales \p CTRL_FIXED_OMEGA, \p CTRL_FIXED_U and \p CTRL_FIXED_GAIN, and
+ * they saturate at the bounds. The host tool \p ctrl_compare closes the loop
+ * on the plant model and compares them with the float controller.
+ */
+#define CTRL_TYPE float
+
+/**
+ * \def CTRL_FIXED_OMEGA
+ *
+ * Full scale of the speeds in the fixed point controller, as an exponent of
+ * two: reference, measure and prediction are in \f$ [-2^9, 2^9) \f$ rad/s
+ * (the model saturates at \f$ \phi(1) \approx 220 \f$ rad/s). It is also the full
+ * scale of the integral of the error (in rad).
+ */
+#define CTRL_FIXED_OMEGA 9
+
+/**
+ * \def CTRL_FIXED_U
+ *
+ * Full scale of the control in the fixed point controller, as an exponent of
+ * two: the control is in \f$ [-2, 2) \f$ (the ESC saturates it in \f$ [0, 1] \f$).
+ */
+#define CTRL_FIXED_U 1
+
+/**
+ * \def CTRL_FIXED_GAIN
+ *
+ * Full scale of the gains of the PI in the fixed point controller, as an
+ * exponent of two: \p CTRL_KP and \p CTRL_KI are in \f$ [0, 2^{-4}) \f$.
+ */
+#define CTRL_FIXED_GAIN -4
+
+/**
+ * \def TUNE_COMMAND
+ *
+ * Value of `traction` on the i2c that starts the identification of the speed
+ * controller (\p tuner_t) in \p Auto. It is not a valid PWM for the ESC.
+ */
+#define TUNE_COMMAND -32768
+
+/**
+ * \def TUNE_U_LOW
+ *
+ * Lower control of the steps of the identification (\p tuner_t), in \f$ (0, 1) \f$.
+ */
+#define TUNE_U_LOW 0.2
+
+/**
+ * \def TUNE_U_HIGH
+ *
+ * Upper control of the steps of the identification (\p tuner_t), in \f$ (0, 1) \f$.
+ */
+#define TUNE_U_HIGH 0.6
+
+/**
+ * \def TUNE_SETTLE
+ *
+ * Duration of each step of the identification (ms): the speed must reach the
+ * steady state (at least five times the time constant of the system and its delay).
+ */
+#define TUNE_SETTLE 3000
+
+/**
+ * \def TUNE_AVERAGE
+ *
+ * Window at the end of a step of the identification (ms) on which the speed is
+ * averaged, for the static non linearity.
+ */
+#define TUNE_AVERAGE 400
+
+/**
+ * \def TUNE_LAMBDA
+ *
+ * Required time constant of the closed loop (ms) for the gains of the PI after
+ * the identification (lambda tuning, see \p tuner_t). Shorter values give faster
+ * gains, but keep it above the delay of the system: the Smith predictor
+ * compensates the delay only as well as it is identified.
+ */
+#define TUNE_LAMBDA 150
+
+/**
+ * \def TUNE_GAIN_RANGE
+ *
+ * The gains of the PI after the identification (\p tuner_t) must be within this
+ * factor of the nominal ones (\p CTRL_KP, \p CTRL_KI), otherwise the
+ * identification fails: a gain close to zero (or huge) comes from a degenerate
+ * experiment, not from a different motor.
+ */
+#define TUNE_GAIN_RANGE 10
+
 /**
  * \def HG_L1
  *
@@ -429,7 +781,7 @@
  *
  * Define observer parameter for state 3 in the \p high_gain_obs_t
  * If this parameter is not defined, the code will compile the stack
- * with an high gain observer of order 2.
+ * with an high gain observer of order 2 (see \p hg_gains_t::order).
  */
 //#define HG_L3 -1.0
 
@@ -440,11 +792,78 @@
  */
 #define HG_EPSILON 0.1
 
+/**
+ * \def HG_TYPE
+ *
+ * Arithmetic of the high gain observers of the encoders (the template
+ * parameter of \p high_gain_obs_t):
+ *
+ * | Value   | Arithmetic                                              |
+ * |---------|---------------------------------------------------------|
+ * | `float` | software floating point (reference)                     |
+ * | `q15_t` | 16 bit fixed point, products in 32 bit (fastest)        |
+ * | `q31_t` | 32 bit fixed point, products in 64 bit (float accuracy) |
+ *
+ * The fixed point observers represent the states normalized to the full
+ * scales \p HG_FIXED_THETA, \p HG_FIXED_OMEGA and \p HG_FIXED_ALPHA, and
+ * they saturate at the bounds. The host tool \p hg_compare measures their
+ * error with respect to the float observers.
+ */
+#define HG_TYPE float
+
+/**
+ * \def HG_FIXED_THETA
+ *
+ * Full scale of the angle in the fixed point observers, as an exponent
+ * of two: the angle is in \f$ [-2^4, 2^4) \f$ rad (the angle of the encoder
+ * is wrapped in \f$ [0, 2\pi) \f$, see \p encoder_t).
+ */
+#define HG_FIXED_THETA 4
+
+/**
+ * \def HG_FIXED_OMEGA
+ *
+ * Full scale of the wheel speed in the fixed point observers, as an
+ * exponent of two: the speed is in \f$ [-2^{10}, 2^{10}) \f$ rad/s.
+ */
+#define HG_FIXED_OMEGA 10
+
+/**
+ * \def HG_FIXED_ALPHA
+ *
+ * Full scale of the wheel acceleration in the fixed point observers of
+ * order 3, as an exponent of two: the acceleration is in
+ * \f$ [-2^{11}, 2^{11}) \f$ rad/s\f$^2\f$. A larger scale rounds the
+ * slow pole of the acceleration in Q15, a smaller one saturates in the
+ * transients (a step of the speed of 300 rad/s gives about 430 rad/s\f$^2\f$).
+ */
+#define HG_FIXED_ALPHA 11
+
+/**
+ * \def KF_PROCESS_NOISE
+ *
+ * Process noise of the Kalman filter of the encoders (\p kalman_obs_t):
+ * the spectral density of the jerk of the wheel, in (rad/s\f$^3\f$)\f$^2\f$ s.
+ * A larger value gives a faster filter, with more noise on the speed.
+ */
+#define KF_PROCESS_NOISE 1e4
+
+/**
+ * \def KF_MEASUREMENT_NOISE
+ *
+ * Measurement noise of the Kalman filter of the encoders (\p kalman_obs_t):
+ * the variance of the angle, in rad\f$^2\f$. The angle is quantized on the edges
+ * of the encoder, thus the variance is the one of the quantization,
+ * \f$ \Delta^2 / 12 \f$ with \f$ \Delta = \pi / \mathrm{ENCODER\_QUANTIZATION} \f$.
+ */
+#define KF_MEASUREMENT_NOISE ((M_PI / ENCODER_QUANTIZATION) * (M_PI / ENCODER_QUANTIZATION) / 12.0)
+
 /**
  * \def M_PI
  *
- * Define of pi constant
+ * Define of pi constant (it replaces the one of \p math.h, if any)
  */
+#undef M_PI
 #define M_PI 3.1415926536
 
 #endif /* CONFIGURATIONS_HPP */
\ No newline at end of file
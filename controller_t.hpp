@@ -64,18 +64,29 @@
  * | \f$ c_1 \f$   | `CTRL_NONLIN_A`     | Non linearity first coefficient       |
  * | \f$ c_2 \f$   | `CTRL_NONLIN_B`     | Non linearity second coefficient      |
  * | \f$ d \f$     | `CTRL_SYSTEM_DELAY` | Delay: (\f$mod(d,t_s) = 0\f$! (in ms) |
- * | \f$ t_s \f$   | `LOOP_TIMING`       | Time step for integration (in ms)     |
+ * | \f$ t_s \f$   | `CTRL_TIMING`       | Time step for integration (in ms)     |
  * | \f$ k_p \f$   | `CTRL_KP`           | PI controller proportional gain       |
  * | \f$ k_i \f$   | `CTRL_KI`           | PI controller integrative gain        | 
  *    
- * **DELAY and LOOP_TIMING**: the controller has been built with the idea of running in the real
- * time loop, which runs approximatively a 250Hz (4 ms). The Delay identified for the system is nominally
+ * **DELAY and CTRL_TIMING**: the controller has been built with the idea of running in the real
+ * time loop, in the control rate group, which runs approximatively a 250Hz (4 ms). The Delay identified for the system is nominally
  * 80 ms. Please notice that the integer division between delay and loop timing must have no residuals
- * (`CTRL_SYSTEM_DELAY % LOOP_TIMING == 0`), in order to discretize correctly the delay.
+ * (`CTRL_SYSTEM_DELAY % CTRL_TIMING == 0`), in order to discretize correctly the delay.
  * 
  * \warning The delay is a characteristic of this particular system. It is not possible to eliminate it 
  * via software. 
  * 
+ * **Runtime parameters**: the constants of the table are the nominal ones. A new set
+ * (\p ctrl_params_t, e.g. identified on the car by \p tuner_t) can be installed at
+ * runtime with \p controller_t::install, with a delay up to \p CTRL_SYSTEM_DELAY_MAX.
+ * 
+ * **Fixed point**: the controller is a template on its arithmetic (\p CTRL_TYPE). The
+ * \p float specialization is the reference implementation; with \p q15_t or \p q31_t
+ * (see \p fixed_t) the whole path (feed forward, PI, Smith predictor and non linearity)
+ * runs on integers, and the square root of \f$\phi\f$ is an integer square root.
+ * The host tool \p ctrl_compare closes the loop on the plant model with the float
+ * and the fixed point controllers, and compares the two.
+ * 
  * \warning All the hardcoded constants are concentrated in the class \p controller_t!
  * 
  * \see controller_t
@@ -84,8 +95,35 @@
 #include <Arduino.h>
 #include "configurations.hpp"
 #include "cyclic_array_t.hpp"
+#include "fixed_t.hpp"
+#include "lookup_table_t.hpp"
 #include "types.hpp"
 
+/** \brief Parameters of the speed controller
+ *
+ * The model of the plant and the gains of the PI, as in the table of
+ * \p controller_t. The nominal ones are in \p configurations.hpp
+ * (\p ctrl_params_nominal), others can be installed at runtime
+ * (\p controller_t::install).
+ */
+typedef struct ctrl_params_t {
+  float a;        /**< \f$a\f$: pole of the model (1/s) */
+  timing_t delay; /**< \f$d\f$: delay of the model (ms) */
+  float c1;       /**< \f$c_1\f$: first coefficient of the non linearity */
+  float c2;       /**< \f$c_2\f$: second coefficient of the non linearity */
+  float kp;       /**< \f$k_p\f$: proportional gain of the PI */
+  float ki;       /**< \f$k_i\f$: integrative gain of the PI */
+} ctrl_params_t;
+
+/**
+ * \brief Nominal parameters of the speed controller
+ * \return the parameters in \p configurations.hpp
+ */
+inline ctrl_params_t ctrl_params_nominal() {
+  ctrl_params_t p = {CTRL_MODEL_A, CTRL_SYSTEM_DELAY, CTRL_NONLIN_A, CTRL_NONLIN_B, CTRL_KP, CTRL_KI};
+  return p;
+}
+
 /** \brief Class wich implements a PI controller
  * 
  * The class implements a PI controller with an Backward Euler discretization:
@@ -101,6 +139,13 @@
  *   u_{k} & = k_i x_{k - 1} + (k_p + t_s k_i) e_{k}
  * \f}
  * 
+ * **Anti-windup**: the output (with an optional feed forward \f$u_{ff}\f$) is
+ * saturated in the limits of the actuator \f$[u_{min}, u_{max}]\f$ (see \p limits,
+ * by default there are no limits). When the output is saturated, the error is
+ * integrated only if it drives the output back in the limits (conditional
+ * integration): the integral does not grow while the actuator cannot follow it,
+ * and the controller leaves the saturation as soon as the error changes sign.
+ * 
  * Usage example:
  * @code
  * static const timing_t ts = 4; // ms
@@ -119,14 +164,16 @@
  */
 template < timing_t MILLIS >
 class pi_ctrl_t {
-  const static float ts = float(MILLIS) / 1000.0; /**< Time step in seconds */
+  static constexpr float ts = float(MILLIS) / 1000.0; /**< Time step in seconds */
   float ei; /**< Integral of the error */
   float kp; /**< \f$k_p = k_{p,in} + t_s k_{i,in} \f$: discretized proportional gain */
   float ki; /**< \f$k_i = k{i,in}\f$: discretized integrative gain */
+  float u_min; /**< Lower limit of the actuator */
+  float u_max; /**< Upper limit of the actuator */
 
  public:
   /** \brief Empty constructor, sets the gains to zero */
-  pi_ctrl_t() : ei(0) { gain(0, 0); }
+  pi_ctrl_t() : ei(0), u_min(-INFINITY), u_max(INFINITY) { gain(0, 0); }
   
   /** \brief Normal constructor, evaluates the gain and discretize
    * 
@@ -136,7 +183,7 @@ class pi_ctrl_t {
    * \param kp_ \f$ k_{p,in} \f$: proportional gain of the controller
    * \param ki_ \f$ k_{i,in} \f$: integrative gain of the controller
    */
-  pi_ctrl_t(const float kp_, const float ki_) : ei(0) { gain(kp_, ki_); }
+  pi_ctrl_t(const float kp_, const float ki_) : ei(0), u_min(-INFINITY), u_max(INFINITY) { gain(kp_, ki_); }
 
   /** \brief Updates the gain of the controller
    * 
@@ -156,6 +203,16 @@ class pi_ctrl_t {
     kp = kp_ + ts * ki_;
   }
 
+  /** \brief Sets the limits of the actuator
+   * 
+   * \param lo \f$u_{min}\f$: lower limit of the output (\p -INFINITY for no limit)
+   * \param hi \f$u_{max}\f$: upper limit of the output (\p INFINITY for no limit)
+   */
+  void limits(const float lo, const float hi) {
+    u_min = lo;
+    u_max = hi;
+  }
+
   /** \brief Evaluate control using error
    * 
    * Evaluates the next control action using the current error.
@@ -163,10 +220,21 @@ class pi_ctrl_t {
    * current reading (\f$ y \f$).
    * 
    * \param e current error (\f$r - y\f$)
-   * \return the control action
+   * \param ff feed forward, added to the output before the saturation
+   * \return the control action, in \f$[u_{min}, u_{max}]\f$
    */
-  const float operator()(const float e) {
-    float u = ki * ei + kp * e;
+  const float operator()(const float e, const float ff = 0) {
+    float u = ff + ki * ei + kp * e;
+    if (u > u_max) {
+      if (e < 0)
+        ei += ts * e;
+      return u_max;
+    }
+    if (u < u_min) {
+      if (e > 0)
+        ei += ts * e;
+      return u_min;
+    }
     ei += ts * e;
     return u;
   }
@@ -178,6 +246,15 @@ class pi_ctrl_t {
    * \param ei_ new value of the state
    */
   void reset(const float ei_) { ei = ei_; }
+
+  /** \brief Sets the state for a bumpless transfer
+   * 
+   * Sets the integral so that the output, with a zero error and no feed forward,
+   * is \p u (\f$x = u / k_i\f$). Without the integrative gain the state is zero.
+   * 
+   * \param u the output of the controller at the transfer
+   */
+  void track(const float u) { ei = (ki != 0) ? u / ki : 0; }
 };
 
 /** \brief Dicretization of the time delay
@@ -238,24 +315,31 @@ using time_delay_t = cyclic_array_t< float, DELAY / MILLIS >;
  *  \omega &= y_{k - n} \\
  *  \omega_{predict} &= y{k} 
  * \f}
+ * The delay stores the outputs \f$ y_k \f$ (not the states): the non linearity
+ * is evaluated once for each step, when the state is updated.
+ * 
+ * The delay line holds \p DELAY: a shorter delay can be set at runtime
+ * (\p model), and the output is read in the middle of the line.
  * 
  * \warning The non linearity is a **virtual** method. Thus it should
  * be redefined in the controller.
  *  
  * \tparam MILLIS discretization time in millisecond
- * \tparam DELAY delay in milliseconds
+ * \tparam DELAY delay in milliseconds (the longest one, with \p model)
  */
 template < timing_t MILLIS, timing_t DELAY >
 class smith_predictor_t {
-  const static float ts = float(MILLIS) / 1000.0; /**< Time step in seconds */
-  const static float d = float(DELAY) / 1000.0; /**< Delay in seconds */ 
+  static constexpr float ts = float(MILLIS) / 1000.0; /**< Time step in seconds */
+  const static size_t N = DELAY / MILLIS; /**< Size of the delay line */
   float a_sp; /**< state gain for discretization */
   float b_sp; /**< input gain for discretization */
-  time_delay_t< MILLIS, DELAY > delay; /**< Delay system */
+  float x; /**< state of the dynamical system */
+  size_t n; /**< Delay in steps, in \f$[1, N]\f$ */
+  time_delay_t< MILLIS, DELAY > delay; /**< Delay system (outputs of the dynamical system) */
   
  public:
   /** \brief Empty constructor, gain to zero */
-  smith_predictor_t() : a_sp(0), b_sp(0), delay(0){};
+  smith_predictor_t() : a_sp(0), b_sp(0), x(0), n(N), delay(0){};
   /** \brief Constructor, which sets the constants for the dynamical system.
    * 
    * The constructor evaluates:
@@ -271,7 +355,22 @@ class smith_predictor_t {
    * 
    * \param a the \f$ a \f$ of the dynamical system
    */
-  smith_predictor_t(float a) : delay(0) { gain(a); }
+  smith_predictor_t(float a) : x(0), n(N), delay(0) { gain(a); }
+
+  /** \brief Changes the model
+   * 
+   * Sets the pole (as the constructor) and the delay, that is rounded down to
+   * the time step and saturated in \f$[t_s, \mathrm{DELAY}]\f$. The state is not
+   * changed (see \p reset).
+   * 
+   * \param a the \f$ a \f$ of the dynamical system
+   * \param d the delay in milliseconds
+   */
+  void model(const float a, const timing_t d) {
+    gain(a);
+    n = d / MILLIS;
+    n = (n < 1) ? 1 : ((n > N) ? N : n);
+  }
 
   /** \brief Main loop for the Smith predictor
    * 
@@ -279,6 +378,7 @@ class smith_predictor_t {
    * \f[
    *  x_{k} = a_{sp} x_{k-1} + b_{sp} \mathrm{sat}_{[0,1]}(u)
    * \f]
+   * and pushes the output \f$ \phi(x_k) \f$ in the delay.
    * 
    * \param u the last input to the dynamical system
    */
@@ -288,7 +388,8 @@ class smith_predictor_t {
       q = 0.0;
     if (q > 1.0)
       q = 1.0;
-    delay.push_back(a_sp * delay.back() + b_sp * q);
+    x = a_sp * x + b_sp * q;
+    delay.push_back(phi(x));
   }
 
   /** \brief Output non linearity
@@ -309,14 +410,29 @@ class smith_predictor_t {
    * 
    * \return the value of the output in the internal model
    */
-  const float state() const { return phi(delay.front()); }
+  const float state() const { return delay[N - n]; }
   /** \brief The value of the output prediction in the internal model (without delay)
    * 
    * \return the value of the output prediction in the internal model
    */
-  const float state_predict() const { return phi(delay.back()); }
+  const float state_predict() const { return delay.back(); }
   /** \brief resets the internal model delay and dynamical system to 0 */
-  const void reset() { delay.fill(0); }
+  const void reset() {
+    x = 0;
+    delay.fill(phi(0));
+  }
+  /** \brief resets the internal model to its equilibrium for an input
+   * 
+   * The state is the (saturated) input, since the model has unitary gain, and
+   * the delay is filled with its output: as if the input was applied since
+   * longer than the delay.
+   * 
+   * \param u the input applied to the system
+   */
+  const void reset(const float u) {
+    x = (u < 0.0) ? 0.0 : ((u > 1.0) ? 1.0 : u);
+    delay.fill(phi(x));
+  }
 
  private:
  /** \brief Sets the constants for the dynamical system.
@@ -341,7 +457,67 @@ class smith_predictor_t {
 
 };
 
+/** \brief \f$2^e\f$ (at compile time)
+ * \param e the exponent
+ * \return the power of two
+ */
+constexpr double ctrl_scale(const int8_t e) {
+  return (e == 0) ? 1.0 : ((e > 0) ? 2.0 * ctrl_scale(e - 1) : 0.5 * ctrl_scale(e + 1));
+}
+
+/** \brief Smallest full scale of a constant (at compile time)
+ * \param v the constant
+ * \param e first exponent to try
+ * \return the smallest \f$E \geq e\f$ with \f$|v| < 2^E\f$
+ */
+constexpr int8_t ctrl_exponent(const double v, const int8_t e = -31) {
+  return ((v < ctrl_scale(e)) && (-v < ctrl_scale(e))) ? e : ctrl_exponent(v, e + 1);
+}
+
+/** \brief \f$\sqrt{v}\f$ (at compile time, with the Newton iteration)
+ * \param v the radicand (positive)
+ * \param r current estimate
+ * \param n remaining iterations
+ * \return the square root
+ */
+constexpr double ctrl_sqrt(const double v, const double r = 1.0, const uint8_t n = 64) {
+  return ((n == 0) || ((r + v / r) / 2.0 == r)) ? r : ctrl_sqrt(v, (r + v / r) / 2.0, n - 1);
+}
+
+/** \brief Generator of the table of \f$\phi\f$ (see \p lookup_table_t)
+ *
+ * The non linearity on \f$[0, 1]\f$ (the input of the Smith predictor is saturated),
+ * with the curvature:
+ * \f[
+ *   |\phi''(u)| = \frac{2 c_2}{(c_1^2 + 4 c_2 u)^{3/2}}
+ * \f]
+ * that is largest at the first breakpoint of each segment.
+ */
+struct ctrl_phi_t {
+  static constexpr double x_min() { return 0.0; } /**< First breakpoint */
+  static constexpr double x_max() { return 1.0; } /**< Last breakpoint */
+  /** \brief \f$\phi(u)\f$ */
+  static constexpr double f(const double u) {
+    return (ctrl_sqrt(CTRL_NONLIN_A * CTRL_NONLIN_A + 4.0 * CTRL_NONLIN_B * u) - CTRL_NONLIN_A) / (2.0 * CTRL_NONLIN_B);
+  }
+  /** \brief Largest \f$|\phi''|\f$ in \f$[a, b]\f$ */
+  static constexpr double curvature(const double a, const double /*b*/) {
+    return 2.0 * CTRL_NONLIN_B / ((CTRL_NONLIN_A * CTRL_NONLIN_A + 4.0 * CTRL_NONLIN_B * a) *
+                                  ctrl_sqrt(CTRL_NONLIN_A * CTRL_NONLIN_A + 4.0 * CTRL_NONLIN_B * a));
+  }
+};
+
 /** \brief The actual ESC controller
+ *
+ * The primary template is the fixed point controller (\p T is a \p fixed_t),
+ * the specialization for \p float is the reference one.
+ *
+ * \tparam T arithmetic of the controller (\p float, \p q15_t or \p q31_t)
+ */
+template < typename T = CTRL_TYPE >
+class controller_t;
+
+/** \brief The actual ESC controller (float)
  * 
  *  The class implements the ESC control. The ESC control
  * receives a \p float with the reference for the wheel speed and try to 
@@ -402,39 +578,61 @@ class smith_predictor_t {
  * | \f$c_1\f$   | `CTRL_NONLIN_A`     | Non linearity first coefficient       |
  * | \f$c_2\f$   | `CTRL_NONLIN_B`     | Non linearity second coefficient      |
  * | \f$d\f$     | `CTRL_SYSTEM_DELAY` | Delay: (\f$mod(d,t_s) = 0\f$! (in ms) |
- * | \f$t_s\f$   | `LOOP_TIMING`       | Time step for integration (in ms)     |
+ * | \f$t_s\f$   | `CTRL_TIMING`       | Time step for integration (in ms)     |
  * | \f$k_p\f$   | `CTRL_KP`           | PI controller proportional gain       |
  * | \f$k_i\f$   | `CTRL_KI`           | PI controller integrative gain        | 
  *    
- * **DELAY and LOOP_TIMING**: the controller has been built with the idea of running in the real
- * time loop, which runs approximatively a 250Hz (4 ms). The Delay identified for the system is nominally
+ * **DELAY and CTRL_TIMING**: the controller has been built with the idea of running in the real
+ * time loop, in the control rate group, which runs approximatively a 250Hz (4 ms). The Delay identified for the system is nominally
  * 80 ms. Please notice that the integer division between delay and loop timing must have no residuals
- * (`CTRL_SYSTEM_DELAY % LOOP_TIMING == 0`), in order to discretize correctly the delay.
- * 
- * \warning The delay is a characteristic of this particular system. It is not possible to eliminate it 
- * via software. 
- * 
+ * (`CTRL_SYSTEM_DELAY % CTRL_TIMING == 0`), in order to discretize correctly the delay.
+ *
+ * \note Until the fixed point variant was added, the Smith predictor was constructed without its
+ * pole: its gains were zero, the prediction was always 0, and the controller was the PI with the
+ * feed forward only. The predictor now has the pole \f$a\f$, thus the closed loop is different
+ * (e.g. lower overshoot on the steps of \p host/windup_bench.cpp). Its delay line stores the
+ * outputs \f$\phi(x_k)\f$ instead of the states, with the same delayed output (\p host/sp_check.cpp).
+ *
+ * \warning The delay is a characteristic of this particular system. It is not possible to eliminate it
+ * via software.
+ *
  * \warning This class is **taylored made for our applications and contains several hardcoded constants**.
  * It also implements as static methods the non linearities (direct and inverse) wich are used in the 
- * feed forward controller and in the Smith predictor.
+ * feed forward controller and in the Smith predictor. The static methods have the nominal
+ * coefficients: after \p install the controller uses the installed ones.
  */ 
-class controller_t {
-  
+template <>
+class controller_t< float > {
+  static_assert(CTRL_SYSTEM_DELAY % CTRL_TIMING == 0, "CTRL_SYSTEM_DELAY must be a multiple of CTRL_TIMING");
+
  public:
+#ifdef CTRL_NONLIN_LUT
+  typedef lookup_table_t< float, CTRL_NONLIN_LUT, ctrl_phi_t > phi_table_t; /**< Table of \f$\phi\f$, in the flash */
+  static_assert(phi_table_t::error() <= CTRL_NONLIN_LUT_ERROR, "controller_t: the table of phi is too short for CTRL_NONLIN_LUT_ERROR");
+#endif
+
   /** \brief Implementation of the non linearity
    * 
    * \f[
    *   \omega = \phi(u) = \frac{\sqrt{c_1^2 + 4 c_2 u}}{2 c_2}
    * \f]
    * 
+   * With \p CTRL_NONLIN_LUT the function interpolates the table \p phi_table_t
+   * (no square root and no division), with an error below \p CTRL_NONLIN_LUT_ERROR
+   * for \f$u \in [0, 1]\f$ (the saturation of the Smith predictor).
+   * 
    * \warning this is a static function and it is shared with the Smith predictor 
-   * used by the controller
+   * used by the controller (with the nominal coefficients)
    * 
    * \param u input for the non linearity
    * \return output of the non linearity
    */
   static const float phi(const float u) {
+#ifdef CTRL_NONLIN_LUT
+    return phi_table_t::eval(u);
+#else
     return (sqrt((CTRL_NONLIN_A * CTRL_NONLIN_A) + (4 * CTRL_NONLIN_B) * u) - CTRL_NONLIN_A)/(2 * CTRL_NONLIN_B);
+#endif
   }
 
   /** \brief Implementation of the inverse of the non linearity
@@ -443,6 +641,9 @@ class controller_t {
    *   u = \phi^{-1}(\omega) = c_1 \omega^2 + c_2 \omega
    * \f]
    * 
+   * The polynomial needs no square root, thus it has no table: it is evaluated
+   * also with \p CTRL_NONLIN_LUT.
+   * 
    * \warning this is a static function.
    * 
    * \param omega input for the inverse of the non linearity
@@ -457,9 +658,14 @@ class controller_t {
    * 
    * This smith predictor is specific for our ESC, with the identified non linearity
    * hardcoded inside (actually it is the \f$ \phi(u) \f$ implemented in \p controller_t
-   * as a static function).
+   * as a static function). Other coefficients can be installed (\p nonlin): the
+   * non linearity is then evaluated with the square root.
    */
-  class esc_sp_t : public smith_predictor_t<LOOP_TIMING, CTRL_SYSTEM_DELAY> {
+  class esc_sp_t : public smith_predictor_t<CTRL_TIMING, CTRL_SYSTEM_DELAY_MAX> {
+    float c1; /**< First coefficient of the non linearity */
+    float c2; /**< Second coefficient of the non linearity */
+    bool nominal; /**< The coefficients are the ones of the configuration (\p controller_t::phi) */
+
     /**
      * \brief System non linearity
      * \f[
@@ -468,26 +674,99 @@ class controller_t {
      * \param u the imput for the non linearity
      * \return the output for the non linearity
      */ 
-    const float phi(const float u) const override { return controller_t::phi(u); }
+    const float phi(const float u) const override {
+      return nominal ? controller_t::phi(u) : (sqrt(c1 * c1 + 4 * c2 * u) - c1) / (2 * c2);
+    }
    public:
     /** \brief Empty constructor */
-    esc_sp_t() : smith_predictor_t<LOOP_TIMING, CTRL_SYSTEM_DELAY>() {}
+    esc_sp_t() : smith_predictor_t<CTRL_TIMING, CTRL_SYSTEM_DELAY_MAX>() { nonlin(CTRL_NONLIN_A, CTRL_NONLIN_B); }
     /** 
      * \brief Constructor with pole 
+     *
+     * The pole is given to the base class: without it the gains of the model
+     * are zero, and the predictor outputs 0 (checked by \p host/sp_check.cpp).
+     *
      * \param a the pole of the model
      */
-    esc_sp_t(const float a) : smith_predictor_t<LOOP_TIMING, CTRL_SYSTEM_DELAY>() {}
+    esc_sp_t(const float a) : smith_predictor_t<CTRL_TIMING, CTRL_SYSTEM_DELAY_MAX>(a) {
+      nonlin(CTRL_NONLIN_A, CTRL_NONLIN_B);
+    }
+
+    /**
+     * \brief Changes the coefficients of the non linearity
+     * \param c1_ first coefficient
+     * \param c2_ second coefficient
+     */
+    void nonlin(const float c1_, const float c2_) {
+      c1 = c1_;
+      c2 = c2_;
+      nominal = (c1 == float(CTRL_NONLIN_A)) && (c2 == float(CTRL_NONLIN_B));
+    }
+
+    /**
+     * \brief Inverse of the non linearity, with the current coefficients
+     * \param omega input for the inverse of the non linearity
+     * \return output of the inverse of the non linearity
+     */
+    const float phi_inv(const float omega) const { return c1 * omega + c2 * omega * omega; }
   };
 
-  pi_ctrl_t< LOOP_TIMING > pi; /**< PI controller block */
+  static_assert(CTRL_SYSTEM_DELAY <= CTRL_SYSTEM_DELAY_MAX, "CTRL_SYSTEM_DELAY must not exceed CTRL_SYSTEM_DELAY_MAX");
+  static_assert(CTRL_SYSTEM_DELAY_MAX % CTRL_TIMING == 0, "CTRL_SYSTEM_DELAY_MAX must be a multiple of CTRL_TIMING");
+
+  pi_ctrl_t< CTRL_TIMING > pi; /**< PI controller block */
   esc_sp_t sp; /**< Smith predictor block */
+  ctrl_params_t p; /**< Installed parameters */
 
  public:
   /** \brief Empty constructor
    * 
    * \warning It uses the hardcoded constants of the configuration file.
    */
-  controller_t() : pi(pi_ctrl_t<LOOP_TIMING>(CTRL_KP, CTRL_KI)), sp(esc_sp_t(CTRL_MODEL_A)) {}
+  controller_t() : pi(pi_ctrl_t<CTRL_TIMING>(CTRL_KP, CTRL_KI)), sp(esc_sp_t(CTRL_MODEL_A)) {
+    install(ctrl_params_nominal());
+  }
+
+  /** \brief Installs the parameters of the model and the gains
+   * 
+   * The parameters replace the nominal ones of the configuration (e.g. after
+   * the identification of \p tuner_t) and the state is reset. They are rejected
+   * (and the controller is not changed) if the model is not valid:
+   * \f$a > 0\f$, \f$c_1 > 0\f$, \f$c_2 > 0\f$, \f$d \le \mathrm{CTRL\_SYSTEM\_DELAY\_MAX}\f$
+   * and non negative gains.
+   * 
+   * \param params the new parameters
+   * \return true if the parameters are installed
+   */
+  const bool install(const ctrl_params_t& params) {
+    if (!(params.a > 0) || !(params.c1 > 0) || !(params.c2 > 0) || (params.delay > CTRL_SYSTEM_DELAY_MAX) ||
+        !(params.kp >= 0) || !(params.ki >= 0))
+      return false;
+    p = params;
+    pi.gain(p.kp, p.ki);
+    sp.model(p.a, p.delay);
+    sp.nonlin(p.c1, p.c2);
+    reset();
+    return true;
+  }
+
+  /**
+   * \brief The installed parameters
+   * \return the parameters of the model and the gains
+   */
+  const ctrl_params_t& params() const { return p; }
+
+  /** \brief Sets the limits of the actuator
+   * 
+   * The control is saturated in the limits and the PI stops integrating
+   * while it is saturated (see \p pi_ctrl_t). The limits are the range of
+   * \p esc_t::ctrl (\p esc_t::ctrl_min and \p esc_t::ctrl_max), by default
+   * there are no limits.
+   * 
+   * \param lo lower limit of the control
+   * \param hi upper limit of the control
+   */
+  void limits(const float lo, const float hi) { pi.limits(lo, hi); }
 
   /** \brief Main loop of the controller
    * 
@@ -501,7 +780,7 @@ class controller_t {
    */
   const float operator()(const float reference, const float measure) {
     float e_omega = reference - (measure - sp.state() + sp.state_predict());
-    float u = controller_t::phi_inv(reference) + pi(e_omega);  // u_ff + u_fb
+    float u = pi(e_omega, sp.phi_inv(reference));  // sat(u_ff + u_fb)
     sp(u);
     return u;
   }
@@ -511,6 +790,214 @@ class controller_t {
     sp.reset();
     pi.reset();
   }
+
+  /** \brief Resets the controller for a bumpless transfer
+   * 
+   * Seeds the state from the control that is applied to the system (e.g. the
+   * last open loop command of the ESC, \p esc_t::get_ctrl) before closing the loop:
+   *  - the Smith predictor is at the equilibrium for \p u (\p smith_predictor_t::reset)
+   *  - the integral of the PI gives \f$u - \phi^{-1}(y)\f$ (\p pi_ctrl_t::track)
+   * 
+   * With a reference equal to the measure, the first output is \p u (there is
+   * no bump), with another reference the controller starts from \p u as for a
+   * step of the reference.
+   * 
+   * \param u the control applied to the system
+   * \param measure measure from the system (or an observer)
+   */
+  const void reset(const float u, const float measure) {
+    sp.reset(u);
+    pi.track(u - sp.phi_inv(measure));
+  }
+};
+
+/** \brief The actual ESC controller (fixed point)
+ *
+ * The same scheme, discretization and interface of \p controller_t<float>, with
+ * the signals stored as \p fixed_t numbers, normalized to the full scales:
+ *
+ * | Signal                                   | Full scale           |
+ * |------------------------------------------|----------------------|
+ * | speeds (reference, measure, \f$\omega_{sp}\f$) | \f$2^{\mathrm{CTRL\_FIXED\_OMEGA}}\f$ |
+ * | control, state of the Smith predictor    | \f$2^{\mathrm{CTRL\_FIXED\_U}}\f$     |
+ * | integral of the error                    | \f$2^{\mathrm{CTRL\_FIXED\_OMEGA}}\f$ (in the accumulator) |
+ * | gains of the PI                          | \f$2^{\mathrm{CTRL\_FIXED\_GAIN}}\f$  |
+ *
+ * The constants of the model take the smallest full scale that holds the
+ * nominal ones (\p ctrl_exponent): the parameters installed at runtime
+ * (\p install) must fit the same full scales. The integral of the error and the state of the Smith
+ * predictor are kept in the accumulators (\f$2F\f$ fractional bits): the small
+ * increments of each step are not lost in the rounding.
+ *
+ * The non linearity is rewritten with a single square root and no divisions:
+ *
+ * \f{align}
+ *   \phi(x) & = g \left( \sqrt{1 + k x} - 1 \right), & g & = \frac{c_1}{2 c_2}, & k & = \frac{4 c_2}{c_1^2} \\
+ *   \phi^{-1}(\omega) & = (c_1 + c_2 \omega) \, \omega
+ * \f}
+ *
+ * and, as in the float controller, it is evaluated once for each step (the
+ * delay stores the outputs of the model).
+ *
+ * Usage example:
+ * @code
+ * controller_t< q15_t > ctrl;
+ * float u = ctrl(reference, omega);     // as controller_t<float>
+ * q15_t::raw_t v = ctrl.step(r, w);      // on the raw numbers
+ * @endcode
+ *
+ * \warning \p q31_t has products in 64 bit, that on the board are slower
+ * than the float ones: it is the accurate reference, \p q15_t is the fast one.
+ *
+ * \tparam T a \p fixed_t (\p q15_t or \p q31_t)
+ */
+template < typename T >
+class controller_t {
+  static_assert(CTRL_SYSTEM_DELAY % CTRL_TIMING == 0, "CTRL_SYSTEM_DELAY must be a multiple of CTRL_TIMING");
+
+ public:
+  typedef typename T::raw_t raw_t;   /**< Type of the signals */
+  typedef typename T::wide_t wide_t; /**< Type of the accumulators */
+
+  static constexpr int8_t e_omega = CTRL_FIXED_OMEGA; /**< Full scale of the speeds */
+  static constexpr int8_t e_u = CTRL_FIXED_U;         /**< Full scale of the control */
+  static constexpr int8_t e_gain = CTRL_FIXED_GAIN;   /**< Full scale of the gains */
+
+ private:
+  static constexpr double ts = double(CTRL_TIMING) / 1000.0;                      /**< Time step (s) */
+  static constexpr double phi_k = 4.0 * CTRL_NONLIN_B / (CTRL_NONLIN_A * CTRL_NONLIN_A); /**< \f$k\f$ */
+  static constexpr double phi_g = CTRL_NONLIN_A / (2.0 * CTRL_NONLIN_B);          /**< \f$g\f$ */
+  static constexpr double slope = CTRL_NONLIN_A + CTRL_NONLIN_B * ctrl_scale(e_omega); /**< Largest \f$c_1 + c_2 \omega\f$ */
+
+  static constexpr int8_t e_k = ctrl_exponent(phi_k);    /**< Full scale of \f$k\f$ */
+  static constexpr int8_t e_v = e_k + e_u;               /**< Full scale of \f$1 + k x\f$ */
+  static constexpr int8_t e_root = e_v / 2;              /**< Full scale of \f$\sqrt{1 + k x}\f$ */
+  static constexpr int8_t e_g = ctrl_exponent(phi_g);    /**< Full scale of \f$g\f$ */
+  static constexpr int8_t e_slope = ctrl_exponent(slope); /**< Full scale of \f$c_1 + c_2 \omega\f$ */
+
+  static_assert(e_v >= 1, "controller_t: CTRL_FIXED_U is too small for the non linearity");
+  static_assert(1.0 + phi_k < ctrl_scale(2 * e_root), "controller_t: CTRL_FIXED_U is too small for the non linearity");
+
+  static constexpr raw_t one_v = T::constant(1.0, e_v);                    /**< 1, with the full scale of \f$1 + k x\f$ */
+  static constexpr raw_t one_root = T::constant(1.0, e_root);              /**< 1, with the full scale of the root */
+  static constexpr raw_t one_u = T::constant(1.0, e_u);                    /**< 1, with the full scale of the control */
+  static constexpr raw_t dt = T::constant(ts, 0);                          /**< \f$t_s\f$ */
+  static constexpr size_t N = CTRL_SYSTEM_DELAY_MAX / CTRL_TIMING;         /**< Size of the delay line */
+
+  static_assert(CTRL_KP + ts * CTRL_KI < ctrl_scale(e_gain), "controller_t: the gains saturate, increase CTRL_FIXED_GAIN");
+  static_assert(CTRL_KI < ctrl_scale(e_gain), "controller_t: the gains saturate, increase CTRL_FIXED_GAIN");
+  static_assert(CTRL_SYSTEM_DELAY <= CTRL_SYSTEM_DELAY_MAX, "CTRL_SYSTEM_DELAY must not exceed CTRL_SYSTEM_DELAY_MAX");
+  static_assert(CTRL_SYSTEM_DELAY_MAX % CTRL_TIMING == 0, "CTRL_SYSTEM_DELAY_MAX must be a multiple of CTRL_TIMING");
+
+  raw_t c1;                                              /**< \f$c_1\f$ */
+  raw_t c2;                                              /**< \f$c_2\f$ */
+  raw_t k;                                               /**< \f$k\f$ */
+  raw_t g;                                               /**< \f$g\f$ */
+  raw_t b;                                               /**< \f$b_{sp}\f$ (\f$a_{sp} = 1 - b_{sp}\f$) */
+  raw_t kp;                                              /**< Discretized proportional gain */
+  raw_t ki;                                              /**< Integrative gain */
+  size_t n;                                              /**< Delay in steps, in \f$[1, N]\f$ */
+  ctrl_params_t p;                                       /**< Installed parameters */
+
+  wide_t ei;                                             /**< Integral of the error (accumulator) */
+  wide_t x;                                              /**< State of the Smith predictor (accumulator) */
+  cyclic_array_t< raw_t, N > delay;                      /**< Outputs of the Smith predictor */
+  raw_t u_min;                                           /**< Lower limit of the control */
+  raw_t u_max;                                           /**< Upper limit of the control */
+
+ public:
+  /** \brief Empty constructor
+   *
+   * \warning It uses the hardcoded constants of the configuration file.
+   */
+  controller_t() : ei(0), x(0), delay(0), u_min(T::min), u_max(T::max) { install(ctrl_params_nominal()); }
+
+  /** \brief Installs the parameters of the model and the gains
+   *
+   * As \p controller_t<float>::install. The parameters are converted to the
+   * full scales of the nominal ones: they are rejected also if they do not fit
+   * (\f$c_1 + c_2 2^{\mathrm{CTRL\_FIXED\_OMEGA}}\f$, \f$g\f$, \f$1 + k\f$
+   * and the gains).
+   *
+   * \param params the new parameters
+   * \return true if the parameters are installed
+   */
+  const bool install(const ctrl_params_t& params);
+
+  /**
+   * \brief The installed parameters
+   * \return the parameters of the model and the gains
+   */
+  const ctrl_params_t& params() const { return p; }
+
+  /** \brief Sets the limits of the actuator
+   *
+   * As \p controller_t<float>::limits: the control is saturated and the
+   * integral stops while it is saturated. By default the limits are the
+   * full scale of the control.
+   *
+   * \param lo lower limit of the control
+   * \param hi upper limit of the control
+   */
+  void limits(const float lo, const float hi) {
+    u_min = T::from_float(lo, e_u);
+    u_max = T::from_float(hi, e_u);
+  }
+
+  /** \brief Implementation of the non linearity
+   *
+   * \f[
+   *   \omega = \phi(x) = g \left( \sqrt{1 + k x} - 1 \right)
+   * \f]
+   *
+   * \param u input for the non linearity (full scale \f$2^{\mathrm{CTRL\_FIXED\_U}}\f$, in \f$[0, 1]\f$)
+   * \return output of the non linearity (full scale \f$2^{\mathrm{CTRL\_FIXED\_OMEGA}}\f$)
+   */
+  raw_t phi(const raw_t u) const;
+
+  /** \brief Implementation of the inverse of the non linearity
+   *
+   * \f[
+   *   u = \phi^{-1}(\omega) = (c_1 + c_2 \omega) \, \omega
+   * \f]
+   *
+   * \param omega input for the inverse of the non linearity (full scale \f$2^{\mathrm{CTRL\_FIXED\_OMEGA}}\f$)
+   * \return output of the inverse of the non linearity (full scale \f$2^{\mathrm{CTRL\_FIXED\_U}}\f$)
+   */
+  raw_t phi_inv(const raw_t omega) const;
+
+  /** \brief Main loop of the controller, on the raw numbers
+   *
+   * \param reference required reference (full scale \f$2^{\mathrm{CTRL\_FIXED\_OMEGA}}\f$)
+   * \param measure measure from the system (full scale \f$2^{\mathrm{CTRL\_FIXED\_OMEGA}}\f$)
+   * \return the control (full scale \f$2^{\mathrm{CTRL\_FIXED\_U}}\f$)
+   */
+  raw_t step(const raw_t reference, const raw_t measure);
+
+  /** \brief Main loop of the controller
+   *
+   * Converts the inputs and the output of \p step: the interface of \p controller_t<float>.
+   *
+   * \param reference required reference
+   * \param measure measure from the system (or an observer)
+   * \return the current value of the input for controlling the speed
+   */
+  const float operator()(const float reference, const float measure) {
+    return T::to_float(step(T::from_float(reference, e_omega), T::from_float(measure, e_omega)), e_u);
+  }
+
+  /** \brief Resets the internal state of the controller */
+  const void reset();
+
+  /** \brief Resets the controller for a bumpless transfer
+   *
+   * As \p controller_t<float>::reset: the Smith predictor is at the equilibrium
+   * for \p u and the integral gives \f$u - \phi^{-1}(y)\f$.
+   *
+   * \param u the control applied to the system
+   * \param measure measure from the system (or an observer)
+   */
+  const void reset(const float u, const float measure);
 };
 
 #endif /* ESC_CONTROLLER_HPP */
\ No newline at end of file
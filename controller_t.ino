@@ -0,0 +1,93 @@
+#include "controller_t.hpp"
+
+template < typename T >
+typename T::raw_t controller_t< T >::phi(const raw_t u) const {
+  wide_t v = T::mac(T::widen(one_v), k, u);
+  raw_t root = T::root(v * (wide_t(1) << (e_v - 2 * e_root)));
+  return T::narrow(T::mac(0, g, T::sub(root, one_root)), e_g + e_root - e_omega);
+}
+
+template < typename T >
+typename T::raw_t controller_t< T >::phi_inv(const raw_t omega) const {
+  raw_t s = T::narrow(T::mac(T::widen(c1), c2, omega));
+  return T::narrow(T::mac(0, s, omega), e_slope + e_omega - e_u);
+}
+
+template < typename T >
+typename T::raw_t controller_t< T >::step(const raw_t reference, const raw_t measure) {
+  raw_t e = T::sat(wide_t(reference) - wide_t(measure) + wide_t(delay[N - n]) - wide_t(delay.back()));
+  raw_t u_fb = T::narrow(T::mac(T::mac(0, ki, T::narrow(ei)), kp, e), e_gain + e_omega - e_u);
+  raw_t u = T::add(phi_inv(reference), u_fb);  // u_ff + u_fb
+  if (u > u_max) {
+    u = u_max;
+    if (e < 0)
+      ei = T::mac(ei, dt, e);
+  } else if (u < u_min) {
+    u = u_min;
+    if (e > 0)
+      ei = T::mac(ei, dt, e);
+  } else {
+    ei = T::mac(ei, dt, e);
+  }
+
+  raw_t q = u;
+  if (q < 0)
+    q = 0;
+  if (q > one_u)
+    q = one_u;
+  x = T::mac(x, b, T::sub(q, T::narrow(x)));
+  delay.push_back(phi(T::narrow(x)));
+  return u;
+}
+
+template < typename T >
+const bool controller_t< T >::install(const ctrl_params_t& params) {
+  float t = float(ts);
+  float pk = 4 * params.c2 / (params.c1 * params.c1);
+  float pg = params.c1 / (2 * params.c2);
+  if (!(params.a > 0) || !(params.c1 > 0) || !(params.c2 > 0) || (params.delay > CTRL_SYSTEM_DELAY_MAX) ||
+      !(params.kp >= 0) || !(params.ki >= 0))
+    return false;
+  if (!(params.c1 + params.c2 * float(ctrl_scale(e_omega)) < float(ctrl_scale(e_slope))) ||
+      !(pk < float(ctrl_scale(e_k))) || !(1 + pk < float(ctrl_scale(2 * e_root))) || !(pg < float(ctrl_scale(e_g))) ||
+      !(params.kp + t * params.ki < float(ctrl_scale(e_gain))) || !(params.ki < float(ctrl_scale(e_gain))))
+    return false;
+
+  p = params;
+  c1 = T::from_float(p.c1, e_slope);
+  c2 = T::from_float(p.c2, e_slope - e_omega);
+  k = T::from_float(pk, e_k);
+  g = T::from_float(pg, e_g);
+  b = T::from_float(p.a * t / (1 + p.a * t), 0);
+  kp = T::from_float(p.kp + t * p.ki, e_gain);
+  ki = T::from_float(p.ki, e_gain);
+  n = p.delay / CTRL_TIMING;
+  n = (n < 1) ? 1 : ((n > N) ? N : n);
+  reset();
+  return true;
+}
+
+template < typename T >
+const void controller_t< T >::reset() {
+  ei = 0;
+  x = 0;
+  delay.fill(0);
+}
+
+template < typename T >
+const void controller_t< T >::reset(const float u, const float measure) {
+  raw_t q = T::from_float(u, e_u);
+  if (q > u_max)
+    q = u_max;
+  if (q < u_min)
+    q = u_min;
+  raw_t u_fb = T::sub(q, phi_inv(T::from_float(measure, e_omega)));
+  ei = T::widen(T::from_float((p.ki != 0) ? T::to_float(u_fb, e_u) / p.ki : 0, e_omega));
+
+  if (q < 0)
+    q = 0;
+  if (q > one_u)
+    q = one_u;
+  x = T::widen(q);
+  delay.fill(phi(q));
+}
@@ -8,10 +8,25 @@
  * Implementations of a cyclic array. It is possible to push back
  * in the array losing the first elements. It does not use allocation
  * but only a statically sized array.
+ *
+ * The size is a constant of the compiler: the position in the array is
+ * wrapped with a mask when the size is a power of two, and with a
+ * comparison otherwise (the AVR has no division, a remainder is a
+ * software routine).
  */
 
 #include <Arduino.h>
 
+/** \brief Contiguous part of a cyclic array
+ *
+ * \tparam T type of the elements (\p const for reading)
+ */
+template < typename T >
+struct span_t {
+  T* data;     /**< First element */
+  size_t size; /**< Number of the elements */
+};
+
 /** \brief Cyclic array implementation
  *
  * The Cyclic array implementation allows to have a queue of elements
@@ -23,30 +38,42 @@
  */
 template < typename T, size_t N >
 class cyclic_array_t {
+  static_assert(N > 0, "cyclic_array_t: the array must have at least one element");
+
+  static const bool pow2 = (N & (N - 1)) == 0; /**< The size is a power of two (wrap with a mask) */
+
   T data[N];     /**< Actual data */
   size_t offset; /**< Current offset for data */
 
+  /** \brief Wraps a position in the internal array
+   *
+   * \param i a position in \f$[0, 2N)\f$
+   * \return the position in \f$[0, N)\f$
+   */
+  static inline size_t wrap(size_t i) {
+    if (pow2)
+      return i & (N - 1);
+    return (i >= N) ? i - N : i;
+  }
+
   /** \brief Returns the data index from the rolling index
    *
    * The functions evaluates the actual position in \p data
-   * by using a remainder operation. If on \p AVR (e.g. Arduino)
-   * the function returns an index even if the parameter is out
-   * of bound.
-   * For compilers capable of handling exceptions, it will raise
-   * an \p std::out_of_bound exception for index greter than size.
+   * without divisions (see \p wrap). The index must be
+   * in \f$[0, N)\f$: it is not checked.
    *
    * \param idx required index on the cyclic array
    * \return the internal array index
    */
   inline size_t index(size_t idx) const {
-    return (offset + idx) % size;
+    return wrap(offset + idx);
   }
 
  public:
-  const size_t size; /**< Constant representing the size of the cyclic array */
+  static constexpr size_t size = N; /**< Constant representing the size of the cyclic array */
 
   /** \brief Empty constructor */
-  cyclic_array_t() : offset(0), size(N) {  }
+  cyclic_array_t() : offset(0) {  }
   /** \brief Filling constructor
    *
    * The constructor fills the underlay array with data included
@@ -54,13 +81,13 @@ class cyclic_array_t {
    *
    * \param value element for filling the array
    */
-  cyclic_array_t(T value) : offset(0), size(N) { fill(value); }
+  cyclic_array_t(T value) : offset(0) { fill(value); }
   /** \brief Copy constructor
    *
    * Creates a new cycling array making a copy of an existing one
    * \param other the origin array
    */
-  cyclic_array_t(const cyclic_array_t< T, N >& other) : size(N) { copy(other); }
+  cyclic_array_t(const cyclic_array_t< T, N >& other) { copy(other); }
 
   /** \brief Append element to the end (overwriting the first one)
    *
@@ -72,8 +99,8 @@ class cyclic_array_t {
    * \return the current instance
    */
   cyclic_array_t< T, N >& push_back(T value) {
-    this->front() = value;
-    offset = (offset + 1) % size;
+    data[offset] = value;
+    offset = wrap(offset + 1);
     return *this;
   }
 
@@ -90,8 +117,8 @@ class cyclic_array_t {
     if (this == &other)
       return *this;
     offset = other.offset;
-    for (size_t i = 0; i < size; i++)
-      (*this)[i] = other[i];
+    for (size_t i = 0; i < N; i++)
+      data[i] = other.data[i];
     return *this;
   }
 
@@ -165,11 +192,45 @@ class cyclic_array_t {
    * \return the reference to the filled array (\p this)
    */
   cyclic_array_t< T, N >& fill(T value) {
-    for (size_t i = 0; i < size; i++)
-      (*this)[i] = value;
+    for (size_t i = 0; i < N; i++)
+      data[i] = value;
     return (*this);
   }
+
+  /** \brief First contiguous part of the array
+   *
+   * The elements \f$0, \dots, N - 1\f$ are the ones of \p first_span
+   * followed by the ones of \p second_span: a bulk read is two plain
+   * loops on pointers, with no wrapping.
+   *
+   * @code
+   * cyclic_array_t< float, 20 > delay(0);
+   * float sum = 0;
+   * span_t< const float > a = delay.first_span(), b = delay.second_span();
+   * for (size_t i = 0; i < a.size; i++)
+   *   sum += a.data[i];
+   * for (size_t i = 0; i < b.size; i++)
+   *   sum += b.data[i];
+   * @endcode
+   *
+   * \return the elements from the front, up to the end of the internal array
+   */
+  span_t< const T > first_span() const {
+    span_t< const T > s = {data + offset, N - offset};
+    return s;
+  }
+  /** \brief Second contiguous part of the array (see \p first_span)
+   *
+   * \return the elements from the start of the internal array, up to the back (may be empty)
+   */
+  span_t< const T > second_span() const {
+    span_t< const T > s = {data, offset};
+    return s;
+  }
 };
 
+template < typename T, size_t N >
+constexpr size_t cyclic_array_t< T, N >::size;
+
 
 #endif /* CYCLIC_ARRAY_T_HPP */
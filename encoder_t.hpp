@@ -10,34 +10,104 @@
  * The class implements the software representation of the
  * Encoder sensor of the car. It takes a PWM as input and calculate the angular 
  * velocity of the wheel.
+ *
+ * There are two estimations of the speed:
+ *  - the high gain observer on the angle, updated each \p ENCODER_TIMING
+ *    with the edges counted in the period (\p get_omega), or on the angle
+ *    interpolated with the edge timing (see \p ENCODER_SPEED). The observer
+ *    can be replaced by a Kalman filter, that gives also the variance of
+ *    the speed (\p get_variance)
+ *  - the period between the edges, from the count and the timestamp of the
+ *    last edge published by the interrupt routine (\p get_omega_edge). At low
+ *    speed there are few edges (or none) in an \p ENCODER_TIMING period, and
+ *    the count is very coarse, while the period between two edges is measured
+ *    with the resolution of \p micros (4 us)
+ *
+ * The interrupt routine does not queue the timestamp of each edge for the
+ * loop: the M/T speed needs only the first and the last edge of the period,
+ * and the last edge of a period is the first one of the next. A consistent
+ * snapshot of the count and the timestamp of the last edge (6 bytes, see
+ * \p pwm_reader_base_t::last_edge) gives the same speed as a queue, at any
+ * number of edges, without drops. A queue would need a slot for each edge of
+ * an \p ENCODER_TIMING period at the top speed (about 40 at 300 rad/s, 160
+ * bytes for each wheel), and the loop would pay for draining it.
+ *
+ * The edges are read through the pin change interrupts (\p pwm_reader_t), or
+ * through the input capture units of timers 4 and 5 if \p ENCODER_INPUT_CAPTURE
+ * is defined (\p capture_reader_t, the timestamps have a resolution of 0.5 us
+ * and no latency of the interrupt routine).
+ *
+ * The angle and both speeds have the sign of the direction of the wheel, that
+ * is selected by \p ENCODER_DIRECTION: the ESC command (\p loop takes it at
+ * each iteration), or the second channel of a quadrature encoder, read by
+ * the interrupt routine of the first one (\p pwm_reader_t::quadrature). The
+ * high gain observer is linear: the signed angle gives the signed speed.
+ *
+ * The position of the wheel is a 32 bit odometer of edges, updated with the
+ * (modular) difference of the 16 bit counter of the interrupt routine. The
+ * observer runs on the angle in the current revolution: at each revolution the
+ * origin of the angle and of the observer are moved together
+ * (\p high_gain_obs_t::rebase), thus the float angle never grows, and its
+ * resolution does not decay in long sessions.
+ *
+ * The observer of the two wheels is shared (\p encoder_pair_t): the encoders
+ * measure the angles, and a single two channel observer updates both wheels
+ * in one pass, with one read of each coefficient.
  */
 
 #include "configurations.hpp"
-#ifdef HG_L3
-#include "high_gain_obs_t.hpp"
+#if ENCODER_SPEED == ENCODER_SPEED_KF
+#include "kalman_obs_t.hpp"
 #else
-#include "high_gain_obs2_t.hpp"
+#include "high_gain_obs_t.hpp"
 #endif
+#ifdef ENCODER_INPUT_CAPTURE
+#include "capture_reader_t.hpp"
+#else
 #include "pwm_reader_t.hpp"
+#endif
 #include "types.hpp"
 
+#ifdef ENCODER_INPUT_CAPTURE
+template < pin_t PIN >
+using encoder_reader_t = capture_reader_t< PIN >;          /**< Reader of the encoder edges */
+#define ENCODER_TICKS_PER_MS CAPTURE_TICKS_PER_MS           /**< Time base of the edge timestamps */
+#else
+template < pin_t PIN >
+using encoder_reader_t = pwm_reader_t< PIN >;              /**< Reader of the encoder edges */
+#define ENCODER_TICKS_PER_MS PWM_READER_TICKS_PER_MS        /**< Time base of the edge timestamps */
+#endif
+
+#if ENCODER_SPEED == ENCODER_SPEED_KF
+typedef kalman_obs_t< ENCODER_TIMING, 2 > encoder_obs_t;   /**< Observer of the angles of the two wheels */
+#else
+typedef high_gain_obs_t< hg_gains_t::order, ENCODER_TIMING, HG_TYPE, hg_gains_t, 2 >
+    encoder_obs_t; /**< Observer of the angles of the two wheels (order 3 if HG_L3 is defined) */
+#endif
+
 /** /brief Class for the Encoder sensors
  *
  * The class implements the software representation of the
  * Encoder sensor of the car. It takes a
  * PWM as input and calculate the angular velocity of the wheel.
+ *
+ * \tparam PIN the pin of the encoder (the reader is checked at compile time)
  */
-
+template < pin_t PIN >
 class encoder_t {
-  counter_t counter;                 /**< incremental counter of the encoder ppr */
-  pwm_reader_t pwm;                  /**< pwm object for reading the value of signal wave */
-#ifdef HG_L3
-  high_gain_obs_t< LOOP_TIMING > hg; /**< High gain filter for encoder reading (order 2 since HG_L3 is undefined) */
-#else
-  high_gain_obs2_t< LOOP_TIMING > hg; /**< High gain filter for encoder reading (order 3 since HG_L3 is defined) */
-#endif
-  float theta;                       /**< Internal position for the wheel (direct read from the sensor) */
-  float omega;                       /**< High gain estimation of the wheel speed */
+  ticks_t counter;                   /**< edges of the encoder in the last loop */
+  odometer_t ticks;                  /**< position of the wheel (edges, with the direction) */
+  odometer_t base;                   /**< position of the origin of \p theta (a multiple of a revolution) */
+  int8_t direction;                  /**< direction of the last edges (1 forward, -1 backward) */
+  encoder_reader_t< PIN > reader;    /**< reader of the edges of the encoder signal */
+  float theta;                       /**< Angle of the wheel in the current revolution */
+  float rebased;                     /**< Shift of the origin of \p theta in the last loop (rad, 0 if none) */
+  float omega;                       /**< Estimation of the wheel speed */
+  ticks_t edge_count;                /**< Count of the last edge seen by the loop */
+  timing_t edge_last;                /**< Timestamp of the last edge seen by the loop */
+  timing_t edge_period;              /**< Last measured period between edges (\p ENCODER_TICKS_PER_MS, 0 if not valid) */
+  bool edge_valid;                   /**< \p edge_last belongs to the current sequence of edges */
+  float omega_edge;                  /**< Wheel speed from the period between edges */
 
  public:
   /** \brief Constructor for the esc object
@@ -52,49 +122,310 @@ class encoder_t {
    * At the end of the constructor the \p alarm is called in order to be sure
    * to write immediately on the PWM the idle values.
    *
-   * \param pin_ value of the pin used for the encoder
    */
-  encoder_t(pin_t pin_)
-      : pwm(pwm_reader_t(pin_)),
-        counter(0),
-#ifdef HG_L3
-        hg(high_gain_obs_t< LOOP_TIMING >(HG_L1, HG_L2, HG_L3, HG_EPSILON)),
-#else
-        hg(high_gain_obs2_t< LOOP_TIMING >(HG_L1, HG_L2, HG_EPSILON)),
-#endif
+  encoder_t()
+      : counter(0),
+        ticks(0),
+        base(0),
+        direction(1),
         theta(0),
-        omega(0) {}
+        rebased(0),
+        omega(0),
+        edge_count(0),
+        edge_last(0),
+        edge_period(0),
+        edge_valid(false),
+        omega_edge(0) {}
   
-  /** \brief Main loop to run for reading the encoders
+#if ENCODER_DIRECTION == ENCODER_DIRECTION_QUADRATURE
+  /** \brief Reads the direction from the second channel of the encoder
+   *
+   * \tparam PIN_B the pin of the second channel (on the port of \p PIN)
+   */
+  template < pin_t PIN_B >
+  void quadrature() {
+    reader.template quadrature< PIN_B >();
+  }
+#endif
+
+  /** \brief Measure of the loop for reading the encoders
    * 
-   * The main loop runs the loop of the high gain observer, after reading 
-   * the angle offset of the encoder (in terms of counts)
-   */
-  void loop() {
-    theta += (M_PI * float(pwm.get_counter()) / float(ENCODER_QUANTIZATION));
-    pwm.reset_counter();
-    counter = pwm.get_counter();
-    omega = hg(theta);
+   * Reads the angle offset of the encoder (in terms of counts), and
+   * gives the input of the observer, that depends on \p ENCODER_SPEED.
+   * The owner of the observer (\p encoder_pair_t) shifts it by \p get_rebase,
+   * runs it, and gives back the speed with \p estimate. With
+   * \p ENCODER_SPEED_MT there is no observer, and the speed is set here.
+   *
+   * With \p ENCODER_DIRECTION_ESC the direction follows the sign of
+   * \p command, but only when the wheel is still (no edges in this loop and
+   * no valid edge sequence): the ESC brakes before reversing, and the wheel
+   * keeps turning in the old direction while the command is already reversed.
+   * With the other sources the command is ignored.
+   *
+   * \param command the direction of the ESC command (see \p esc_t::direction)
+   * \return the input of the observer (the angle in the current revolution)
+   */
+  float measure(const int8_t command = 0) {
+    int8_t last = direction;
+    odometer_t steps;
+    edge_stamp_t edge = reader.last_edge();
+    counter = edge.count - edge_count;
+    edge_count = edge.count;
+#if ENCODER_DIRECTION == ENCODER_DIRECTION_QUADRATURE
+    steps = reader.take_steps();
+    if (steps)
+      direction = (steps > 0) ? 1 : -1;
+#else
+#if ENCODER_DIRECTION == ENCODER_DIRECTION_ESC
+    if (command && !counter && !edge_valid)
+      direction = command;
+#endif
+    steps = direction * odometer_t(counter);
+#endif
+    if (direction != last)
+      edge_valid = false;  // the period sequence restarts after a reversal
+    ticks = odometer_t(uint32_t(ticks) + uint32_t(steps));
+    omega_edge = direction * period_speed(edge.time);
+    theta = wrap();
+#if ENCODER_SPEED == ENCODER_SPEED_MT
+    omega = omega_edge;
+#elif ENCODER_SPEED == ENCODER_SPEED_MT_HG
+    return theta + direction * interpolation();
+#endif
+    return theta;
   }
 
+  /**
+   * \brief Sets the wheel speed estimated by the observer
+   * \param w the wheel speed (rad/s)
+   */
+  void estimate(const float w) { omega = w; }
+
+  /**
+   * \brief Returns the shift of the origin of the angle in the last \p measure
+   *
+   * The state of the observer must be shifted by the same angle (see
+   * \p high_gain_obs_t::rebase).
+   *
+   * \return the shift (rad, 0 if the angle is in the same revolution)
+   */
+  const float get_rebase() const { return rebased; }
+
   /** 
    * \brief Returns the wheel speed (estimation of the high gain observer)
    * \return the wheel speed
    */
   const float get_omega() const { return omega; }
+  /**
+   * \brief Returns the variance of the wheel speed
+   *
+   * The variance is estimated only by the Kalman filter (\p ENCODER_SPEED_KF):
+   * it is the steady state variance of the model (\p kalman_obs_t::variance).
+   *
+   * \return the variance of \p get_omega ((rad/s)\f$^2\f$), infinity if not estimated
+   */
+  const float get_variance() const {
+#if ENCODER_SPEED == ENCODER_SPEED_KF
+    return encoder_obs_t::variance();
+#else
+    return INFINITY;
+#endif
+  }
   /**
    * \brief Returns the current angle of the wheel (raw value)
-   * \return the current raw value of wheel angle
+   * \return the angle of the wheel in the current revolution, in \f$[0, 2\pi)\f$
    */ 
   const float get_theta() const { return theta; }
+  /**
+   * \brief Returns the odometer of the wheel
+   *
+   * The odometer wraps after \f$2^{31}\f$ edges (days at full speed): the
+   * difference between two readings is exact if taken as a modular
+   * (unsigned) difference.
+   *
+   * \return the position of the wheel in edges (\f$\pi / \mathrm{ENCODER\_QUANTIZATION}\f$ rad)
+   */
+  const odometer_t get_ticks() const { return ticks; }
+  /**
+   * \brief Returns the wheel speed from the period between the edges
+   *
+   * The speed is the angle of the edges of the last loop, over
+   * the time between the last edge of the previous loop and the last edge
+   * of this one. If there are no new edges, the speed is bounded by
+   * the time elapsed since the last edge (the next edge cannot be closer),
+   * and it goes to zero after \p ENCODER_EDGE_TIMEOUT.
+   *
+   * \return the wheel speed (rad/s, with the sign of the direction)
+   */
+  const float get_omega_edge() const { return omega_edge; }
 
   /** \brief Resets the state of the encoder (use for mode change) */
   inline void stop() {
+    base = ticks;
     theta = 0.0;
     omega = 0.0;
-    hg.reset();
-    pwm.reset_counter();
+    rebased = 0.0;
+    reader.reset_counter();
+    edge_count = reader.last_edge().count;
+    edge_valid = false;
+    edge_period = 0;
+    omega_edge = 0.0;
+  }
+
+ private:
+  /** \brief Angle of the wheel in the current revolution
+   *
+   * If the wheel left the revolution of \p base, \p base is moved by whole
+   * revolutions, and the observer with it (see \p get_rebase).
+   *
+   * \return the angle from \p base (rad)
+   */
+  float wrap() {
+    static const odometer_t revolution = 2 * ENCODER_QUANTIZATION;  // edges
+    static const float edge = M_PI / float(ENCODER_QUANTIZATION);    // rad
+    odometer_t rel = odometer_t(uint32_t(ticks) - uint32_t(base));
+    rebased = 0.0;
+    if ((rel < 0) || (rel >= revolution)) {
+      odometer_t shift = rel - ((rel % revolution) + revolution) % revolution;
+      base = odometer_t(uint32_t(base) + uint32_t(shift));
+      rebased = -float(shift) * edge;
+      rel -= shift;
+    }
+    return float(rel) * edge;
+  }
+
+  /** \brief Angle turned since the last edge
+   *
+   * The M/T speed times the time since the last edge: the angle is
+   * within the edge, thus it is at most one edge.
+   *
+   * \return the magnitude of the angle since the last edge (rad)
+   */
+  float interpolation() const {
+    static const float edge = M_PI / float(ENCODER_QUANTIZATION);  // rad
+    if (!edge_valid)
+      return 0.0;
+    float angle = fabs(omega_edge) * float(reader.now() - edge_last) / (1000.0 * ENCODER_TICKS_PER_MS);
+    return (angle < edge) ? angle : edge;
+  }
+
+  /** \brief Evaluates the speed from the last edge
+   *
+   * The \p counter edges of this loop are between the last edge of the
+   * previous loop and \p last: the speed is their angle over the time
+   * between the two (the M/T method). The count and the timestamp are
+   * a single snapshot, thus the speed is exact at any number of edges.
+   * The first edge of a sequence has no previous edge, and it only starts
+   * the measure.
+   *
+   * \param last the timestamp of the last edge (valid if \p counter is not zero)
+   * \return the magnitude of the wheel speed from the period between edges (rad/s)
+   */
+  float period_speed(const timing_t last) {
+    static const float edge_angle = 1000.0 * ENCODER_TICKS_PER_MS * M_PI / float(ENCODER_QUANTIZATION);  // rad tick / s
+    if (counter) {
+      timing_t start = edge_last;
+      bool valid = edge_valid;
+      edge_last = last;
+      edge_valid = true;
+      if (valid && (last != start)) {
+        edge_period = (last - start) / counter;
+        return edge_angle * float(counter) / float(last - start);
+      }
+    }
+    if (!edge_valid)
+      return 0.0;
+
+    timing_t elapsed = reader.now() - edge_last;
+    if (elapsed >= timing_t(ENCODER_EDGE_TIMEOUT) * ENCODER_TICKS_PER_MS) {
+      edge_valid = false;
+      edge_period = 0;
+      return 0.0;
+    }
+    if (edge_period && (elapsed > edge_period))
+      return edge_angle / float(elapsed);
+    return fabs(omega_edge);
+  }
+};
+
+/** \brief The encoders of the two wheels, with a shared observer
+ *
+ * The two wheels have the same observer (same order, time step and gains):
+ * a single two channel observer (\p encoder_obs_t) updates both, in one
+ * interleaved pass that reads each coefficient once (see \p high_gain_obs_t).
+ * Each loop measures the left and the right wheel, then it runs the observer.
+ *
+ * Usage example:
+ * @code
+ * encoder_pair_t< L_WHEEL_ENCODER, R_WHEEL_ENCODER > enc;
+ * enc.loop(esc->direction());
+ * float omega_l = enc.left().get_omega();
+ * @endcode
+ *
+ * \tparam PIN_L the pin of the encoder of the left wheel
+ * \tparam PIN_R the pin of the encoder of the right wheel
+ */
+template < pin_t PIN_L, pin_t PIN_R >
+class encoder_pair_t {
+  encoder_t< PIN_L > enc_l; /**< Encoder of the left wheel (channel 0 of \p obs) */
+  encoder_t< PIN_R > enc_r; /**< Encoder of the right wheel (channel 1 of \p obs) */
+  encoder_obs_t obs;        /**< Observer of both wheels (high gain or Kalman, see \p ENCODER_SPEED) */
+
+ public:
+  /** \brief Constructor, the encoders are at rest */
+  encoder_pair_t() : enc_l(), enc_r(), obs() {}
+
+#if ENCODER_DIRECTION == ENCODER_DIRECTION_QUADRATURE
+  /** \brief Reads the directions from the second channels of the encoders
+   *
+   * \tparam PIN_LB the pin of the second channel of the left encoder
+   * \tparam PIN_RB the pin of the second channel of the right encoder
+   */
+  template < pin_t PIN_LB, pin_t PIN_RB >
+  void quadrature() {
+    enc_l.template quadrature< PIN_LB >();
+    enc_r.template quadrature< PIN_RB >();
   }
+#endif
+
+  /** \brief Main loop to run for reading the encoders
+   *
+   * Measures both the wheels (\p encoder_t::measure) and runs the observer
+   * on the two angles, in a single step.
+   *
+   * \param command the direction of the ESC command (see \p esc_t::direction)
+   */
+  void loop(const int8_t command = 0) {
+    float y[2] = {enc_l.measure(command), enc_r.measure(command)};
+#if ENCODER_SPEED != ENCODER_SPEED_MT
+    float w[2];
+    if (enc_l.get_rebase() != 0.0)
+      obs.rebase(enc_l.get_rebase(), 0);
+    if (enc_r.get_rebase() != 0.0)
+      obs.rebase(enc_r.get_rebase(), 1);
+    obs(y, w);
+    enc_l.estimate(w[0]);
+    enc_r.estimate(w[1]);
+#endif
+  }
+
+  /** \brief Resets the state of the encoders and of the observer (use for mode change) */
+  void stop() {
+    enc_l.stop();
+    enc_r.stop();
+    obs.reset();
+  }
+
+  /**
+   * \brief The encoder of the left wheel
+   * \return the encoder of the left wheel
+   */
+  const encoder_t< PIN_L >& left() const { return enc_l; }
+  /**
+   * \brief The encoder of the right wheel
+   * \return the encoder of the right wheel
+   */
+  const encoder_t< PIN_R >& right() const { return enc_r; }
 };
 
 #endif /* ENCODER_T_HPP */
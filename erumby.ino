@@ -44,27 +44,31 @@
 #include "configurations.hpp"
 
 #include "erumby_t.hpp"
+#include "profiler_t.hpp"
+#include "ticker_t.hpp"
 
-volatile erumby_t * erumby;
-pulse_t tic, toc;
+erumby_t * erumby;
 char debug;
 
 void setup() {
   pinMode(8, OUTPUT);
   debug = 0;
-  erumby = erumby_t::create_erumby();
-  tic = micros();
-  toc = tic;
+  erumby = const_cast< erumby_t* >(erumby_t::create_erumby());
+  ticker_t::init();
 }
 
 void loop() {
-  toc = micros();
-  
-  if ((pulse_t)(toc - tic) >= (LOOP_TIMING * 1000)) {
+  if (ticker_t::pending()) {
     debug ^= 1;
     digitalWrite(8, debug);
 
+#ifdef PROFILER
+    uint16_t t0 = profiler_t::start();
     erumby->loop();
-    tic = toc;
+    profiler_t::stop(PROFILER_LOOP, t0);
+#else
+    erumby->loop();
+#endif
+    ticker_t::done();
   }
 }
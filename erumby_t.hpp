@@ -18,9 +18,13 @@
 #include "encoder_t.hpp"
 #include "esc_t.hpp"
 #include "radio_t.hpp"
+#include "scheduler_t.hpp"
 #include "servo_t.hpp"
 
 #include "controller_t.hpp"
+#include "tuner_t.hpp"
+
+#define ERUMBY_TASKS 10 /**< Size of the task table of the scheduler */
 
 /** \brief Class for the ERUMBY robot
  *
@@ -34,20 +38,44 @@
  */
 class erumby_t : public erumby_base_t {
   static erumby_t* self;   /**< Pointer to singleton instance */
+  scheduler_t< ERUMBY_TASKS > tasks; /**< Multi rate scheduler of the modules */
+
+  /** \brief Registers the modules in the scheduler
+   *
+   * Each module is registered in its rate group (see \p configurations.hpp):
+   *
+   * | Task                      | Modes  | Period           | Phase |
+   * |---------------------------|--------|------------------|-------|
+   * | `enc`                     | all    | `ENCODER_PERIOD` | 0     |
+   * | `comm->loop_auto`         | Auto   | `CONTROL_PERIOD` | 0     |
+   * | `comm->loop_secure`       | Secure | `CONTROL_PERIOD` | 0     |
+   * | `radio`                   | all    | `RADIO_PERIOD`   | 1     |
+   * | `esc->loop`               | Auto   | `CONTROL_PERIOD` | 0     |
+   * | `esc->stop`               | Secure | `CONTROL_PERIOD` | 0     |
+   * | `servo->loop`             | Auto   | `SERVO_PERIOD`   | 2     |
+   * | `servo->stop`             | Secure | `SERVO_PERIOD`   | 2     |
+   * | `profiler_t::report`      | all    | `PROFILER_PERIOD`| 3     |
+   *
+   * The phases are clamped to the period of the group. In each tick the tasks
+   * run in the same order of the single rate loop.
+   */
+  void init_tasks();
+
+  bool closed_loop; /**< The last traction command was a speed (\p speed), not a PWM */
+  tuner_t tuner;    /**< Identification of the speed controller (\p tune) */
 
  public:
   esc_t* esc;              /**< esc pointer to the class */
   servo_t* servo;          /**< servo pointer to the class  */
   radio_t* radio;          /**<  radio pointer to the class */
-  encoder_t* enc_l;        /**< left encoder pointer to the class */
-  encoder_t* enc_r;        /**< right encoder pointer to the class */
+  encoder_pair_t< L_WHEEL_ENCODER, R_WHEEL_ENCODER >* enc; /**< encoders (left and right) pointer to the class */
   communication_t* comm;   /**< Communication singleton with Raspberry pi */
-  controller_t speed_ctrl; /**< Controller for the wheel speed (ESC) */
+  controller_t<> speed_ctrl; /**< Controller for the wheel speed (ESC) */
 
   /** \brief Constructor for the erumby object
    *
    * The erumby object call the costructors of the different
-   * object: esc, servo, radio, enc_r, enc_l and initialize
+   * object: esc, servo, radio, enc and initialize
    * the timers in order to allow the comunications
    */
   erumby_t();
@@ -72,7 +100,8 @@ class erumby_t : public erumby_base_t {
   /** \brief Main loop for erumby
    *
    * In the main loop the mode is read (\see MODE ) and in relations with this
-   * a different execution mode is selected.
+   * a different execution mode is selected. It must be called once per base
+   * tick (\p LOOP_TIMING): each module runs in its own rate group.
    */
   void loop();
 
@@ -80,15 +109,15 @@ class erumby_t : public erumby_base_t {
    * state and the sensors are read.
    *
    * In this modality the following command are executed:
-   *  - enc_l: update the value of theta position and angular velocity
-   *           of the left encoder with an hig gain filter (\p encoder_t main loop).
-   *  - enc_r: update the value of theta position and angular velocity
-   *           of the right encoder with an hig gain filter (\p encoder_t main loop).
+   *  - enc: update the value of theta position and angular velocity
+   *         of both the encoders with an hig gain filter (\p encoder_pair_t main loop).
    *  - comm: write in the i2c the value of the angular velocity of the wheel and
    *          the esc current value (\p communication_t::loop_secure)
    *  - radio: read the pwm value of the radio (\p radio_t)
    *  - esc: set the stop mode for the esc (\p esc_t::stop)
    *  - servo: set the stop mode for the servo (\p servo_t::stop)
+   *
+   * Only the tasks due in the current tick are executed (see \p init_tasks).
    */
   void loop_secure();
 
@@ -96,10 +125,8 @@ class erumby_t : public erumby_base_t {
    *  and the sensors are read
    *
    * In this modality the following command are executed:
-   *  - enc_l: update the value of theta position and angular velocity
-   *           of the left encoder with an hig gain filter (\p encoder_t::loop).
-   *  - enc_r: update the value of theta position and angular velocity
-   *           of the right encoder with an hig gain filter (\p encoder_t::loop).
+   *  - enc: update the value of theta position and angular velocity
+   *         of both the encoders with an hig gain filter (\p encoder_pair_t::loop).
    *  - comm: write in the i2c the value of the angular velocity of the wheel and
    *          the esc current value. The steering and traction value are read from
    *          the i2c and this are the current set value for the motors (\p communication_t::loop_auto)
@@ -108,6 +135,8 @@ class erumby_t : public erumby_base_t {
    *         for the esc (\p esc_t::loop)
    *  - servo: it sets as current value the one read by the communication
    *           for the servo (\p servo_t::loop)
+   *
+   * Only the tasks due in the current tick are executed (see \p init_tasks).
    */
   void loop_auto();
 
@@ -115,12 +144,13 @@ class erumby_t : public erumby_base_t {
    * state and the sensors are reset.
    *
    * In this modality the following command are executed:
-   *  - enc_l: the value of the state in the high gain filter
-   *           are reset(\p encoder_t::stop).
-   *  - enc_r: the value of the state in the high gain filter
-   *           are reset(\p encoder_t::stop).
+   *  - enc: the value of the state in the high gain filter
+   *         are reset(\p encoder_pair_t::stop).
    *  - esc: set the stop mode for the esc (\p esc_t::stop)
    *  - servo: set the stop mode for the servo (\p servo_t::stop)
+   *
+   * The speed controller is open: the next \p speed seeds it from the idle
+   * command (as after \p traction). The mode changes of \p radio_t pass from here.
    */
   void stop();
 
@@ -145,13 +175,13 @@ class erumby_t : public erumby_base_t {
    *
    * \return the angular velocity of the left encoder
    */
-  float omega_l() override { return enc_l->get_omega(); }
+  float omega_l() override { return enc->left().get_omega(); }
 
   /** \brief The value of the angular velocity of the right encoder
    *
    * \return the angular velocity of the right encoder
    */
-  float omega_r() override { return enc_r->get_omega(); }
+  float omega_r() override { return enc->right().get_omega(); }
 
   /** \brief The value of the mean angular velocity of the encoders
    *
@@ -159,6 +189,18 @@ class erumby_t : public erumby_base_t {
    */
   float omega() override { return (omega_l() + omega_r()) / 2.0; }
 
+  /** \brief The variance of the angular velocity of the left encoder
+   *
+   * \return the variance of the angular velocity of the left encoder (infinity if not estimated)
+   */
+  float variance_l() override { return enc->left().get_variance(); }
+
+  /** \brief The variance of the angular velocity of the right encoder
+   *
+   * \return the variance of the angular velocity of the right encoder (infinity if not estimated)
+   */
+  float variance_r() override { return enc->right().get_variance(); }
+
   /** \brief The value of the pwm value of the esc
    *
    * \return the pwm value of the esc
@@ -167,11 +209,14 @@ class erumby_t : public erumby_base_t {
 
   /** \brief set the esc pwm
    * set the pwm value of the esc, this value is saturated in
-   * DUTY_ESC_MAX, DUTY_ESC_MIN boundary
+   * DUTY_ESC_MAX, DUTY_ESC_MIN boundary. It opens the loop of the
+   * speed controller (see \p speed).
    *
    * \param v the value of PWM to write on the ESC
    */
   void traction(cmd_t v) override {
+    closed_loop = false;
+    tuner.reset();
     if ((v <= esc->get_max()) && (v >= esc->get_min()))
       esc->set(v);
   }
@@ -182,13 +227,38 @@ class erumby_t : public erumby_base_t {
    * block scheme the signal `e`), evaluates the feed forward and closed loop
    * control action and updates the smith predictor.
    *
+   * When the loop was open (after \p traction or \p stop), the controller
+   * is first seeded with the command on the ESC (bumpless transfer, see
+   * \p controller_t::reset).
+   *
    * \param v the speed value for the speed controller
    */
   void speed(float v) {
+    tuner.reset();
+    if (!closed_loop) {
+      speed_ctrl.reset(esc->get_ctrl(), omega());
+      closed_loop = true;
+    }
     float u = speed_ctrl(v, omega());
     esc->ctrl(u);
   }
 
+  /** \brief Identification of the speed controller
+   *
+   * Runs a step of the experiment of \p tuner_t on the ESC (in open loop):
+   * the first call starts it, and at the end the identified parameters are
+   * installed in the speed controller (\p controller_t::install). Then the
+   * ESC stays idle until another command (\p traction, \p speed or \p stop),
+   * and a new call starts a new experiment only after it.
+   */
+  void tune() override;
+
+  /**
+   * \brief State of the identification of the speed controller
+   * \return the state of \p tuner_t
+   */
+  tune_state_t tuning() override { return tuner.state(); }
+
   /** \brief The value of the pwm value of the servo
    *
    * \return the pwm value of the servo
@@ -5,7 +5,7 @@ erumby_t * erumby_t::self = NULL;
 erumby_t const * erumby_t::create_erumby() {
   if (erumby_t::self) return erumby_t::self;
   erumby_t::self = new erumby_t();
-  if (!erumby) {
+  if (!erumby_t::self) {
     while(1) {
       // This is critical... if we cannot create a pointer in setup, how
       // can we print the error in console?
@@ -15,24 +15,25 @@ erumby_t const * erumby_t::create_erumby() {
   return erumby_t::self;
 }
 
-erumby_t::erumby_t()  {
+erumby_t::erumby_t() : closed_loop(false) {
   InitTimersSafe();
 
   esc = new esc_t(this);
   if (!esc)
     this->alarm("Boot", "Cannot start ESC module");
+  speed_ctrl.limits(esc->ctrl_min(), esc->ctrl_max());
 
   servo = new servo_t(this);
   if (!servo)
     this->alarm("Boot", "Cannot start SERVO module");
 
-  enc_r = new encoder_t(R_WHEEL_ENCODER);
-  if (!enc_r)
-    this->alarm("Boot", "Cannot start ENCODER module (right, 1/2)");
+  enc = new encoder_pair_t< L_WHEEL_ENCODER, R_WHEEL_ENCODER >();
+  if (!enc)
+    this->alarm("Boot", "Cannot start ENCODER module");
 
-  enc_l = new encoder_t(L_WHEEL_ENCODER);
-  if (!enc_l)
-    this->alarm("Boot", "Cannot start ENCODER module (left, 2/2)");
+#if ENCODER_DIRECTION == ENCODER_DIRECTION_QUADRATURE
+  enc->quadrature< L_WHEEL_ENCODER_B, R_WHEEL_ENCODER_B >();
+#endif
   
   radio = radio_t::create_radio(this);
   if (!radio)
@@ -41,7 +42,28 @@ erumby_t::erumby_t()  {
   comm = communication_t::create_comms(this);
   if (!comm)
     this->alarm("Boot", "Cannot start COMMS module");
-    
+
+  init_tasks();
+}
+
+void erumby_t::init_tasks() {
+  bool ok = true;
+#ifdef PROFILER
+  profiler_t::init();
+#endif
+  ok &= tasks.add([]() -> void { self->enc->loop(self->esc->direction()); }, TASK_ALL, ENCODER_PERIOD, 0, "enc");
+  ok &= tasks.add([]() -> void { self->comm->loop_auto(); }, TASK_AUTO, CONTROL_PERIOD, 0, "comm_auto");
+  ok &= tasks.add([]() -> void { self->comm->loop_secure(); }, TASK_SECURE, CONTROL_PERIOD, 0, "comm_secure");
+  ok &= tasks.add([]() -> void { self->radio->loop(); }, TASK_ALL, RADIO_PERIOD, 1 % RADIO_PERIOD, "radio");
+  ok &= tasks.add([]() -> void { self->esc->loop(); }, TASK_AUTO, CONTROL_PERIOD, 0, "esc");
+  ok &= tasks.add([]() -> void { self->esc->stop(); }, TASK_SECURE, CONTROL_PERIOD, 0, "esc_stop");
+  ok &= tasks.add([]() -> void { self->servo->loop(); }, TASK_AUTO, SERVO_PERIOD, 2 % SERVO_PERIOD, "servo");
+  ok &= tasks.add([]() -> void { self->servo->stop(); }, TASK_SECURE, SERVO_PERIOD, 2 % SERVO_PERIOD, "servo_stop");
+#ifdef PROFILER
+  ok &= tasks.add([]() -> void { profiler_t::report(); }, TASK_ALL, PROFILER_PERIOD, 3 % PROFILER_PERIOD, "profiler");
+#endif
+  if (!ok)
+    this->alarm("Boot", "Cannot register the tasks in the scheduler");
 }
 
 void erumby_t::loop() {
@@ -56,31 +78,31 @@ void erumby_t::loop() {
   loop_secure();
 }
 
-void erumby_t::loop_secure() {
-  enc_l->loop();
-  enc_r->loop();
-  comm->loop_secure();
-  radio->loop();
-  esc->stop();
-  servo->stop();
-}
+void erumby_t::loop_secure() { tasks.run(TASK_SECURE); }
 
-void erumby_t::loop_auto() {
-  enc_l->loop();
-  enc_r->loop();
-  comm->loop_auto();
-  radio->loop();
-  esc->loop();
-  servo->loop();
-}
+void erumby_t::loop_auto() { tasks.run(TASK_AUTO); }
 
 void erumby_t::stop() {
-  enc_l->stop();
-  enc_r->stop();
+  closed_loop = false;
+  tuner.reset();
+  enc->stop();
   esc->stop();
   servo->stop();
 }
 
+void erumby_t::tune() {
+  closed_loop = false;
+  if (tuner.state() == TuneIdle)
+    tuner.start();
+  if (tuner.state() != TuneRunning) {
+    esc->ctrl(esc->ctrl_min());
+    return;
+  }
+  esc->ctrl(tuner(omega()));
+  if ((tuner.state() == TuneDone) && !speed_ctrl.install(tuner.params()))
+    tuner.fail();
+}
+
 void erumby_t::alarm(const char* who, const char* what) {
   char led = 0;
   esc->stop();
@@ -164,6 +164,19 @@ class esc_t {
    * \return the value that is currently wirtten in pwm 
    */
   inline const cmd_t get() const { return value; }
+  /**
+   * \brief Returns the value currently on the PWM pin as a control
+   * \return the inverse of the map of \p ctrl, in [\p ctrl_min, \p ctrl_max] (0 below idle)
+   */
+  inline const float get_ctrl() const {
+    float v = float(value - get_idle()) / float(get_max() - get_idle());
+    return (v < ctrl_min()) ? ctrl_min() : ((v > ctrl_max()) ? ctrl_max() : v);
+  }
+  /**
+   * \brief Returns the direction of the value currently on the PWM pin
+   * \return 1 above idle (forward), -1 below idle (reverse), 0 at idle
+   */
+  inline const int8_t direction() const { return (value > get_idle()) - (value < get_idle()); }
   /** 
    * \brief Returns minimum PWM value possible 
    * \return the minim value for the ESC that it is possible to write
@@ -182,6 +195,16 @@ class esc_t {
    * \see DUTY_ESC_IDLE
    */
   inline const cmd_t get_idle() const { return DUTY_ESC_IDLE; }
+  /** 
+   * \brief Returns the lowest value of \p ctrl that moves the PWM
+   * \return the control that maps to \p DUTY_ESC_IDLE, below it \p ctrl saturates
+   */
+  inline const float ctrl_min() const { return 0.0; }
+  /** 
+   * \brief Returns the highest value of \p ctrl that moves the PWM
+   * \return the control that maps to \p DUTY_ESC_MAX, above it \p ctrl saturates
+   */
+  inline const float ctrl_max() const { return 1.0; }
 };
 
 #endif /* ESC_T_HPP */
\ No newline at end of file
@@ -0,0 +1,226 @@
+#ifndef FIXED_T_HPP
+#define FIXED_T_HPP
+
+/**
+ * \file fixed_t.hpp
+ * \author Matteo Ragni
+ *
+ * **Saturating fixed point arithmetic (Q15 and Q31)**
+ *
+ * The ATmega2560 has no floating point unit: a float multiplication or addition
+ * is a software routine of about a hundred cycles, while the core multiplies
+ * two bytes in hardware in two cycles. A fixed point number is an integer \f$q\f$
+ * with \f$F\f$ fractional bits, that represents \f$q \, 2^{-F}\f$ (in \f$[-1, 1)\f$).
+ * A physical value \f$v\f$ is stored normalized to a full scale \f$2^E\f$:
+ *
+ * \f[
+ *   q = \mathrm{round}(v \, 2^{F - E})
+ * \f]
+ *
+ * | Type    | Storage   | Products  | Resolution (normalized) |
+ * |---------|-----------|-----------|-------------------------|
+ * | \p q15_t| `int16_t` | `int32_t` | \f$ 2^{-15} \f$         |
+ * | \p q31_t| `int32_t` | `int64_t` | \f$ 2^{-31} \f$         |
+ *
+ * All the operations saturate at the bounds of the storage, instead of
+ * wrapping: an overflow gives the largest value with the right sign. The
+ * products are accumulated in the wide type, and rounded to the storage only once.
+ */
+
+#include <Arduino.h>
+
+/** \brief Fixed point number in the Q format
+ *
+ * The class has only static functions on the raw integers: the numbers are
+ * stored as plain integers (\p raw_t) by the users, that know the full scale
+ * of each value.
+ *
+ * Usage example:
+ * @code
+ * q15_t::raw_t a = q15_t::from_float(0.5, 0);    // 16384
+ * q15_t::raw_t b = q15_t::from_float(100.0, 8);  // 100 / 256 of the full scale
+ * q15_t::wide_t acc = q15_t::mac(0, a, b);
+ * float c = q15_t::to_float(q15_t::narrow(acc), 8);  // 50.0
+ * @endcode
+ *
+ * \tparam S integer type for the storage (signed)
+ * \tparam W integer type for the products (signed, at least twice the bits of \p S)
+ * \tparam F fractional bits (the bits of \p S minus one)
+ */
+template < typename S, typename W, uint8_t F >
+class fixed_t {
+ public:
+  typedef S raw_t;  /**< Storage type */
+  typedef W wide_t; /**< Type of the products and of the accumulators */
+
+  static const S max = S((S(1) << (F - 1)) - 1 + (S(1) << (F - 1))); /**< Largest value (\f$1 - 2^{-F}\f$) */
+  static const S min = -max - 1;                                     /**< Smallest value (\f$-1\f$) */
+  static const W wide_max = W((W(1) << (2 * F)) - 1 + (W(1) << (2 * F))); /**< Largest value of an accumulator */
+  static const W wide_min = -wide_max - 1;                           /**< Smallest value of an accumulator */
+
+  /** \brief Saturating sum
+   *
+   * \param a first addend
+   * \param b second addend
+   * \return \f$a + b\f$, saturated
+   */
+  static inline S add(const S a, const S b) { return sat(W(a) + W(b)); }
+
+  /** \brief Saturating difference
+   *
+   * \param a minuend
+   * \param b subtrahend
+   * \return \f$a - b\f$, saturated
+   */
+  static inline S sub(const S a, const S b) { return sat(W(a) - W(b)); }
+
+  /** \brief Saturating product, rounded to the nearest
+   *
+   * \param a first factor
+   * \param b second factor
+   * \return \f$a b\f$, saturated
+   */
+  static inline S mul(const S a, const S b) { return narrow(W(a) * W(b)); }
+
+  /** \brief Multiply and accumulate, with saturation of the accumulator
+   *
+   * \param acc the accumulator (\f$2F\f$ fractional bits)
+   * \param a first factor
+   * \param b second factor
+   * \return \f$acc + a b\f$, saturated
+   */
+  static inline W mac(const W acc, const S a, const S b) {
+    W p = W(a) * W(b);
+    if ((p > 0) && (acc > wide_max - p))
+      return wide_max;
+    if ((p < 0) && (acc < wide_min - p))
+      return wide_min;
+    return acc + p;
+  }
+
+  /** \brief Value as an accumulator
+   *
+   * \param a the value
+   * \return \p a with \f$2F\f$ fractional bits (exact)
+   */
+  static inline W widen(const S a) { return W(a) * (W(1) << F); }
+
+  /** \brief Rounds an accumulator to the storage
+   *
+   * \param acc the accumulator (\f$2F\f$ fractional bits)
+   * \return the nearest value with \f$F\f$ fractional bits, saturated
+   */
+  static inline S narrow(const W acc) {
+    if (acc >= wide_max - (W(1) << (F - 1)))
+      return max;
+    return sat((acc + (W(1) << (F - 1))) >> F);
+  }
+
+  /** \brief Rounds an accumulator to the storage, changing the full scale
+   *
+   * The accumulator of a product \f$a b\f$ has the full scale \f$2^{E_a + E_b}\f$:
+   * the function returns it with the full scale \f$2^E\f$ of the result.
+   *
+   * \param acc the accumulator (\f$2F\f$ fractional bits)
+   * \param shift \f$E_a + E_b - E\f$ (positive shifts left)
+   * \return the nearest value with \f$F\f$ fractional bits, saturated
+   */
+  static inline S narrow(const W acc, const int8_t shift) {
+    if (shift <= 0)
+      return narrow(acc >> -shift);
+    if (acc > (wide_max >> shift))
+      return max;
+    if (acc < (wide_min >> shift))
+      return min;
+    return narrow(acc * (W(1) << shift));
+  }
+
+  /** \brief Square root of an accumulator, rounded to the nearest
+   *
+   * An accumulator with the full scale \f$2^{2E}\f$ gives a square root with
+   * the full scale \f$2^E\f$ (bit by bit, \f$F + 1\f$ iterations, no divisions).
+   *
+   * \param acc the accumulator (\f$2F\f$ fractional bits)
+   * \return \f$\sqrt{acc}\f$ with \f$F\f$ fractional bits, saturated (zero if \p acc is negative)
+   */
+  static S root(const W acc) {
+    W op = acc;
+    W res = 0;
+    W one = W(1) << (2 * F);
+    if (acc <= 0)
+      return 0;
+    while (one > op)
+      one >>= 2;
+    while (one != 0) {
+      if (op >= res + one) {
+        op -= res + one;
+        res = (res >> 1) + one;
+      } else {
+        res >>= 1;
+      }
+      one >>= 2;
+    }
+    return sat((op > res) ? res + 1 : res);
+  }
+
+  /** \brief Saturates a wide value to the storage
+   *
+   * \param v the value (\f$F\f$ fractional bits)
+   * \return \p v in \f$[\mathrm{min}, \mathrm{max}]\f$
+   */
+  static inline S sat(const W v) {
+    if (v > W(max))
+      return max;
+    if (v < W(min))
+      return min;
+    return S(v);
+  }
+
+  /** \brief Converts a float, with full scale \f$2^E\f$
+   *
+   * \param v the value
+   * \param exponent the exponent \f$E\f$ of the full scale
+   * \return the nearest fixed point value, saturated
+   */
+  static S from_float(const float v, const int8_t exponent) {
+    float q = ldexp(v, int(F) - exponent);
+    if (q >= float(max))
+      return max;
+    if (q <= float(min))
+      return min;
+    return S(lround(q));
+  }
+
+  /** \brief Converts a constant, with full scale \f$2^E\f$ (at compile time)
+   *
+   * \param v the value
+   * \param exponent the exponent \f$E\f$ of the full scale
+   * \return the nearest fixed point value, saturated
+   */
+  static constexpr S constant(const double v, const int8_t exponent) {
+    return round_constant(scale_constant(v, int(F) - exponent));
+  }
+
+  /** \brief Converts to float, with full scale \f$2^E\f$
+   *
+   * \param q the fixed point value
+   * \param exponent the exponent \f$E\f$ of the full scale
+   * \return the value
+   */
+  static float to_float(const S q, const int8_t exponent) { return ldexp(float(q), exponent - int(F)); }
+
+ private:
+  /** \brief \f$v \, 2^e\f$ (as \p ldexp, at compile time) */
+  static constexpr double scale_constant(const double v, const int e) {
+    return (e == 0) ? v : ((e > 0) ? scale_constant(v * 2.0, e - 1) : scale_constant(v / 2.0, e + 1));
+  }
+  /** \brief Nearest integer, saturated (as \p from_float, at compile time) */
+  static constexpr S round_constant(const double q) {
+    return (q >= double(max)) ? max : ((q <= double(min)) ? min : S((q < 0) ? q - 0.5 : q + 0.5));
+  }
+};
+
+typedef fixed_t< int16_t, int32_t, 15 > q15_t; /**< Q15: 16 bit, products in 32 bit */
+typedef fixed_t< int32_t, int64_t, 31 > q31_t; /**< Q31: 32 bit, products in 64 bit */
+
+#endif /* FIXED_T_HPP */
@@ -5,9 +5,9 @@
  * \file high_gain_obs_t.hpp
  * \author Matteo Ragni, Matteo Cocetti, Davide Piscini
  *
- * The class implements an high gain observer for encoders that estimates the current
- * angle of the wheel closing the loop on the measured angle on the encoder, using the
- * following structure:
+ * The class implements an high gain observer of order \f$N\f$ for encoders that estimates
+ * the current angle of the wheel closing the loop on the measured angle on the encoder,
+ * using the following structure:
  *
  * \f{align}
  *   \dot{\hat{x}} & = A \hat{x} + E(\varepsilon) L (C \hat{x} - y) \\
@@ -15,156 +15,368 @@
  *   \dot{\hat{y}} & = C' x
  * \f}
  *
- * where:
+ * where \f$A\f$ is the chain of \f$N\f$ integrators:
  *
  * \f{align}
- *  A & = \begin{bmatrix} 0 & 1 & 0 \\ 0 & 0 & 1 \\ 0 & 0 & 0 \end{bmatrix} \\
- *  C & = \begin{bmatrix} 1 & 0 & 0 \end{bmatrix} \\
- *  C' & = \begin{bmatrix} 0 & 1 & 0 \end{bmatrix} \\
- *  L & = \begin{bmatrix} l_1 \\ l_2 \\ l_3 \end{bmatrix} \\
- *  E(\varepsilon) & = \begin{bmatrix}
- *    \varepsilon^{-1} & 0 & 0 \\
- *    0 & \varepsilon^{-2} & 0 \\
- *    0 & 0 & \varepsilon^{-3}
- *  \end{bmatrix}
+ *  A & = \begin{bmatrix} 0 & 1 & & \\ & \ddots & \ddots & \\ & & 0 & 1 \\ & & & 0 \end{bmatrix} \\
+ *  C & = \begin{bmatrix} 1 & 0 & \dots & 0 \end{bmatrix} \\
+ *  C' & = \begin{bmatrix} 0 & 1 & \dots & 0 \end{bmatrix} \\
+ *  L & = \begin{bmatrix} l_1 & \dots & l_N \end{bmatrix}^\top \\
+ *  E(\varepsilon) & = \mathrm{diag}(\varepsilon^{-1}, \dots, \varepsilon^{-N})
  * \f}
  *
  * where the parameters can be configured using Matlab for example:
  *
  * \f[
- *  L = - \mathrm{lqr}(A^\top, C^\top, I_{3 \times 3}, 1)^\top
+ *  L = - \mathrm{lqr}(A^\top, C^\top, I_{N \times N}, 1)^\top
  * \f]
  *
  * and than using \f$\varepsilon\f$ for changing the bandwidth of the filter.
  *
+ * The discretization (Backward Euler) is evaluated by the compiler and stored in
+ * the flash: the observer keeps in RAM only its state. The gains are given by a
+ * class (\p hg_gains_t reads them from \p configurations.hpp). The observer runs in
+ * float, or in fixed point (Q15 and Q31, see \p fixed_t), selected by the template
+ * parameter.
+ *
  * \warning Remember that the bandwidth may be limited by the integration timestep.
  */
 
 #include <Arduino.h>
+#include "configurations.hpp"
+#include "fixed_t.hpp"
 #include "types.hpp"
 
-/** \brief Implementation of a discretized High Gain Observer
+/** \brief Gains of the observer from \p configurations.hpp
  *
- * The class implements an high gain observer for encoders that estimates the current
- * angle of the wheel closing the loop on the measured angle on the encoder, using the
- * following structure:
+ * The order is 3 if \p HG_L3 is defined, else 2. Other gains are given
+ * by a class with the same members.
+ */
+struct hg_gains_t {
+#ifdef HG_L3
+  static constexpr size_t order = 3; /**< Number of gains */
+#else
+  static constexpr size_t order = 2; /**< Number of gains */
+#endif
+  /**
+   * \brief High gain value (usually in \f$(0, 1)\f$)
+   * \return \p HG_EPSILON
+   */
+  static constexpr double epsilon() { return HG_EPSILON; }
+  /**
+   * \brief Observer parameter of a state
+   * \param i index of the state (from 0)
+   * \return \f$l_{i + 1}\f$
+   */
+#ifdef HG_L3
+  static constexpr double l(const size_t i) { return (i == 0) ? HG_L1 : ((i == 1) ? HG_L2 : HG_L3); }
+#else
+  static constexpr double l(const size_t i) { return (i == 0) ? HG_L1 : HG_L2; }
+#endif
+};
+
+/**
+ * \brief Full scale of a state in the fixed point observers
  *
- * \f{align}
- *   \dot{\hat{x}} & = A \hat{x} + E(\varepsilon) L (C \hat{x} - y) \\
- *   \hat{y} & = C x \\
- *   \dot{\hat{y}} & = C' x
- * \f}
+ * The angle, the speed and the acceleration have \p HG_FIXED_THETA,
+ * \p HG_FIXED_OMEGA and \p HG_FIXED_ALPHA. The higher derivatives grow by
+ * \f$2^{\mathrm{HG\_FIXED\_ALPHA} - \mathrm{HG\_FIXED\_OMEGA}}\f$ at each order.
+ *
+ * \param i index of the state
+ * \return the exponent of the full scale
+ */
+constexpr int8_t hg_exponent(const size_t i) {
+  return (i == 0) ? HG_FIXED_THETA
+                  : ((i == 1) ? HG_FIXED_OMEGA : HG_FIXED_ALPHA + int8_t(i - 2) * (HG_FIXED_ALPHA - HG_FIXED_OMEGA));
+}
+
+/** \brief Arithmetic of the observer: the one of \p fixed_t
+ *
+ * \tparam T a \p fixed_t (the specialization for \p float has the same interface)
+ */
+template < typename T >
+struct hg_arithmetic_t : T {};
+
+/** \brief Arithmetic of the observer in float
+ *
+ * The same interface of \p fixed_t: the full scales are ignored, and nothing saturates.
+ */
+template <>
+struct hg_arithmetic_t< float > {
+  typedef float raw_t;  /**< Storage type */
+  typedef float wide_t; /**< Type of the products and of the accumulators */
+
+  static inline float sub(const float a, const float b) { return a - b; }                  /**< \f$a - b\f$ */
+  static inline float add(const float a, const float b) { return a + b; }                  /**< \f$a + b\f$ */
+  static inline float mac(const float acc, const float a, const float b) { return acc + a * b; } /**< \f$acc + a b\f$ */
+  static inline float widen(const float a) { return a; }                                   /**< The value */
+  static inline float narrow(const float acc) { return acc; }                              /**< The value */
+  static inline float from_float(const float v, const int8_t) { return v; }               /**< The value */
+  static inline float to_float(const float v, const int8_t) { return v; }                 /**< The value */
+  static constexpr float constant(const double v, const int8_t) { return float(v); }      /**< The value, rounded to float */
+};
+
+/** \brief Reads a coefficient from the flash
+ * \param p address of the coefficient
+ * \return the coefficient
+ */
+inline float hg_load(const float* p) { return pgm_read_float(p); }
+/** \brief Reads a coefficient from the flash
+ * \param p address of the coefficient
+ * \return the coefficient
+ */
+inline int16_t hg_load(const int16_t* p) { return int16_t(pgm_read_word(p)); }
+/** \brief Reads a coefficient from the flash
+ * \param p address of the coefficient
+ * \return the coefficient
+ */
+inline int32_t hg_load(const int32_t* p) { return int32_t(pgm_read_dword(p)); }
+
+/** \brief Discretization of the observer, at compile time
  *
- * where:
+ * The Backward Euler step \f$(I - t_s (A + E L C)) \hat{x}_k = \hat{x}_{k-1} - t_s E L y_k\f$
+ * has a closed form solution, thanks to the structure of \f$A\f$. With
+ * \f$\lambda_i = l_{i+1} \varepsilon^{-(i+1)}\f$ and
+ * \f$q_i = \sum_{j \geq i} t_s^{j - i + 1} \lambda_j\f$ (indexes from 0):
  *
  * \f{align}
- *  A & = \begin{bmatrix} 0 & 1 & 0 \\ 0 & 0 & 1 \\ 0 & 0 & 0 \end{bmatrix} \\
- *  C & = \begin{bmatrix} 1 & 0 & 0 \end{bmatrix} \\
- *  C' & = \begin{bmatrix} 0 & 1 & 0 \end{bmatrix} \\
- *  L & = \begin{bmatrix} l_1 \\ l_2 \\ l_3 \end{bmatrix} \\
- *  E(\varepsilon) & = \begin{bmatrix}
- *    \varepsilon^{-1} & 0 & 0 \\
- *    0 & \varepsilon^{-2} & 0 \\
- *    0 & 0 & \varepsilon^{-3}
- *  \end{bmatrix}
+ *   \hat{x}_k & = A_L \hat{x}_{k-1} - B_L y_k \\
+ *   A_L(i, c) & = [c \geq i] \, t_s^{c - i} + t_s^c \frac{q_i}{1 - q_0} \\
+ *   B_L(i) & = \frac{q_i}{1 - q_0}
  * \f}
  *
- * where the parameters can be configured using Matlab for example:
+ * The first column of \f$A_L\f$ is \f$[1, 0, \dots]^\top + B_L\f$, thus the step is
+ * evaluated in the innovation form, with \f$e_k = y_k - \hat{x}_{0,k-1}\f$:
  *
  * \f[
- *  L = - \mathrm{lqr}(A^\top, C^\top, I_{3 \times 3}, 1)^\top
+ *   \hat{x}_{i,k} = [i = 0] \, \hat{x}_{0,k-1} + \sum_{c \geq 1} A_L(i, c) \hat{x}_{c,k-1} - B_L(i) e_k
  * \f]
  *
- * and than using \f$\varepsilon\f$ for changing the bandwidth of the filter.
+ * The angle is multiplied only through the innovation, that is small, and a constant
+ * offset on the angle and on the first state does not change the other states (see
+ * \p high_gain_obs_t::rebase). The coefficients are the \f$N \times N\f$ matrix with
+ * \f$-B_L\f$ in the first column and \f$A_L\f$ in the others, scaled to the full
+ * scales of the states (\p hg_exponent) in fixed point.
  *
- * \warning Remember that the bandwidth may be limited by the integration timestep.
+ * \tparam N order of the observer
+ * \tparam MILLIS discretization time step in milliseconds
+ * \tparam T arithmetic of the observer
+ * \tparam G gains of the observer
+ */
+template < size_t N, timing_t MILLIS, typename T, typename G >
+struct hg_discretization_t {
+  typedef typename hg_arithmetic_t< T >::raw_t raw_t; /**< Type of the coefficients */
+  static constexpr size_t size = N * N;               /**< Number of the coefficients */
+
+  /** \brief Time step of the filter (s) */
+  static constexpr double ts() { return double(MILLIS) / 1000.0; }
+  /** \brief Power with a natural exponent */
+  static constexpr double power(const double b, const size_t e) { return (e == 0) ? 1.0 : b * power(b, e - 1); }
+  /** \brief \f$\lambda_i\f$ */
+  static constexpr double lambda(const size_t i) { return G::l(i) / power(G::epsilon(), i + 1); }
+  /** \brief \f$q_i\f$ */
+  static constexpr double q(const size_t i) { return (i >= N) ? 0.0 : ts() * (lambda(i) + q(i + 1)); }
+  /** \brief \f$A_L(i, c)\f$ */
+  static constexpr double al(const size_t i, const size_t c) {
+    return ((c >= i) ? power(ts(), c - i) : 0.0) + power(ts(), c) * q(i) / (1.0 - q(0));
+  }
+  /** \brief \f$B_L(i)\f$ */
+  static constexpr double bl(const size_t i) { return q(i) / (1.0 - q(0)); }
+  /** \brief Coefficient of the step, by rows
+   * \param k index of the coefficient (row \f$k / N\f$, column \f$k \bmod N\f$)
+   * \return the coefficient, scaled to the full scales of the states
+   */
+  static constexpr raw_t entry(const size_t k) {
+    return (k % N == 0) ? hg_arithmetic_t< T >::constant(-bl(k / N), hg_exponent(k / N) - hg_exponent(0))
+                        : hg_arithmetic_t< T >::constant(al(k / N, k % N), hg_exponent(k / N) - hg_exponent(k % N));
+  }
+};
+
+/** \brief Table of the coefficients of a discretization, in the flash
  *
+ * The table is a constant initialized by the compiler, one for each
+ * discretization (all the observers with the same parameters share it).
+ *
+ * \tparam D the discretization (\p hg_discretization_t)
+ * \tparam I the indexes of the coefficients
+ */
+template < typename D, typename I = typename make_indices_t< D::size >::type >
+struct hg_table_t;
+
+/** \brief Table of the coefficients of a discretization, in the flash
+ *
+ * \tparam D the discretization (\p hg_discretization_t)
+ * \tparam I the indexes of the coefficients
+ */
+template < typename D, size_t... I >
+struct hg_table_t< D, indices_t< I... > > {
+  static const typename D::raw_t data[sizeof...(I)]; /**< The coefficients (in the flash, read with \p hg_load) */
+};
+
+template < typename D, size_t... I >
+const typename D::raw_t hg_table_t< D, indices_t< I... > >::data[sizeof...(I)] PROGMEM = {D::entry(I)...};
+
+/** \brief One step of the observer on \p C channels, interleaved
+ *
+ * Each coefficient is read once from the flash and applied to all the
+ * channels (see \p high_gain_obs_t::step).
+ *
+ * \tparam A arithmetic of the observer (\p hg_arithmetic_t)
+ * \tparam N order of the observer
+ * \tparam C number of channels
+ */
+template < typename A, size_t N, size_t C >
+struct hg_pass_t {
+  /** \brief Evaluates the step
+   * \param c the coefficients (in the flash)
+   * \param x the states, updated
+   * \param y the observations
+   */
+  static void run(const typename A::raw_t* c, typename A::raw_t (&x)[N][C], const typename A::raw_t (&y)[C]);
+};
+
+#ifdef HOST_BUILD
+/** \brief One step of the float observer on two channels, with SIMD (host only)
+ *
+ * The two channels are the two lanes of a vector (GCC vector extensions), and the
+ * states are interleaved by channel: state \f$i\f$ of both channels is a vector. The
+ * operations are the ones of the scalar pass, in the same order, thus the result
+ * is the same. The AVR core has no vector unit, and it runs the scalar pass.
+ *
+ * \tparam N order of the observer
+ */
+template < size_t N >
+struct hg_pass_t< hg_arithmetic_t< float >, N, 2 > {
+  typedef float lanes_t __attribute__((vector_size(2 * sizeof(float)))); /**< Two floats */
+  /** \brief Evaluates the step (see \p hg_pass_t::run) */
+  static void run(const float* c, float (&x)[N][2], const float (&y)[2]);
+};
+#endif
+
+/** \brief Implementation of a discretized High Gain Observer of order N
+ *
+ * The class implements an high gain observer for encoders that estimates the current
+ * angle of the wheel closing the loop on the measured angle on the encoder (see
+ * \p hg_discretization_t for the discretization, and the file documentation for
+ * the model).
+ *
+ * In fixed point the angle is normalized to \f$2^{\mathrm{HG\_FIXED\_THETA}}\f$, the
+ * speed to \f$2^{\mathrm{HG\_FIXED\_OMEGA}}\f$ and the acceleration to
+ * \f$2^{\mathrm{HG\_FIXED\_ALPHA}}\f$, and the states saturate at the full scale.
+ * The scaled coefficients must be in \f$(-1, 1)\f$, or they saturate.
+ *
+ * The observer can run \p C independent channels with the same discretization
+ * (e.g. the two wheels, see \p encoder_pair_t) in a single pass: each coefficient
+ * is read once for all the channels, and the states are interleaved by channel.
+ * On the host, the float pass on two channels uses the SIMD unit.
+ *
+ * Usage example:
+ * @code
+ * high_gain_obs_t< 2, ENCODER_TIMING > hg;
+ * float omega = hg(theta);
+ *
+ * high_gain_obs_t< 2, ENCODER_TIMING, q15_t > hq;
+ * float omega_q = hq(theta);  // conversions included
+ * q15_t::raw_t w = hq.step(q15_t::from_float(theta, HG_FIXED_THETA));  // omega / 2^HG_FIXED_OMEGA
+ *
+ * high_gain_obs_t< 2, ENCODER_TIMING, float, hg_gains_t, 2 > wheels;
+ * float theta_lr[2] = {theta_l, theta_r}, omega_lr[2];
+ * wheels(theta_lr, omega_lr);
+ * @endcode
+ *
+ * \warning In Q15 the slow poles are rounded with a large relative error:
+ * the accuracy depends on the full scales (see the bounds of \p hg_compare).
+ *
+ * \tparam N order of the observer (at least 2)
  * \tparam MILLIS discretization time step in milliseconds
+ * \tparam T arithmetic of the observer: \p float, or a \p fixed_t (\p q15_t, \p q31_t)
+ * \tparam G gains of the observer (see \p hg_gains_t)
+ * \tparam C number of channels
  */
-template < timing_t MILLIS >
+template < size_t N, timing_t MILLIS, typename T = float, typename G = hg_gains_t, size_t C = 1 >
 class high_gain_obs_t {
-  const static float ts = float(MILLIS) / 1000.0; /**< Time step of the filter */
-  const static size_t state_size = 3;             /**< State size for the observer */
-  float x[state_size];                            /**< Internal state of the filter */
-  float xp[state_size];                           /**< next step of the filter, required for the implicit integration */
-  float Al[state_size * state_size];              /**< Implicit discretization of the filter, matrix \f$A_L\f$ */
-  float Bl[state_size];                           /**< Implicit discretization of the filter, matrix \f$B_L\f$ */
+  static_assert(N >= 2, "high_gain_obs_t: the order is at least 2 (angle and speed)");
+  static_assert(N <= G::order, "high_gain_obs_t: the gains have less parameters than the order");
+  static_assert(C >= 1, "high_gain_obs_t: at least one channel");
+
+  typedef hg_arithmetic_t< T > A;                       /**< Arithmetic of the observer */
+  typedef hg_discretization_t< N, MILLIS, T, G > D;     /**< Discretization of the observer */
+  typedef hg_table_t< D > coefficients;                 /**< Coefficients of the step, in the flash */
+  typedef typename A::raw_t raw_t;                      /**< Type of the states */
+
+  static_assert(D::entry(D::size - 1) == D::entry(D::size - 1),
+                "high_gain_obs_t: the discretization must be a finite constant");
+
+  raw_t x[N][C]; /**< Internal state of the filter, interleaved by channel (normalized in fixed point) */
 
  public:
-  /** \brief Empty constructor, it initialize an empty filter */
-  high_gain_obs_t() : x({0}), xp({0}), Al({0}), Bl({0}){};
-  /** \brief Constructor with parameters
+  /** \brief Empty constructor, the state is zero (the discretization is in the flash) */
+  high_gain_obs_t() : x() {}
+
+  /** \brief Evaluates the next step of all the channels (in the arithmetic of the observer)
    *
-   * The constructor evaluates also the discretized version of the matrices.
-   * The discretization is done using a Backward Euler:
-   * \f[
-   *  s = \frac{z - 1}{t_s z}
-   * \f]
+   * \param y last observations (normalized to \f$2^{\mathrm{HG\_FIXED\_THETA}}\f$ in fixed point)
+   * \param w the derivatives of the inputs (normalized to \f$2^{\mathrm{HG\_FIXED\_OMEGA}}\f$ in fixed point)
+   */
+  void step(const raw_t (&y)[C], raw_t (&w)[C]);
+
+  /** \brief Evaluates the next step of the filter (in the arithmetic of the observer, one channel)
    *
-   * \param l1_ observer parameter for state 1
-   * \param l2_ observer parameter for state 2
-   * \param l3_ observer parameter for state 3
-   * \param epsilon_ high gain value (usually in \f$(0, 1)\f$)
+   * \param y last observation (normalized to \f$2^{\mathrm{HG\_FIXED\_THETA}}\f$ in fixed point)
+   * \return the derivative of the input (normalized to \f$2^{\mathrm{HG\_FIXED\_OMEGA}}\f$ in fixed point)
    */
-  high_gain_obs_t(const float l1_, const float l2_, const float l3_, const float epsilon_);
+  raw_t step(const raw_t y);
 
-  /** \brief Evaluates the next step of the filter
+  /** \brief Evaluates the next step of all the channels
+   *
+   * \param y last observations
+   * \param w the derivatives of the inputs estimated by the high gain
+   */
+  void operator()(const float (&y)[C], float (&w)[C]);
+
+  /** \brief Evaluates the next step of the filter (one channel)
    *
    * Receives a new observation to evaluate a new step using the implicit step.
    * It returns:
    * \f[
-   *  C' \hat{x} = \dot{\hat{y}} 
+   *  C' \hat{x} = \dot{\hat{y}}
    * \f]
    *
    * \param y last observation
    * \return the derivative of the input estimated by the high gain
    */
-  const float operator()(const float y);
+  const float operator()(const float y) { return A::to_float(step(A::from_float(y, hg_exponent(0))), hg_exponent(1)); }
 
-  /** \brief Resets the internal state of the filter */
+  /** \brief Resets the internal state of the filter (all the channels) */
   void reset();
 
-  /** 
-   * \brief Attribute reader for the internal state of the filter 
-   * \param i index of the i-th state of the filter
-   * \return the value of the i-th state of the filter
+  /** \brief Shifts the origin of the observed angle
+   *
+   * Adds \p delta to the estimation of the input (the first state). The
+   * discretization is invariant to a constant offset on the input and on the
+   * first state, thus if the next observations are shifted by \p delta as well,
+   * the other states (the derivatives) are unchanged. It keeps the input small
+   * when it grows without bound (e.g. the angle of a wheel).
+   *
+   * \param delta the shift of the input
+   * \param c the channel
    */
-  const float& operator[](const size_t i) const { return x[i]; }
-  /** 
-   * \brief Attribute accessor for the internal state of the filter 
+  void rebase(const float delta, const size_t c = 0);
+
+  /**
+   * \brief Attribute reader for the internal state of the filter
    * \param i index of the i-th state of the filter
-   * \return a settable reference to the i-th state of the filter
+   * \param c the channel
+   * \return the value of the i-th state of the filter
    */
-  float& operator[](const size_t i) { return x[i]; }
+  const float state(const size_t i, const size_t c = 0) const { return A::to_float(x[i][c], hg_exponent(i)); }
 
- private:
-  /** \brief Evaluates the discretization of the filter
-   *
-   * This function evaluates the discretization of the following dynamical system:
-   * \f{align}
-   *   \dot{\hat{x}} & = (A + E(\varepsilon) L C) \hat{x} - E(\varepsilon) L y \\
-   *   \hat{y} & = C x
-   * \f}
-   * with the Backward Euler:
-   * \f[
-   *  s = \frac{z - 1}{t_s z}
-   * \f]
-   * Such that:
-   * \f[
-   *   \hat{x}_k = A_L \hat{x}_{k - 1} + B_L y_k
-   * \f]
-   * with:
-   * \f{align}
-   *   A_L & = (I_{3 \times 3} - t_s (A + E(\varepsilon) L C))^{-1} \\
-   *   B_L & = A_L E(\varepsilon) L t_s
-   * \f}
-   *
-   * \param l1_ observer parameter for state 1
-   * \param l2_ observer parameter for state 2
-   * \param l3_ observer parameter for state 3
-   * \param epsilon_ high gain value (usually in \f$(0, 1)\f$)
+  /**
+   * \brief Attribute reader for the internal state of the filter (first channel)
+   * \param i index of the i-th state of the filter
+   * \return the value of the i-th state of the filter
    */
-  void discretize(const float l1_, const float l2_, const float l3_, const float epsilon_);
+  const float operator[](const size_t i) const { return state(i); }
 };
 
-#endif /* HIGH_GIN_OBS_HPP */
\ No newline at end of file
+#endif /* HIGH_GIN_OBS_HPP */
@@ -1,55 +1,92 @@
 #include "high_gain_obs_t.hpp"
 
-template < timing_t MILLIS >
-high_gain_obs_t< MILLIS >::high_gain_obs_t(const float l1_, const float l2_, const float l3_, const float epsilon_)
-    : x({0}), xp({0}) {
-  discretize(l1_, l2_, l3_, epsilon_);
-};
-
-template < timing_t MILLIS >
-const float high_gain_obs_t< MILLIS >::operator()(const float y) {
-  xp[0] = Al[0] * x[0] + Al[1] * x[1] + Al[2] * x[2] - Bl[0] * y;
-  xp[1] = Al[3] * x[0] + Al[4] * x[1] + Al[5] * x[2] - Bl[1] * y;
-  xp[2] = Al[6] * x[0] + Al[7] * x[1] + Al[8] * x[2] - Bl[2] * y;
-
-  x[0] = xp[0];
-  x[1] = xp[1];
-  x[2] = xp[2];
-
-  return x[1];
+template < typename A, size_t N, size_t C >
+void hg_pass_t< A, N, C >::run(const typename A::raw_t* c, typename A::raw_t (&x)[N][C],
+                               const typename A::raw_t (&y)[C]) {
+  typename A::raw_t e[C];
+  typename A::raw_t xp[N][C];
+  typename A::wide_t acc[C];
+
+  for (size_t k = 0; k < C; k++)
+    e[k] = A::sub(y[k], x[0][k]);
+  for (size_t i = 0; i < N; i++) {
+    typename A::raw_t a = hg_load(c++);
+    for (size_t k = 0; k < C; k++)
+      acc[k] = A::mac((i == 0) ? A::widen(x[0][k]) : 0, a, e[k]);
+    for (size_t j = 1; j < N; j++) {
+      a = hg_load(c++);
+      for (size_t k = 0; k < C; k++)
+        acc[k] = A::mac(acc[k], a, x[j][k]);
+    }
+    for (size_t k = 0; k < C; k++)
+      xp[i][k] = A::narrow(acc[k]);
+  }
+  for (size_t i = 0; i < N; i++)
+    for (size_t k = 0; k < C; k++)
+      x[i][k] = xp[i][k];
+}
+
+#ifdef HOST_BUILD
+template < size_t N >
+void hg_pass_t< hg_arithmetic_t< float >, N, 2 >::run(const float* c, float (&x)[N][2], const float (&y)[2]) {
+  lanes_t v[N];
+  lanes_t xp[N];
+  lanes_t e;
+
+  for (size_t i = 0; i < N; i++)
+    __builtin_memcpy(&v[i], x[i], sizeof(lanes_t));
+  __builtin_memcpy(&e, y, sizeof(lanes_t));
+  e = e - v[0];
+  for (size_t i = 0; i < N; i++) {
+    lanes_t acc = (i == 0) ? v[0] : lanes_t{0, 0};
+    float a = hg_load(c++);
+    acc = acc + lanes_t{a, a} * e;
+    for (size_t j = 1; j < N; j++) {
+      a = hg_load(c++);
+      acc = acc + lanes_t{a, a} * v[j];
+    }
+    xp[i] = acc;
+  }
+  for (size_t i = 0; i < N; i++)
+    __builtin_memcpy(x[i], &xp[i], sizeof(lanes_t));
+}
+#endif
+
+template < size_t N, timing_t MILLIS, typename T, typename G, size_t C >
+void high_gain_obs_t< N, MILLIS, T, G, C >::step(const raw_t (&y)[C], raw_t (&w)[C]) {
+  hg_pass_t< A, N, C >::run(coefficients::data, x, y);
+  for (size_t k = 0; k < C; k++)
+    w[k] = x[1][k];
 }
 
-template < timing_t MILLIS >
-void high_gain_obs_t< MILLIS >::reset() {
-  x[0] = 0;
-  x[1] = 0;
-  x[2] = 0;
-  xp[0] = 0;
-  xp[1] = 0;
-  xp[2] = 0;
+template < size_t N, timing_t MILLIS, typename T, typename G, size_t C >
+typename hg_arithmetic_t< T >::raw_t high_gain_obs_t< N, MILLIS, T, G, C >::step(const raw_t y) {
+  static_assert(C == 1, "high_gain_obs_t: the scalar step is for a single channel");
+  raw_t in[1] = {y};
+  raw_t out[1];
+  step(in, out);
+  return out[0];
 }
 
-template < timing_t MILLIS >
-void high_gain_obs_t< MILLIS >::discretize(const float l1_, const float l2_, const float l3_, const float epsilon_) {
-  float l1 = l1_ / epsilon_;
-  float l2 = l2_ / (epsilon_ * epsilon_);
-  float l3 = l3_ / (epsilon_ * epsilon_ * epsilon_);
-
-  float ts_2 = ts * ts;
-  float ts_3 = ts_2 * ts;
-  float det = -l3 * ts_3 - l2 * ts_2 - l1 * ts + 1;
-
-  Al[0] = (1) / det;
-  Al[1] = (ts) / det;
-  Al[2] = (ts_2) / det;
-  Al[3] = (l3 * ts_2 + l2 * ts) / det;
-  Al[4] = (1 - l1 * ts) / det;
-  Al[5] = (-ts * (l1 * ts - 1)) / det;
-  Al[6] = (l3 * ts) / det;
-  Al[7] = (l3 * ts_2) / det;
-  Al[8] = (-l2 * ts_2 - l1 * ts + 1) / det;
-
-  Bl[0] = (ts * (l3 * ts_2 + l2 * ts + l1)) / det;
-  Bl[1] = (ts * (l2 + l3 * ts)) / det;
-  Bl[2] = (l3 * ts) / det;
-}
\ No newline at end of file
+template < size_t N, timing_t MILLIS, typename T, typename G, size_t C >
+void high_gain_obs_t< N, MILLIS, T, G, C >::operator()(const float (&y)[C], float (&w)[C]) {
+  raw_t in[C];
+  raw_t out[C];
+  for (size_t k = 0; k < C; k++)
+    in[k] = A::from_float(y[k], hg_exponent(0));
+  step(in, out);
+  for (size_t k = 0; k < C; k++)
+    w[k] = A::to_float(out[k], hg_exponent(1));
+}
+
+template < size_t N, timing_t MILLIS, typename T, typename G, size_t C >
+void high_gain_obs_t< N, MILLIS, T, G, C >::reset() {
+  for (size_t i = 0; i < N; i++)
+    for (size_t k = 0; k < C; k++)
+      x[i][k] = 0;
+}
+
+template < size_t N, timing_t MILLIS, typename T, typename G, size_t C >
+void high_gain_obs_t< N, MILLIS, T, G, C >::rebase(const float delta, const size_t c) {
+  x[0][c] = A::add(x[0][c], A::from_float(delta, hg_exponent(0)));
+}
@@ -0,0 +1,187 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+/**
+ * \file host/Arduino.h
+ * \author Matteo Ragni
+ *
+ * **Host stand-in for the Arduino core**
+ *
+ * This header replaces the `Arduino.h` of the AVR core when the firmware is
+ * compiled for Linux (see the \p erumby_host target in \p CMakeLists.txt).
+ * It exposes only the subset of the core that the firmware actually uses:
+ *  - time: \p micros, \p millis, \p delay (running on the simulated clock
+ *    of \p host_hal_t, not on the wall clock)
+ *  - digital I/O: \p pinMode, \p digitalWrite, \p digitalRead
+ *  - interrupts: \p attachInterrupt, \p noInterrupts, \p interrupts, \p cli,
+ *    \p sei (on the interrupt flag of \p SREG) and the \p ISR macro for the
+ *    vectors used by the firmware
+ *  - the AVR registers touched by \p pwm_reader_t (\p PINB, \p PINK,
+ *    \p PCMSK0, \p PCMSK2, \p PCICR), by \p pwm_reader_attachable_t (\p PIND,
+ *    \p PINE) and by \p ticker_t (timer 3)
+ *  - the program memory macros of \p avr/pgmspace.h (\p PROGMEM and
+ *    \p pgm_read_word, \p pgm_read_dword, \p pgm_read_float): the host
+ *    has a single address space, they read the memory directly
+ *  - a \p Serial object that prints on the standard error (the standard output
+ *    is left to the host programs)
+ *
+ * The interrupt service routines are never called concurrently with the
+ * firmware code: they are dispatched by \p host_hal_t::advance, between two
+ * calls of the sketch \p loop. This keeps the simulation deterministic.
+ *
+ * \warning This file is never compiled by the Arduino IDE, the IDE compiles
+ * only the sketch folder and its \p src subfolder.
+ */
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "host_hal_t.hpp"
+
+typedef uint8_t byte;    /**< Arduino byte type */
+typedef bool boolean;    /**< Arduino boolean type */
+
+#define HIGH 0x1         /**< Digital level high */
+#define LOW 0x0          /**< Digital level low */
+#define INPUT 0x0        /**< Pin mode input */
+#define OUTPUT 0x1       /**< Pin mode output */
+#define INPUT_PULLUP 0x2 /**< Pin mode input with pullup */
+
+#define CHANGE 1         /**< Interrupt on both edges */
+#define FALLING 2        /**< Interrupt on falling edge */
+#define RISING 3         /**< Interrupt on rising edge */
+
+#define DEC 10           /**< Decimal base for \p Serial.print */
+#define HEX 16           /**< Hexadecimal base for \p Serial.print */
+#define BIN 2            /**< Binary base for \p Serial.print */
+
+#define A8 62            /**< Analog pin 8 (PK0) on the Arduino Mega */
+#define A9 63            /**< Analog pin 9 (PK1) on the Arduino Mega */
+#define A10 64           /**< Analog pin 10 (PK2) on the Arduino Mega */
+#define A11 65           /**< Analog pin 11 (PK3) on the Arduino Mega */
+
+/** \brief Arduino Mega external interrupt number for a pin (-1 if not attachable) */
+#define digitalPinToInterrupt(p) \
+  ((p) == 2 ? 0 : ((p) == 3 ? 1 : ((p) >= 18 && (p) <= 21 ? 23 - (p) : -1)))
+
+/** \brief Interrupt service routine definition (the flags are ignored on host) */
+#define ISR(vector, ...) void vector(void)
+#define ISR_BLOCK        /**< Ignored on host */
+#define ISR_NOBLOCK      /**< Ignored on host */
+
+#define PCINT0_vect host_pcint0_vect             /**< Pin change interrupt for port B */
+#define PCINT2_vect host_pcint2_vect             /**< Pin change interrupt for port K */
+#define TIMER3_COMPA_vect host_timer3_compa_vect /**< Timer 3 compare match A */
+#define TIMER4_CAPT_vect host_timer4_capt_vect   /**< Timer 4 input capture */
+#define TIMER4_OVF_vect host_timer4_ovf_vect     /**< Timer 4 overflow */
+#define TIMER5_CAPT_vect host_timer5_capt_vect   /**< Timer 5 input capture */
+#define TIMER5_OVF_vect host_timer5_ovf_vect     /**< Timer 5 overflow */
+
+void host_pcint0_vect(void) __attribute__((weak));
+void host_pcint2_vect(void) __attribute__((weak));
+void host_timer3_compa_vect(void) __attribute__((weak));
+void host_timer4_capt_vect(void) __attribute__((weak));
+void host_timer4_ovf_vect(void) __attribute__((weak));
+void host_timer5_capt_vect(void) __attribute__((weak));
+void host_timer5_ovf_vect(void) __attribute__((weak));
+
+#ifndef F_CPU
+#define F_CPU 16000000L  /**< Clock of the Arduino Mega */
+#endif
+#define _BV(bit) (1 << (bit)) /**< Bit value */
+
+#define SREG (host_hal_t::reg.sreg)     /**< Status register */
+#define PINB (host_hal_t::reg.pinb)     /**< Input register of port B */
+#define PINK (host_hal_t::reg.pink)     /**< Input register of port K */
+#define PIND (host_hal_t::reg.pind)     /**< Input register of port D */
+#define PINE (host_hal_t::reg.pine)     /**< Input register of port E */
+#define PCMSK0 (host_hal_t::reg.pcmsk0) /**< Pin change mask of port B */
+#define PCMSK2 (host_hal_t::reg.pcmsk2) /**< Pin change mask of port K */
+#define PCICR (host_hal_t::reg.pcicr)   /**< Pin change interrupt control */
+#define TCCR3A (host_hal_t::reg.tccr3a) /**< Timer 3 control register A */
+#define TCCR3B (host_hal_t::reg.tccr3b) /**< Timer 3 control register B */
+#define TCNT3 (host_hal_t::reg.tcnt3)   /**< Timer 3 counter */
+#define OCR3A (host_hal_t::reg.ocr3a)   /**< Timer 3 output compare register A */
+#define TIMSK3 (host_hal_t::reg.timsk3) /**< Timer 3 interrupt mask */
+#define TIFR3 (host_hal_t::reg.tifr3)   /**< Timer 3 interrupt flags */
+#define WGM32 3                         /**< Timer 3 CTC mode bit (in \p TCCR3B) */
+#define CS32 2                          /**< Timer 3 clock select bit 2 (in \p TCCR3B) */
+#define CS31 1                          /**< Timer 3 clock select bit 1 (in \p TCCR3B) */
+#define CS30 0                          /**< Timer 3 clock select bit 0 (in \p TCCR3B) */
+#define OCIE3A 1                        /**< Timer 3 compare A interrupt enable (in \p TIMSK3) */
+#define OCF3A 1                         /**< Timer 3 compare A flag (in \p TIFR3) */
+#define TCCR4A (host_hal_t::reg.timer4.tccra) /**< Timer 4 control register A */
+#define TCCR4B (host_hal_t::reg.timer4.tccrb) /**< Timer 4 control register B */
+#define TCNT4 (host_hal_t::reg.timer4.tcnt)   /**< Timer 4 counter */
+#define ICR4 (host_hal_t::reg.timer4.icr)     /**< Timer 4 input capture register */
+#define TIMSK4 (host_hal_t::reg.timer4.timsk) /**< Timer 4 interrupt mask */
+#define TIFR4 (host_hal_t::reg.timer4.tifr)   /**< Timer 4 interrupt flags */
+#define TCCR5A (host_hal_t::reg.timer5.tccra) /**< Timer 5 control register A */
+#define TCCR5B (host_hal_t::reg.timer5.tccrb) /**< Timer 5 control register B */
+#define TCNT5 (host_hal_t::reg.timer5.tcnt)   /**< Timer 5 counter */
+#define ICR5 (host_hal_t::reg.timer5.icr)     /**< Timer 5 input capture register */
+#define TIMSK5 (host_hal_t::reg.timer5.timsk) /**< Timer 5 interrupt mask */
+#define TIFR5 (host_hal_t::reg.timer5.tifr)   /**< Timer 5 interrupt flags */
+#define ICNC4 7                               /**< Timer 4 input capture noise canceler (in \p TCCR4B) */
+#define ICES4 6                               /**< Timer 4 input capture edge, 1 is rising (in \p TCCR4B) */
+#define CS41 1                                /**< Timer 4 clock select bit 1 (in \p TCCR4B) */
+#define ICIE4 5                               /**< Timer 4 input capture interrupt enable (in \p TIMSK4) */
+#define TOIE4 0                               /**< Timer 4 overflow interrupt enable (in \p TIMSK4) */
+#define ICF4 5                                /**< Timer 4 input capture flag (in \p TIFR4) */
+#define TOV4 0                                /**< Timer 4 overflow flag (in \p TIFR4) */
+#define ICNC5 7                               /**< Timer 5 input capture noise canceler (in \p TCCR5B) */
+#define ICES5 6                               /**< Timer 5 input capture edge, 1 is rising (in \p TCCR5B) */
+#define CS51 1                                /**< Timer 5 clock select bit 1 (in \p TCCR5B) */
+#define ICIE5 5                               /**< Timer 5 input capture interrupt enable (in \p TIMSK5) */
+#define TOIE5 0                               /**< Timer 5 overflow interrupt enable (in \p TIMSK5) */
+#define ICF5 5                                /**< Timer 5 input capture flag (in \p TIFR5) */
+#define TOV5 0                                /**< Timer 5 overflow flag (in \p TIFR5) */
+
+#define PROGMEM /**< Data in the flash (a plain constant on host) */
+#define pgm_read_word(p) (*(const uint16_t*)(p))  /**< Reads 16 bit from the flash */
+#define pgm_read_dword(p) (*(const uint32_t*)(p)) /**< Reads 32 bit from the flash */
+#define pgm_read_float(p) (*(const float*)(p))    /**< Reads a float from the flash */
+
+inline unsigned long micros() { return host_hal_t::micros(); }
+inline unsigned long millis() { return host_hal_t::micros() / 1000UL; }
+inline void delay(unsigned long ms) { host_hal_t::delay(ms * 1000UL); }
+inline void delayMicroseconds(unsigned int us) { host_hal_t::delay(us); }
+
+inline void pinMode(uint8_t pin, uint8_t mode) { host_hal_t::pin_mode(pin, mode); }
+inline void digitalWrite(uint8_t pin, uint8_t val) { host_hal_t::write_pin(pin, val); }
+inline int digitalRead(uint8_t pin) { return host_hal_t::read_pin(pin); }
+
+inline void attachInterrupt(int8_t irq, void (*callback)(void), int mode) {
+  host_hal_t::attach_interrupt(irq, callback, mode);
+}
+inline void detachInterrupt(int8_t irq) { host_hal_t::attach_interrupt(irq, NULL, 0); }
+inline void noInterrupts() {}
+inline void interrupts() {}
+inline void cli() { SREG &= ~0x80; } /**< Clears the interrupt flag (the routines are dispatched anyway) */
+inline void sei() { SREG |= 0x80; }  /**< Sets the interrupt flag */
+
+/** \brief Minimal stand-in for the Arduino \p HardwareSerial, printing on stderr */
+class HardwareSerial {
+ public:
+  void begin(unsigned long) {}
+  void flush();
+  int available() { return 0; }
+  int read() { return -1; }
+  size_t print(const char* s);
+  size_t print(char c);
+  size_t print(long v, int base = DEC);
+  size_t print(unsigned long v, int base = DEC);
+  size_t print(int v, int base = DEC) { return print(long(v), base); }
+  size_t print(unsigned int v, int base = DEC) { return print((unsigned long)(v), base); }
+  size_t print(double v, int digits = 2);
+  size_t println() { return print("\n"); }
+  template < typename V >
+  size_t println(V v) { return print(v) + println(); }
+  template < typename V >
+  size_t println(V v, int base) { return print(v, base) + println(); }
+};
+
+extern HardwareSerial Serial;
+
+#endif /* HOST_ARDUINO_H */
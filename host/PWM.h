@@ -0,0 +1,40 @@
+#ifndef HOST_PWM_H
+#define HOST_PWM_H
+
+/**
+ * \file host/PWM.h
+ * \author Matteo Ragni
+ *
+ * **Host stand-in for the PWM frequency library**
+ *
+ * The firmware uses the Arduino PWM frequency library for generating the
+ * 16 bit PWM of the ESC and of the servo. On host the functions store
+ * the frequency and the duty value in \p host_hal_t, where the host program
+ * can read them back (e.g. for closing the loop with a plant model).
+ */
+
+#include <stdint.h>
+#include "host_hal_t.hpp"
+
+/** \brief Initializes the timers, without touching timer 0 (nothing to do on host) */
+inline void InitTimersSafe() {}
+
+/**
+ * \brief Sets the frequency of the timer that drives a pin
+ * \param pin the pin
+ * \param frequency the frequency in Hz
+ * \return always \p true
+ */
+inline bool SetPinFrequency(uint8_t pin, uint32_t frequency) {
+  host_hal_t::pwm_frequency(pin, frequency);
+  return true;
+}
+
+/**
+ * \brief Writes a 16 bit duty value on a pin
+ * \param pin the pin
+ * \param value the duty value
+ */
+inline void pwmWriteHR(uint8_t pin, uint16_t value) { host_hal_t::pwm_write(pin, value); }
+
+#endif /* HOST_PWM_H */
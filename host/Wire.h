@@ -0,0 +1,106 @@
+#ifndef HOST_WIRE_H
+#define HOST_WIRE_H
+
+/**
+ * \file host/Wire.h
+ * \author Matteo Ragni
+ *
+ * **Host stand-in for the Arduino Wire (i2c) library**
+ *
+ * On the board the firmware is an i2c slave of the Raspberry PI. On host the
+ * master is the host program, that uses the two methods \p master_write and
+ * \p master_read to emulate a transaction. The callbacks registered by the
+ * firmware with \p onReceive and \p onRequest are called inside the
+ * transaction, exactly as the Wire library does in its interrupt routine.
+ *
+ * Usage example:
+ * @code
+ * uint8_t cmd[4] = { 0x01, 0x2C, 0x1A, 0xE1 }; // traction: 300, steer: 6881
+ * Wire.master_write(cmd, 4);
+ * uint8_t telemetry[6];
+ * Wire.master_read(telemetry, 6);
+ * @endcode
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HOST_WIRE_BUFFER 32 /**< Size of the Wire buffers (as in the AVR library) */
+
+/** \brief Minimal stand-in for the Arduino \p TwoWire class (slave side only) */
+class TwoWire {
+  uint8_t address;                   /**< Slave address */
+  uint8_t rx[HOST_WIRE_BUFFER];      /**< Data written by the master */
+  size_t rx_size;                    /**< Number of bytes in \p rx */
+  size_t rx_index;                   /**< Next byte to read in \p rx */
+  uint8_t tx[HOST_WIRE_BUFFER];      /**< Data written by the slave */
+  size_t tx_size;                    /**< Number of bytes in \p tx */
+  void (*on_receive)(int);           /**< Slave receive callback */
+  void (*on_request)(void);          /**< Slave request callback */
+
+ public:
+  /** \brief Empty constructor */
+  TwoWire() : address(0), rx_size(0), rx_index(0), tx_size(0), on_receive(NULL), on_request(NULL) {}
+
+  /**
+   * \brief Joins the bus as slave
+   * \param addr the slave address
+   */
+  void begin(uint8_t addr) { address = addr; }
+  /**
+   * \brief Registers the callback for a master write
+   * \param cb the callback
+   */
+  void onReceive(void (*cb)(int)) { on_receive = cb; }
+  /**
+   * \brief Registers the callback for a master read
+   * \param cb the callback
+   */
+  void onRequest(void (*cb)(void)) { on_request = cb; }
+  /**
+   * \brief Number of bytes still to read
+   * \return the number of bytes still to read
+   */
+  int available() { return int(rx_size - rx_index); }
+  /**
+   * \brief Reads the next received byte
+   * \return the next byte, or -1 if there is nothing to read
+   */
+  int read() { return (rx_index < rx_size) ? rx[rx_index++] : -1; }
+  /**
+   * \brief Writes a byte for the master
+   * \param b the byte
+   * \return the number of bytes written
+   */
+  size_t write(uint8_t b) { return write(&b, 1); }
+  /**
+   * \brief Writes a buffer for the master
+   * \param data the buffer
+   * \param size the buffer size
+   * \return the number of bytes written
+   */
+  size_t write(const uint8_t* data, size_t size);
+
+  /** \brief Emulates a write of the master
+   *
+   * Stores the data in the receive buffer and calls the receive callback.
+   *
+   * \param data the data sent by the master
+   * \param size the size of the data
+   */
+  void master_write(const uint8_t* data, size_t size);
+
+  /** \brief Emulates a read of the master
+   *
+   * Calls the request callback and copies the data written by the slave.
+   *
+   * \param data buffer for the data sent by the slave
+   * \param size the size of the buffer
+   * \return the number of bytes sent by the slave
+   */
+  size_t master_read(uint8_t* data, size_t size);
+};
+
+extern TwoWire Wire;
+
+#endif /* HOST_WIRE_H */
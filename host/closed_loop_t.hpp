@@ -0,0 +1,122 @@
+#ifndef HOST_CLOSED_LOOP_T_HPP
+#define HOST_CLOSED_LOOP_T_HPP
+
+/**
+ * \file host/closed_loop_t.hpp
+ * \author Matteo Ragni
+ *
+ * **Closed loop of the speed controller on the plant model**
+ *
+ * The class closes the loop of \p controller_t on the plant model
+ * (\p plant_t, with the nominal parameters of \p configurations.hpp) through
+ * the map of \p esc_t, as the real time loop does on the board: every
+ * \p CTRL_TIMING the controller takes the reference and the speed of the plant
+ * (the error of the observers is measured by \p hg_compare), its output goes to
+ * the ESC, and the plant is integrated up to the next control step.
+ *
+ * Usage example:
+ * @code
+ * static double step(double) { return 150.0; }
+ * static const profile_t profile = {"step", step, 0.0};
+ *
+ * closed_loop_t< float > loop(100);               // plant step of 100 us
+ * double tracking = loop.run(profile, 5.0, NULL);  // rms of the tracking error
+ * @endcode
+ *
+ * The command of the ESC can also come from outside of the controller
+ * (\p actuate, e.g. the experiment of \p tuner_t).
+ *
+ * \warning The host program must include \p controller_t.ino (the fixed point
+ * controllers are implemented there) and \p lookup_table_t.ino.
+ * \warning This class is a host only class. It is not compiled for the board.
+ */
+
+#include <Arduino.h>
+#include <PWM.h>
+#include "configurations.hpp"
+#include "controller_t.hpp"
+#include "esc_t.hpp"
+#include "plant_t.hpp"
+
+/** \brief Reference profile */
+typedef struct profile_t {
+  const char* name;           /**< Name of the profile */
+  double (*omega)(double t);  /**< Reference at the time t (rad/s) */
+  double last;                /**< Time of the last change of the reference (s) */
+} profile_t;
+
+/** \brief Closed loop of the speed controller on the plant model
+ *
+ * \tparam T arithmetic of the controller
+ */
+template < typename T >
+class closed_loop_t {
+  controller_t< T > ctrl; /**< Speed controller */
+  esc_t esc;              /**< Map of the ESC */
+  plant_t plant;          /**< Plant model */
+  uint32_t dt;            /**< Integration step of the plant in microseconds */
+
+ public:
+  /** \brief Constructor, the plant is at rest
+   *
+   * \param dt_ integration step of the plant in microseconds
+   * \param anti_windup the controller has the limits of \p esc_t (as on the board)
+   */
+  closed_loop_t(uint32_t dt_, bool anti_windup = true) : esc(NULL), plant(dt_), dt(dt_) {
+    if (anti_windup)
+      ctrl.limits(esc.ctrl_min(), esc.ctrl_max());
+  }
+
+  /**
+   * \brief The speed controller (e.g. to install other parameters)
+   * \return the controller
+   */
+  controller_t< T >& get_controller() { return ctrl; }
+  /**
+   * \brief The plant model (e.g. to change its parameters)
+   * \return the plant
+   */
+  plant_t& get_plant() { return plant; }
+
+  /** \brief Sends a command to the ESC, and integrates the plant for a control step
+   *
+   * \param u the command of the controller
+   * \return the speed of the plant at the end of the step (rad/s)
+   */
+  double actuate(const float u) {
+    esc.ctrl(u);
+    esc.loop();
+    for (size_t i = 0; i < (CTRL_TIMING * 1000) / dt; i++)
+      plant.step();
+    return plant.omega();
+  }
+
+  /** \brief One control step
+   *
+   * \param reference the speed reference (rad/s)
+   * \return the speed of the plant at the end of the step (rad/s)
+   */
+  double operator()(const double reference) { return actuate(ctrl(float(reference), float(plant.omega()))); }
+
+  /** \brief Follows a profile
+   *
+   * \param p the profile
+   * \param seconds duration of the profile
+   * \param omega the speed of the plant at each control step (\p NULL if not needed)
+   * \return the rms of the tracking error (rad/s)
+   */
+  double run(const profile_t& p, const double seconds, double* omega) {
+    size_t samples = size_t(seconds * 1000.0) / CTRL_TIMING;
+    double sum = 0;
+    for (size_t k = 0; k < samples; k++) {
+      double r = p.omega(double(k * CTRL_TIMING) / 1000.0);
+      double w = (*this)(r);
+      if (omega)
+        omega[k] = w;
+      sum += (w - r) * (w - r);
+    }
+    return sqrt(sum / samples);
+  }
+};
+
+#endif /* HOST_CLOSED_LOOP_T_HPP */
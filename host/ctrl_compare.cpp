@@ -0,0 +1,140 @@
+/**
+ * \file host/ctrl_compare.cpp
+ * \author Matteo Ragni
+ *
+ * **Closed loop of the fixed point speed controllers with respect to the float one**
+ *
+ * The program closes the loop of \p controller_t on the plant model
+ * (\p closed_loop_t), once with the float controller and once with each
+ * fixed point variant (\p q15_t and \p q31_t). The reference profiles are:
+ *
+ * | Profile  | Reference                                      |
+ * |----------|------------------------------------------------|
+ * | `slow`   | step to 20 rad/s                               |
+ * | `cruise` | step to 150 rad/s                              |
+ * | `ramp`   | from 0 to 200 rad/s in 2 s                     |
+ * | `sine`   | \f$ 100 + 60 \sin(\pi t) \f$ rad/s             |
+ * | `stairs` | 50, 120, 30 rad/s, for 1.5 s each              |
+ *
+ * Each profile lasts \p COMPARE_SECONDS. The program prints a line for each
+ * controller and profile:
+ *
+ * @code
+ * <controller> <profile> <tracking rms> <max error> <rms error> <bound> <ok|FAIL>
+ * @endcode
+ *
+ * where the tracking error is the one of the plant speed with respect to the
+ * reference, and the errors are the ones of the plant speed with respect to
+ * the loop closed by the float controller (all in rad/s). With \p CTRL_NONLIN_LUT
+ * a last line gives the error of the table of \f$\phi\f$ with respect to the
+ * analytic function, on \p COMPARE_TABLE_POINTS inputs in \f$[0, 1]\f$, and its
+ * bound \p CTRL_NONLIN_LUT_ERROR. The program fails (exit code 1) if a maximum
+ * error is above its bound (\p bounds).
+ *
+ * \warning This file is a host only file. It is not compiled for the board.
+ */
+
+#include <stdio.h>
+#include <Arduino.h>
+#include "configurations.hpp"
+#include "controller_t.ino"
+#include "lookup_table_t.ino"
+#include "closed_loop_t.hpp"
+
+#define COMPARE_SECONDS 5.0 /**< Duration of a profile */
+#define COMPARE_STEP_US 100 /**< Integration step of the plant */
+#define COMPARE_TABLE_POINTS 1000000 /**< Inputs of the check of the table of \f$\phi\f$ */
+
+static double slow(double) { return 20.0; }
+static double cruise(double) { return 150.0; }
+static double ramp(double t) { return (t < 2.0) ? 100.0 * t : 200.0; }
+static double sine(double t) { return 100.0 + 60.0 * sin(M_PI * t); }
+static double stairs(double t) { return (t < 1.5) ? 50.0 : ((t < 3.0) ? 120.0 : 30.0); }
+
+static const profile_t profiles[] = {
+    {"slow", slow, 0.0}, {"cruise", cruise, 0.0}, {"ramp", ramp, 2.0}, {"sine", sine, 0.0}, {"stairs", stairs, 3.0}};
+
+/**
+ * \brief Bounds of the maximum error of the plant speed with respect to the float loop (rad/s)
+ *
+ * | Controller | Bound |
+ * |------------|-------|
+ * | Q15        | 0.25  |
+ * | Q31        | 0.05  |
+ *
+ * The error of Q15 comes mostly from the resolution of the control
+ * (\f$2^{\mathrm{CTRL\_FIXED\_U} - 15}\f$), amplified by the slope of
+ * \f$\phi\f$ at low speed. The one of Q31 comes from the float controller
+ * itself: the fixed point controllers evaluate the analytic \f$\phi\f$, the
+ * float one its table (\p CTRL_NONLIN_LUT_ERROR).
+ */
+static const double bounds[2] = {0.25, 0.05};
+
+#define COMPARE_SAMPLES (size_t(COMPARE_SECONDS * 1000.0) / CTRL_TIMING) /**< Control steps of a profile */
+
+/**
+ * \brief Closes the loop on the plant for a profile
+ *
+ * \tparam T arithmetic of the controller
+ * \param p the profile
+ * \param omega the speed of the plant at each control step
+ * \return the rms of the tracking error
+ */
+template < typename T >
+static double loop(const profile_t& p, double (&omega)[COMPARE_SAMPLES]) {
+  closed_loop_t< T > l(COMPARE_STEP_US);
+  return l.run(p, COMPARE_SECONDS, omega);
+}
+
+/**
+ * \brief Prints the line of a controller and checks its bound
+ * \param controller name of the controller
+ * \param profile name of the profile
+ * \param tracking rms of the tracking error
+ * \param omega speed of the plant with the controller
+ * \param reference speed of the plant with the float controller (NULL for the float controller)
+ * \param bound the bound of the maximum error
+ * \return true if the error is within the bound
+ */
+static bool report(const char* controller, const char* profile, double tracking, const double* omega,
+                   const double* reference, double bound) {
+  if (!reference) {
+    printf("%-10s %-8s %10.4f %10s %10s %8s\n", controller, profile, tracking, "-", "-", "-");
+    return true;
+  }
+  double max = 0, sum = 0;
+  for (size_t k = 0; k < COMPARE_SAMPLES; k++) {
+    double d = fabs(omega[k] - reference[k]);
+    max = (d > max) ? d : max;
+    sum += d * d;
+  }
+  bool ok = max <= bound;
+  printf("%-10s %-8s %10.4f %10.6f %10.6f %8.4f %s\n", controller, profile, tracking, max,
+         sqrt(sum / COMPARE_SAMPLES), bound, ok ? "ok" : "FAIL");
+  return ok;
+}
+
+int main() {
+  static double f[COMPARE_SAMPLES], q15[COMPARE_SAMPLES], q31[COMPARE_SAMPLES];
+  bool ok = true;
+  printf("%-10s %-8s %10s %10s %10s %8s\n", "controller", "profile", "tracking", "max", "rms", "bound");
+  for (size_t i = 0; i < sizeof(profiles) / sizeof(profiles[0]); i++) {
+    report("float", profiles[i].name, loop< float >(profiles[i], f), f, NULL, 0);
+    ok = report("q15", profiles[i].name, loop< q15_t >(profiles[i], q15), q15, f, bounds[0]) && ok;
+    ok = report("q31", profiles[i].name, loop< q31_t >(profiles[i], q31), q31, f, bounds[1]) && ok;
+  }
+#ifdef CTRL_NONLIN_LUT
+  double max = 0, sum = 0;
+  for (long k = 0; k <= COMPARE_TABLE_POINTS; k++) {
+    double u = double(k) / COMPARE_TABLE_POINTS;
+    double d = fabs(controller_t< float >::phi(float(u)) - ctrl_phi_t::f(u));
+    max = (d > max) ? d : max;
+    sum += d * d;
+  }
+  bool table = max <= CTRL_NONLIN_LUT_ERROR;
+  printf("%-10s %-8s %10s %10.6f %10.6f %8.4f %s\n", "table", "phi", "-", max, sqrt(sum / (COMPARE_TABLE_POINTS + 1)),
+         double(CTRL_NONLIN_LUT_ERROR), table ? "ok" : "FAIL");
+  ok = table && ok;
+#endif
+  return ok ? 0 : 1;
+}
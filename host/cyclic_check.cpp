@@ -0,0 +1,71 @@
+/**
+ * \file host/cyclic_check.cpp
+ * \author Matteo Ragni
+ *
+ * **Wrap of the positions of the cyclic array**
+ *
+ * The program pushes \p CYCLIC_CHECK_TURNS times the size of the array in a
+ * \p cyclic_array_t of 20 elements (wrapped with a comparison) and of 16
+ * elements (wrapped with a mask). After each push, with the offset in every
+ * position of the internal array, it checks:
+ *  - the elements at all the indexes (thus \p wrap on \f$[0, 2N - 1)\f$),
+ *    \p front and \p back, with respect to the last pushed values
+ *  - \p first_span followed by \p second_span, that must be the same
+ *    elements, with sizes that sum to the size of the array
+ *
+ * The program prints a line for each size, and fails (exit code 1) if an
+ * element is not the expected one:
+ *
+ * @code
+ * <size> <pushes> <wrong indexes> <wrong spans> <ok|FAIL>
+ * @endcode
+ *
+ * \warning This file is a host only file. It is not compiled for the board.
+ */
+
+#include <stdio.h>
+#include <Arduino.h>
+#include "cyclic_array_t.hpp"
+
+#define CYCLIC_CHECK_TURNS 3 /**< Pushes of the check, in sizes of the array */
+
+/**
+ * \brief Checks a cyclic array, and prints its line
+ * \tparam N size of the array
+ * \return true if all the elements are the expected ones
+ */
+template < size_t N >
+static bool check() {
+  cyclic_array_t< long, N > a(-1);
+  size_t indexes = 0, spans = 0;
+  for (long k = 0; k < long(CYCLIC_CHECK_TURNS * N); k++) {
+    a.push_back(k);
+    // The element i is the value pushed N - 1 - i pushes ago (-1 if none)
+    for (size_t i = 0; i < N; i++) {
+      long expected = k - long(N - 1 - i);
+      if (a[i] != ((expected < 0) ? -1 : expected))
+        indexes++;
+    }
+    if ((a.back() != k) || (a.front() != ((k < long(N - 1)) ? -1 : k - long(N - 1))))
+      indexes++;
+
+    span_t< const long > first = a.first_span(), second = a.second_span();
+    if (first.size + second.size != N)
+      spans++;
+    for (size_t i = 0; (i < first.size) && (i < N); i++)
+      spans += (first.data[i] != a[i]);
+    for (size_t i = 0; (i < second.size) && (first.size + i < N); i++)
+      spans += (second.data[i] != a[first.size + i]);
+  }
+  bool ok = (indexes == 0) && (spans == 0);
+  printf("%6zu %8zu %8zu %8zu %s\n", N, CYCLIC_CHECK_TURNS * N, indexes, spans, ok ? "ok" : "FAIL");
+  return ok;
+}
+
+int main() {
+  bool ok = true;
+  printf("%6s %8s %8s %8s\n", "size", "pushes", "indexes", "spans");
+  ok = check< 20 >() && ok;
+  ok = check< 16 >() && ok;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,183 @@
+/**
+ * \file host/encoder_check.cpp
+ * \author Matteo Ragni
+ *
+ * **Edge count and M/T speed of the encoder up to the top wheel speed**
+ *
+ * The program drives the pin of the left encoder (\p L_WHEEL_ENCODER) with the
+ * edges of a wheel at constant speed, through \p host_hal_t::set_input (thus
+ * through the interrupt routine of the reader, as on the board), and it runs
+ * \p encoder_t::measure every \p ENCODER_TIMING. The speeds go from a few
+ * edges per second up to \p ENCODER_CHECK_TOP rad/s, beyond the top speed of
+ * the car (\f$\phi(1) \approx 220\f$ rad/s, about 7000 edges/s). For each speed the
+ * program prints:
+ *
+ * @code
+ * <omega> <edges> <counted> <M/T rms> <M/T max> [<pin change> <difference max>] <ok|FAIL>
+ * @endcode
+ *
+ * where \p edges are the edges driven on the pin, \p counted the edges in the
+ * odometer of the encoder, and the errors are the ones of the M/T speed
+ * (\p encoder_t::get_omega_edge) relative to the speed of the wheel, after
+ * \p ENCODER_CHECK_SETTLE.
+ *
+ * The program is built twice: \p encoder_check reads the encoder through the
+ * pin change interrupts (\p pwm_reader_t), and \p encoder_check_icp through the
+ * input capture unit of timer 4 (\p capture_reader_t, with \p ENCODER_INPUT_CAPTURE).
+ * With the input capture, the same edges drive also a pin change reader on
+ * \p ENCODER_CHECK_MIRROR, and the two optional columns are its count of the
+ * edges, and the maximum difference between the M/T speeds of the two paths
+ * (relative to the speed of the wheel).
+ *
+ * The program fails (exit code 1) if an edge is lost (by any path), or if a
+ * maximum error or difference is above \p ENCODER_CHECK_ERROR.
+ *
+ * \warning This file is a host only file. It is not compiled for the board.
+ */
+
+#include <stdio.h>
+#include <Arduino.h>
+#include "configurations.hpp"
+#include "encoder_t.hpp"
+
+#define ENCODER_CHECK_STEP_US 2   /**< Simulation step (resolution of the edge times) */
+#define ENCODER_CHECK_SECONDS 1.0 /**< Duration of each speed */
+#define ENCODER_CHECK_SETTLE 0.2  /**< Transient discarded by the errors (s) */
+#define ENCODER_CHECK_ERROR 0.01  /**< Bound of the relative error of the M/T speed */
+#define ENCODER_CHECK_TOP 300.0   /**< Top speed of the check (rad/s) */
+#define ENCODER_CHECK_MIRROR 53   /**< Pin of the pin change reader compared with the input capture */
+
+static const double speeds[] = {2.0, 20.0, 60.0, 120.0, 157.0, 220.0, ENCODER_CHECK_TOP}; /**< Speeds of the check (rad/s) */
+
+/** \brief Edges of a wheel at constant speed on the encoder pins */
+class wheel_t {
+  double theta;  /**< Angle of the wheel (rad) */
+  long index;    /**< Window of the encoder (the pins are high in the even ones, as the pullup at rest) */
+
+ public:
+  /** \brief Constructor, the wheel is at rest on a window edge */
+  wheel_t() : theta(0), index(0) {}
+
+  /**
+   * \brief Turns the wheel for a step, toggling the pins on each window
+   * \param omega the speed (rad/s)
+   * \param dt the step (s)
+   * \return the number of edges in the step
+   */
+  long step(double omega, double dt) {
+    const double window = M_PI / double(ENCODER_QUANTIZATION);
+    long edges = 0;
+    theta += omega * dt;
+    while (index < long(floor(theta / window))) {
+      index++;
+      edges++;
+      host_hal_t::set_input(L_WHEEL_ENCODER, !(index & 0x01));
+#ifdef ENCODER_INPUT_CAPTURE
+      host_hal_t::set_input(ENCODER_CHECK_MIRROR, !(index & 0x01));
+#endif
+    }
+    return edges;
+  }
+};
+
+#ifdef ENCODER_INPUT_CAPTURE
+/** \brief M/T speed of the pin change path, as \p encoder_t evaluates it
+ *
+ * The speed is the angle of the edges between two measures over the time
+ * between the last edges of the two measures (in the time base of \p micros).
+ */
+class mirror_t {
+  pwm_reader_t< ENCODER_CHECK_MIRROR > reader; /**< The pin change reader */
+  edge_stamp_t last;                          /**< Last edge of the previous measure */
+  bool valid;                                 /**< \p last is an edge */
+  float omega;                                /**< Last M/T speed (rad/s) */
+
+ public:
+  /** \brief Constructor, no edges yet */
+  mirror_t() : last(), valid(false), omega(0) {}
+
+  /** \brief Takes the edges since the last measure */
+  void measure() {
+    static const float edge = 1000.0 * PWM_READER_TICKS_PER_MS * M_PI / float(ENCODER_QUANTIZATION);  // rad tick / s
+    edge_stamp_t s = reader.last_edge();
+    if (s.count == last.count)
+      return;
+    if (valid)
+      omega = edge * float(ticks_t(s.count - last.count)) / float(s.time - last.time);
+    valid = true;
+    last = s;
+  }
+
+  /**
+   * \brief The edges counted by the reader
+   * \return the free running count of the edges
+   */
+  ticks_t count() const { return reader.last_edge().count; }
+
+  /**
+   * \brief The M/T speed of the last measure with edges
+   * \return the speed (rad/s)
+   */
+  float get_omega() const { return omega; }
+};
+#endif
+
+int main() {
+  encoder_t< L_WHEEL_ENCODER > enc;
+  wheel_t wheel;
+  const uint32_t period = ENCODER_TIMING * 1000 / ENCODER_CHECK_STEP_US;
+  bool ok = true;
+#ifdef ENCODER_INPUT_CAPTURE
+  mirror_t mirror;
+  printf("%8s %8s %8s %10s %10s %10s %10s\n", "omega", "edges", "counted", "M/T rms", "M/T max", "pcint", "diff max");
+#else
+  printf("%8s %8s %8s %10s %10s\n", "omega", "edges", "counted", "M/T rms", "M/T max");
+#endif
+
+  for (size_t i = 0; i < sizeof(speeds) / sizeof(speeds[0]); i++) {
+    const double w = speeds[i];
+    const uint32_t steps = uint32_t(ENCODER_CHECK_SECONDS * 1e6) / ENCODER_CHECK_STEP_US;
+    odometer_t start = enc.get_ticks();
+    long edges = 0;
+    double sum = 0, max = 0;
+    size_t samples = 0;
+#ifdef ENCODER_INPUT_CAPTURE
+    ticks_t mirror_start = mirror.count();
+    double diff = 0;
+#endif
+
+    for (uint32_t k = 1; k <= steps; k++) {
+      host_hal_t::advance(ENCODER_CHECK_STEP_US);
+      edges += wheel.step(w, ENCODER_CHECK_STEP_US * 1e-6);
+      if (k % period)
+        continue;
+      enc.measure();
+#ifdef ENCODER_INPUT_CAPTURE
+      mirror.measure();
+#endif
+      if (k * ENCODER_CHECK_STEP_US < ENCODER_CHECK_SETTLE * 1e6)
+        continue;
+      double e = fabs(enc.get_omega_edge() - w) / w;
+      sum += e * e;
+      max = (e > max) ? e : max;
+      samples++;
+#ifdef ENCODER_INPUT_CAPTURE
+      double d = fabs(enc.get_omega_edge() - mirror.get_omega()) / w;
+      diff = (d > diff) ? d : diff;
+#endif
+    }
+
+    long counted = long(enc.get_ticks() - start);
+    bool good = (counted == edges) && (max <= ENCODER_CHECK_ERROR);
+#ifdef ENCODER_INPUT_CAPTURE
+    long pcint = long(ticks_t(mirror.count() - mirror_start));
+    good = good && (pcint == edges) && (diff <= ENCODER_CHECK_ERROR);
+    printf("%8.1f %8ld %8ld %10.6f %10.6f %10ld %10.6f %s\n", w, edges, counted, sqrt(sum / samples), max, pcint, diff,
+           good ? "ok" : "FAIL");
+#else
+    printf("%8.1f %8ld %8ld %10.6f %10.6f %s\n", w, edges, counted, sqrt(sum / samples), max, good ? "ok" : "FAIL");
+#endif
+    ok = good && ok;
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,104 @@
+/**
+ * \file host/erumby_host.cpp
+ * \author Matteo Ragni
+ *
+ * **Closed loop simulation of the firmware on the host**
+ *
+ * The program runs the whole firmware (\p setup and \p loop of \p erumby.ino)
+ * on the simulated clock of \p host_hal_t, against:
+ *  - the receiver of the remote, that keeps the lateral switch in \p Auto
+ *  - the Raspberry PI, that sends a traction command over i2c and reads the
+ *    telemetry every \p HOST_TELEMETRY_US
+ *  - the traction of the car (\p plant_t), that closes the loop on the ESC PWM
+ *    and drives the encoders
+ *
+ * Usage:
+ * @code
+ * ./erumby_host [seconds] [traction] [switch] [traction after switch]
+ * @endcode
+ * where \p traction is the value sent on the i2c bus (see \p communication_t:
+ * positive for a wheel speed reference in rad/s * 100, negative for a raw ESC PWM).
+ * With \p switch (in seconds) the Raspberry PI sends the second command at that
+ * time, e.g. to pass from the raw PWM to the speed controller, or from the
+ * identification of the controller (\p TUNE_COMMAND) to a speed reference.
+ * The program prints on the standard output a CSV with the telemetry, and on the
+ * standard error the ratio between simulated and wall time.
+ *
+ * \warning This file is a host only file. It is not compiled for the board.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <Arduino.h>
+#include <Wire.h>
+#include "plant_t.hpp"
+#include "ticker_t.hpp"
+
+#define HOST_STEP_US 10            /**< Simulation step (plant and sketch loop polling) */
+#define HOST_RADIO_PERIOD_US 20000 /**< Period of the receiver PWM */
+#define HOST_TELEMETRY_US 20000    /**< Period of the i2c transactions */
+
+void setup();
+void loop();
+
+/**
+ * \brief Receiver of the remote: PWM on the mode pin
+ * \param width pulse width in microseconds
+ */
+static void radio_step(uint32_t width) {
+  uint32_t t = uint32_t(host_hal_t::time() % HOST_RADIO_PERIOD_US);
+  host_hal_t::set_input(MODE_PIN, t < width ? HIGH : LOW);
+}
+
+/**
+ * \brief Sends the command of the Raspberry PI
+ * \param traction the traction command
+ * \param steering the steering command
+ */
+static void raspberry_write(int16_t traction, int16_t steering) {
+  uint8_t data[4] = {uint8_t((traction >> 8) & 0xFF), uint8_t(traction & 0xFF), uint8_t((steering >> 8) & 0xFF),
+                     uint8_t(steering & 0xFF)};
+  Wire.master_write(data, 4);
+}
+
+int main(int argc, char** argv) {
+  double seconds = (argc > 1) ? atof(argv[1]) : 10.0;
+  int16_t traction = (argc > 2) ? int16_t(atoi(argv[2])) : 3000;
+  uint64_t change = (argc > 4) ? uint64_t(atof(argv[3]) * 1e6) : UINT64_MAX;
+  int16_t traction_change = (argc > 4) ? int16_t(atoi(argv[4])) : traction;
+  uint64_t end = uint64_t(seconds * 1e6);
+  uint64_t telemetry = 0;
+  plant_t plant(HOST_STEP_US);
+  clock_t wall = clock();
+
+  setup();
+  raspberry_write(traction, DUTY_SERVO_MIDDLE);
+
+  printf("time,omega,omega_rr,omega_rl,input_esc,missed,lateness,var_rr,var_rl,status\n");
+  while (host_hal_t::time() < end) {
+    host_hal_t::advance(HOST_STEP_US);
+    radio_step(DUTY_MODE_AUTO);
+    plant.step();
+    if (host_hal_t::time() >= change) {
+      raspberry_write(traction_change, DUTY_SERVO_MIDDLE);
+      change = UINT64_MAX;
+    }
+    loop();
+
+    if (host_hal_t::time() >= telemetry) {
+      uint8_t data[16];
+      Wire.master_read(data, 16);
+      printf("%.3f,%.2f,%d,%d,%u,%u,%u,%u,%u,%u\n", double(host_hal_t::time()) * 1e-6, plant.omega(),
+             int16_t(data[0] << 8 | data[1]), int16_t(data[2] << 8 | data[3]), uint16_t(data[4] << 8 | data[5]),
+             uint16_t(data[6] << 8 | data[7]), uint16_t(data[8] << 8 | data[9]), uint16_t(data[10] << 8 | data[11]),
+             uint16_t(data[12] << 8 | data[13]), uint16_t(data[14] << 8 | data[15]));
+      telemetry += HOST_TELEMETRY_US;
+    }
+  }
+
+  double elapsed = double(clock() - wall) / CLOCKS_PER_SEC;
+  fprintf(stderr, "simulated %.2f s in %.2f s (%.1fx real time)\n", seconds, elapsed, seconds / elapsed);
+  fprintf(stderr, "ticks: %u, max jitter: %u us\n", ticker_t::get_ticks(), ticker_t::get_jitter_max());
+  return 0;
+}
@@ -0,0 +1,173 @@
+/**
+ * \file host/hg_compare.cpp
+ * \author Matteo Ragni
+ *
+ * **Error of the fixed point high gain observers with respect to the float ones**
+ *
+ * The program feeds the same angle to the float observers and to their fixed
+ * point variants (\p q15_t and \p q31_t), and measures the difference between
+ * the estimated speeds. The angle is the one of \p encoder_t: quantized on the
+ * edges of the encoder, wrapped in \f$[0, 2\pi)\f$ with \p rebase, and sampled
+ * every \p ENCODER_TIMING. The speed profiles are:
+ *
+ * | Profile  | Speed                                          |
+ * |----------|------------------------------------------------|
+ * | `slow`   | 2 rad/s                                        |
+ * | `cruise` | 60 rad/s                                       |
+ * | `fast`   | 300 rad/s                                      |
+ * | `reverse`| -150 rad/s                                     |
+ * | `ramp`   | from 0 to 300 rad/s in 2 s                     |
+ * | `sine`   | \f$ 100 + 80 \sin(2 \pi t) \f$ rad/s           |
+ *
+ * Each profile lasts \p COMPARE_SECONDS. The program prints a line for each
+ * observer and profile:
+ *
+ * @code
+ * <observer> <profile> <max error> <rms error> <bound> <ok|FAIL>
+ * @endcode
+ *
+ * with the errors in rad/s. The bounds are stated in \p bounds: the program
+ * fails (exit code 1) if a maximum error is above its bound.
+ *
+ * \warning This file is a host only file. It is not compiled for the board.
+ */
+
+#include <stdio.h>
+#include <Arduino.h>
+#include "configurations.hpp"
+#include "high_gain_obs_t.ino"
+
+#define COMPARE_SECONDS 5.0 /**< Duration of a profile */
+#define COMPARE_L3 -1.0     /**< Parameter of state 3 for the observers of order 3 (\p HG_L3 is not defined) */
+
+/** \brief Gains of the observers: the ones of \p configurations.hpp, and \p COMPARE_L3 */
+struct compare_gains_t {
+  static constexpr size_t order = 3;                                         /**< Number of gains */
+  static constexpr double epsilon() { return HG_EPSILON; }                   /**< High gain value */
+  static constexpr double l(const size_t i) { return (i == 0) ? HG_L1 : ((i == 1) ? HG_L2 : COMPARE_L3); } /**< Gains */
+};
+
+/** \brief Speed profile */
+typedef struct profile_t {
+  const char* name;           /**< Name of the profile */
+  double (*omega)(double t);  /**< Speed at the time t (rad/s) */
+} profile_t;
+
+static double slow(double) { return 2.0; }
+static double cruise(double) { return 60.0; }
+static double fast(double) { return 300.0; }
+static double reverse(double) { return -150.0; }
+static double ramp(double t) { return (t < 2.0) ? 150.0 * t : 300.0; }
+static double sine(double t) { return 100.0 + 80.0 * sin(2 * M_PI * t); }
+
+static const profile_t profiles[] = {{"slow", slow},     {"cruise", cruise}, {"fast", fast},
+                                     {"reverse", reverse}, {"ramp", ramp},     {"sine", sine}};
+
+/**
+ * \brief Bounds of the maximum error with respect to the float observer (rad/s)
+ *
+ * | Observer   | Q15  | Q31   |
+ * |------------|------|-------|
+ * | order 2    | 0.25 | 0.001 |
+ * | order 3    | 0.25 | 0.001 |
+ *
+ * The error of Q15 comes from the resolution of the states (the speed is
+ * rounded to \f$2^{\mathrm{HG\_FIXED\_OMEGA} - 15}\f$ rad/s) and of the
+ * coefficients, accumulated by the slow poles of the observer.
+ */
+static const double bounds[2][2] = {{0.25, 0.001}, {0.25, 0.001}};
+
+/** \brief Error statistics */
+typedef struct error_t {
+  double max;  /**< Maximum error */
+  double sum;  /**< Sum of the squared errors */
+  size_t n;    /**< Samples */
+} error_t;
+
+/**
+ * \brief Accumulates an error
+ * \param e the statistics
+ * \param d the error
+ */
+static void accumulate(error_t& e, double d) {
+  d = fabs(d);
+  e.max = (d > e.max) ? d : e.max;
+  e.sum += d * d;
+  e.n++;
+}
+
+/**
+ * \brief Prints the line of an observer and checks its bound
+ * \param observer name of the observer
+ * \param profile name of the profile
+ * \param e the error statistics
+ * \param bound the bound of the maximum error
+ * \return true if the error is within the bound
+ */
+static bool report(const char* observer, const char* profile, const error_t& e, double bound) {
+  bool ok = e.max <= bound;
+  printf("%-8s %-8s %10.6f %10.6f %8.4f %s\n", observer, profile, e.max, sqrt(e.sum / e.n), bound, ok ? "ok" : "FAIL");
+  return ok;
+}
+
+/**
+ * \brief Runs a profile on the float observer and on its fixed point variants
+ *
+ * \tparam F float observer
+ * \tparam Q15 Q15 observer
+ * \tparam Q31 Q31 observer
+ * \param p the profile
+ * \param f float observer
+ * \param q15 Q15 observer
+ * \param q31 Q31 observer
+ * \param order order of the observers (for the bounds)
+ * \return true if both the errors are within the bounds
+ */
+template < typename F, typename Q15, typename Q31 >
+static bool run(const profile_t& p, F f, Q15 q15, Q31 q31, const int order) {
+  const double ts = ENCODER_TIMING / 1000.0;
+  const double edge = M_PI / ENCODER_QUANTIZATION;
+  const long revolution = 2 * ENCODER_QUANTIZATION;
+  double angle = 0.0;
+  long base = 0;
+  error_t e15 = {0, 0, 0};
+  error_t e31 = {0, 0, 0};
+
+  for (double t = 0.0; t < COMPARE_SECONDS; t += ts) {
+    angle += p.omega(t) * ts;
+    long ticks = long(floor(angle / edge));
+    long rel = ticks - base;
+    if ((rel < 0) || (rel >= revolution)) {
+      long shift = rel - ((rel % revolution) + revolution) % revolution;
+      base += shift;
+      rel -= shift;
+      f.rebase(-shift * edge);
+      q15.rebase(-shift * edge);
+      q31.rebase(-shift * edge);
+    }
+    float theta = float(rel * edge);
+    float w = f(theta);
+    accumulate(e15, q15(theta) - w);
+    accumulate(e31, q31(theta) - w);
+  }
+
+  char name[16];
+  snprintf(name, sizeof(name), "q15_o%d", order);
+  bool ok = report(name, p.name, e15, bounds[order - 2][0]);
+  snprintf(name, sizeof(name), "q31_o%d", order);
+  return report(name, p.name, e31, bounds[order - 2][1]) && ok;
+}
+
+int main() {
+  bool ok = true;
+  printf("%-8s %-8s %10s %10s %8s\n", "observer", "profile", "max", "rms", "bound");
+  for (size_t i = 0; i < sizeof(profiles) / sizeof(profiles[0]); i++) {
+    ok = run(profiles[i], high_gain_obs_t< 2, ENCODER_TIMING, float, compare_gains_t >(),
+             high_gain_obs_t< 2, ENCODER_TIMING, q15_t, compare_gains_t >(),
+             high_gain_obs_t< 2, ENCODER_TIMING, q31_t, compare_gains_t >(), 2) && ok;
+    ok = run(profiles[i], high_gain_obs_t< 3, ENCODER_TIMING, float, compare_gains_t >(),
+             high_gain_obs_t< 3, ENCODER_TIMING, q15_t, compare_gains_t >(),
+             high_gain_obs_t< 3, ENCODER_TIMING, q31_t, compare_gains_t >(), 3) && ok;
+  }
+  return ok ? 0 : 1;
+}
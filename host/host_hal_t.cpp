@@ -0,0 +1,204 @@
+#include <stdio.h>
+#include <string.h>
+#include "Arduino.h"
+#include "Wire.h"
+
+// host_hal_t - C++ implementation
+
+uint64_t host_hal_t::now = 0;
+uint8_t host_hal_t::level[HOST_PIN_COUNT] = {0};
+uint8_t host_hal_t::mode[HOST_PIN_COUNT] = {0};
+uint16_t host_hal_t::pwm[HOST_PIN_COUNT] = {0};
+uint32_t host_hal_t::frequency[HOST_PIN_COUNT] = {0};
+host_isr_t host_hal_t::irq[HOST_IRQ_COUNT] = {0};
+uint32_t host_hal_t::timer3_ticks = 0;
+uint32_t host_hal_t::timer4_ticks = 0;
+uint32_t host_hal_t::timer5_ticks = 0;
+host_hal_t::registers_t host_hal_t::reg = {};
+
+void host_hal_t::advance(uint32_t us) {
+  now += us;
+  uint32_t cycles = us * uint32_t(F_CPU / 1000000L);
+  advance_timer3(cycles);
+  advance_capture(reg.timer4, timer4_ticks, cycles, host_timer4_ovf_vect);
+  advance_capture(reg.timer5, timer5_ticks, cycles, host_timer5_ovf_vect);
+}
+
+void host_hal_t::pin_mode(uint8_t pin, uint8_t m) {
+  mode[pin] = m;
+  if (m == INPUT_PULLUP)
+    set_input(pin, HIGH);
+}
+
+void host_hal_t::write_pin(uint8_t pin, uint8_t v) { level[pin] = v ? HIGH : LOW; }
+
+int host_hal_t::read_pin(uint8_t pin) { return level[pin]; }
+
+void host_hal_t::set_input(uint8_t pin, uint8_t v) {
+  uint8_t map = 0;
+  uint8_t* p = port(pin, map);
+  v = v ? HIGH : LOW;
+  if (level[pin] == v)
+    return;
+  level[pin] = v;
+
+  if (p) {
+    if (v)
+      *p |= map;
+    else
+      *p &= ~map;
+    if ((p == &reg.pinb) && (reg.pcicr & 0x01) && (reg.pcmsk0 & map) && host_pcint0_vect)
+      host_pcint0_vect();
+    if ((p == &reg.pink) && (reg.pcicr & 0x04) && (reg.pcmsk2 & map) && host_pcint2_vect)
+      host_pcint2_vect();
+  }
+
+  if (pin == HOST_ICP4)
+    capture(reg.timer4, v, host_timer4_capt_vect);
+  if (pin == HOST_ICP5)
+    capture(reg.timer5, v, host_timer5_capt_vect);
+
+  int n = digitalPinToInterrupt(pin);
+  if ((n >= 0) && irq[n])
+    irq[n]();
+}
+
+void host_hal_t::attach_interrupt(int8_t n, host_isr_t cb, int) {
+  if ((n >= 0) && (n < HOST_IRQ_COUNT))
+    irq[n] = cb;
+}
+
+uint8_t* host_hal_t::port(uint8_t pin, uint8_t& map) {
+  if ((pin >= 50) && (pin <= 53)) {  // PB3 ... PB0
+    map = 1 << (53 - pin);
+    return &reg.pinb;
+  }
+  if ((pin >= 10) && (pin <= 13)) {  // PB4 ... PB7
+    map = 1 << (pin - 6);
+    return &reg.pinb;
+  }
+  if ((pin >= A8) && (pin <= A8 + 7)) {  // PK0 ... PK7
+    map = 1 << (pin - A8);
+    return &reg.pink;
+  }
+  if ((pin == 2) || (pin == 3)) {  // PE4, PE5
+    map = 1 << (pin + 2);
+    return &reg.pine;
+  }
+  if ((pin >= 18) && (pin <= 21)) {  // PD3 ... PD0
+    map = 1 << (21 - pin);
+    return &reg.pind;
+  }
+  map = 0;
+  return NULL;
+}
+
+void host_hal_t::advance_timer3(uint32_t cycles) {
+  static const uint16_t prescaler[8] = {0, 1, 8, 64, 256, 1024, 0, 0};
+  uint16_t p = prescaler[reg.tccr3b & 0x07];
+  if (!p)
+    return;
+
+  timer3_ticks += cycles;
+  while (timer3_ticks >= p) {
+    timer3_ticks -= p;
+    if (reg.tcnt3 == reg.ocr3a) {
+      reg.tcnt3 = 0;
+      reg.tifr3 |= _BV(OCF3A);
+      if ((reg.timsk3 & _BV(OCIE3A)) && host_timer3_compa_vect) {
+        reg.tifr3 &= ~_BV(OCF3A);
+        host_timer3_compa_vect();
+      }
+    } else {
+      reg.tcnt3++;
+    }
+  }
+}
+
+void host_hal_t::advance_capture(capture_timer_t& t, uint32_t& ticks, uint32_t cycles, host_isr_t ovf) {
+  static const uint16_t prescaler[8] = {0, 1, 8, 64, 256, 1024, 0, 0};
+  uint16_t p = prescaler[t.tccrb & 0x07];
+  if (!p)
+    return;
+
+  ticks += cycles;
+  uint32_t counts = t.tcnt + ticks / p;
+  ticks %= p;
+  while (counts > 0xFFFF) {
+    counts -= 0x10000;
+    t.tcnt = 0;
+    t.tifr |= _BV(TOV4);
+    if ((t.timsk & _BV(TOIE4)) && ovf) {
+      t.tifr &= ~_BV(TOV4);
+      ovf();
+    }
+  }
+  t.tcnt = uint16_t(counts);
+}
+
+void host_hal_t::capture(capture_timer_t& t, uint8_t v, host_isr_t capt) {
+  if (!(t.tccrb & 0x07) || (bool(t.tccrb & _BV(ICES4)) != bool(v)))
+    return;
+  t.icr = t.tcnt;
+  t.tifr |= _BV(ICF4);
+  if ((t.timsk & _BV(ICIE4)) && capt) {
+    t.tifr &= ~_BV(ICF4);
+    capt();
+  }
+}
+
+// HardwareSerial - C++ implementation
+
+HardwareSerial Serial;
+
+void HardwareSerial::flush() { fflush(stderr); }
+
+size_t HardwareSerial::print(const char* s) { return fprintf(stderr, "%s", s); }
+
+size_t HardwareSerial::print(char c) { return fprintf(stderr, "%c", c); }
+
+size_t HardwareSerial::print(long v, int base) {
+  if (base == HEX)
+    return fprintf(stderr, "%lX", v);
+  return fprintf(stderr, "%ld", v);
+}
+
+size_t HardwareSerial::print(unsigned long v, int base) {
+  if (base == HEX)
+    return fprintf(stderr, "%lX", v);
+  return fprintf(stderr, "%lu", v);
+}
+
+size_t HardwareSerial::print(double v, int digits) { return fprintf(stderr, "%.*f", digits, v); }
+
+// TwoWire - C++ implementation
+
+TwoWire Wire;
+
+size_t TwoWire::write(const uint8_t* data, size_t size) {
+  if (tx_size + size > HOST_WIRE_BUFFER)
+    size = HOST_WIRE_BUFFER - tx_size;
+  memcpy(tx + tx_size, data, size);
+  tx_size += size;
+  return size;
+}
+
+void TwoWire::master_write(const uint8_t* data, size_t size) {
+  if (size > HOST_WIRE_BUFFER)
+    size = HOST_WIRE_BUFFER;
+  memcpy(rx, data, size);
+  rx_size = size;
+  rx_index = 0;
+  if (on_receive)
+    on_receive(int(size));
+}
+
+size_t TwoWire::master_read(uint8_t* data, size_t size) {
+  tx_size = 0;
+  if (on_request)
+    on_request();
+  if (size > tx_size)
+    size = tx_size;
+  memcpy(data, tx, size);
+  return size;
+}
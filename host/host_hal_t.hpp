@@ -0,0 +1,226 @@
+#ifndef HOST_HAL_T_HPP
+#define HOST_HAL_T_HPP
+
+/**
+ * \file host/host_hal_t.hpp
+ * \author Matteo Ragni
+ *
+ * **Hardware abstraction layer for the host (Linux) build**
+ *
+ * The class emulates the part of the ATmega2560 that is used by the firmware:
+ *  - a simulated microseconds clock, that advances only when the host
+ *    program requires it (the simulation runs faster than real time)
+ *  - the digital pins, with the port mapping of the Arduino Mega for the
+ *    ports B and K (the one used by \p pwm_reader_t), and for the attachable
+ *    pins on ports D and E (read by \p pwm_reader_attachable_t)
+ *  - the pin change interrupts (\p PCINT0_vect, \p PCINT2_vect) and the
+ *    external interrupts registered with \p attachInterrupt
+ *  - the PWM outputs of the \p PWM.h library (frequency and duty value)
+ *  - timer 3 in CTC mode, with the compare match interrupt (\p TIMER3_COMPA_vect)
+ *    and its flag in \p TIFR3
+ *  - timers 4 and 5 in normal mode, with the input capture units on pins
+ *    49 (\p ICP4) and 48 (\p ICP5) and the overflow and capture interrupts
+ *
+ * The external world (the wheels, the receiver of the remote, the Raspberry PI)
+ * is driven by the host program, through \p set_input and the \p Wire stand-in.
+ * When an input pin changes its level, the relative interrupt routine is
+ * called immediately, as it happens on the board.
+ *
+ * Usage example:
+ * @code
+ * setup();
+ * while (host_hal_t::micros() < 1000000) {
+ *   host_hal_t::advance(10);           // 10 us of simulated time
+ *   host_hal_t::set_input(52, level);  // drive the right encoder
+ *   loop();
+ * }
+ * @endcode
+ *
+ * \warning This class is a host only class. It is not compiled for the board.
+ */
+
+#include <stdint.h>
+
+#define HOST_PIN_COUNT 70 /**< Number of digital pins on the Arduino Mega */
+#define HOST_IRQ_COUNT 6  /**< Number of external interrupts on the Arduino Mega */
+#define HOST_ICP4 49      /**< Input capture pin of timer 4 (PL0) */
+#define HOST_ICP5 48      /**< Input capture pin of timer 5 (PL1) */
+
+typedef void (*host_isr_t)(void); /**< Interrupt service routine */
+
+/** \brief Hardware abstraction layer for the host build
+ *
+ * The class is a static class: there is only one board. All the state
+ * of the board is kept in static members, that are readable by the host program
+ * for inspecting what the firmware has done (e.g. the value written by
+ * \p pwmWriteHR on the ESC pin).
+ */
+class host_hal_t {
+  static uint64_t now;                       /**< Simulated time in microseconds */
+  static uint8_t level[HOST_PIN_COUNT];      /**< Current level of each pin */
+  static uint8_t mode[HOST_PIN_COUNT];       /**< Current mode of each pin */
+  static uint16_t pwm[HOST_PIN_COUNT];       /**< Last value written with \p pwmWriteHR */
+  static uint32_t frequency[HOST_PIN_COUNT]; /**< Frequency set with \p SetPinFrequency */
+  static host_isr_t irq[HOST_IRQ_COUNT];     /**< Callbacks registered with \p attachInterrupt */
+  static uint32_t timer3_ticks;              /**< CPU cycles of timer 3 not yet counted in \p TCNT3 */
+  static uint32_t timer4_ticks;              /**< CPU cycles of timer 4 not yet counted in \p TCNT4 */
+  static uint32_t timer5_ticks;              /**< CPU cycles of timer 5 not yet counted in \p TCNT5 */
+
+ public:
+  /** \brief Registers of a 16 bit timer with input capture (timers 4 and 5) */
+  typedef struct capture_timer_t {
+    uint8_t tccra; /**< Control register A (only normal mode is emulated) */
+    uint8_t tccrb; /**< Control register B (clock select and edge of the capture) */
+    uint16_t tcnt; /**< Counter */
+    uint16_t icr;  /**< Input capture register */
+    uint8_t timsk; /**< Interrupt mask */
+    uint8_t tifr;  /**< Interrupt flags */
+  } capture_timer_t;
+
+  /** \brief Registers of the microcontroller used by the firmware */
+  typedef struct registers_t {
+    uint8_t sreg;   /**< Status register (only the global interrupt flag is used) */
+    uint8_t pinb;   /**< Input register of port B */
+    uint8_t pink;   /**< Input register of port K */
+    uint8_t pind;   /**< Input register of port D */
+    uint8_t pine;   /**< Input register of port E */
+    uint8_t pcmsk0; /**< Pin change mask for port B */
+    uint8_t pcmsk2; /**< Pin change mask for port K */
+    uint8_t pcicr;  /**< Pin change interrupt control register */
+    uint8_t tccr3a; /**< Timer 3 control register A */
+    uint8_t tccr3b; /**< Timer 3 control register B (only CTC mode is emulated) */
+    uint16_t tcnt3; /**< Timer 3 counter */
+    uint16_t ocr3a; /**< Timer 3 output compare register A */
+    uint8_t timsk3; /**< Timer 3 interrupt mask */
+    uint8_t tifr3;  /**< Timer 3 interrupt flags */
+    capture_timer_t timer4; /**< Timer 4 */
+    capture_timer_t timer5; /**< Timer 5 */
+  } registers_t;
+
+  static registers_t reg; /**< Emulated registers */
+
+  /**
+   * \brief Current simulated time, with the 32 bit wrap of the board
+   * \return the simulated time in microseconds
+   */
+  static unsigned long micros() { return (unsigned long)(uint32_t)(now); }
+  /**
+   * \brief Current simulated time, without wrap
+   * \return the simulated time in microseconds since boot
+   */
+  static uint64_t time() { return now; }
+  /** \brief Advances the simulated clock
+   *
+   * Advances the clock and the hardware timers. When a timer reaches its
+   * compare value, the relative interrupt routine is called.
+   *
+   * \param us microseconds to add to the clock
+   */
+  static void advance(uint32_t us);
+  /**
+   * \brief Blocking delay (on host it only advances the clock)
+   * \param us microseconds to wait
+   */
+  static void delay(uint32_t us) { advance(us); }
+
+  /**
+   * \brief Sets the mode of a pin (\p pinMode)
+   * \param pin the pin
+   * \param m the mode (\p INPUT, \p OUTPUT, \p INPUT_PULLUP)
+   */
+  static void pin_mode(uint8_t pin, uint8_t m);
+  /**
+   * \brief Writes a digital output (\p digitalWrite)
+   * \param pin the pin
+   * \param v the level
+   */
+  static void write_pin(uint8_t pin, uint8_t v);
+  /**
+   * \brief Reads a digital pin (\p digitalRead)
+   * \param pin the pin
+   * \return the level of the pin
+   */
+  static int read_pin(uint8_t pin);
+
+  /** \brief Drives an input pin from the external world
+   *
+   * The function changes the level of the pin, updates the port registers
+   * and, if the level is changed, calls the interrupt routine registered
+   * for the pin (pin change or external interrupt).
+   *
+   * \param pin the pin to drive
+   * \param v the new level
+   */
+  static void set_input(uint8_t pin, uint8_t v);
+
+  /**
+   * \brief Registers a callback on an external interrupt (\p attachInterrupt)
+   * \param n interrupt number (see \p digitalPinToInterrupt)
+   * \param cb the callback, \p NULL for detaching
+   * \param m the trigger mode (only \p CHANGE is emulated)
+   */
+  static void attach_interrupt(int8_t n, host_isr_t cb, int m);
+
+  /**
+   * \brief Sets the frequency of a PWM pin (\p SetPinFrequency)
+   * \param pin the pin
+   * \param f the frequency in Hz
+   */
+  static void pwm_frequency(uint8_t pin, uint32_t f) { frequency[pin] = f; }
+  /**
+   * \brief Writes a PWM value (\p pwmWriteHR)
+   * \param pin the pin
+   * \param v the 16 bit duty value
+   */
+  static void pwm_write(uint8_t pin, uint16_t v) { pwm[pin] = v; }
+  /**
+   * \brief Reads back the last value written on a PWM pin
+   * \param pin the pin
+   * \return the 16 bit duty value
+   */
+  static uint16_t pwm_read(uint8_t pin) { return pwm[pin]; }
+  /**
+   * \brief Reads back the last frequency set on a PWM pin
+   * \param pin the pin
+   * \return the frequency in Hz
+   */
+  static uint32_t pwm_frequency(uint8_t pin) { return frequency[pin]; }
+
+ private:
+  /** \brief Port and mask of a pin
+   *
+   * Maps a pin on its port register (only ports B and K, and the attachable
+   * pins on ports D and E are emulated) and on the position in the port.
+   * Other pins returns a \p NULL port.
+   *
+   * \param pin the pin
+   * \param map the position of the pin in the port (output)
+   * \return the pointer to the input register of the port
+   */
+  static uint8_t* port(uint8_t pin, uint8_t& map);
+
+  /**
+   * \brief Advances timer 3 (CTC mode), calling the compare match routine
+   * \param cycles CPU cycles elapsed
+   */
+  static void advance_timer3(uint32_t cycles);
+
+  /**
+   * \brief Advances a timer in normal mode, calling the overflow routine
+   * \param t the registers of the timer
+   * \param ticks CPU cycles of the timer not yet counted (input and output)
+   * \param cycles CPU cycles elapsed
+   * \param ovf overflow interrupt routine
+   */
+  static void advance_capture(capture_timer_t& t, uint32_t& ticks, uint32_t cycles, host_isr_t ovf);
+
+  /**
+   * \brief Input capture on an edge of the pin of a timer
+   * \param t the registers of the timer
+   * \param v the new level of the pin
+   * \param capt capture interrupt routine
+   */
+  static void capture(capture_timer_t& t, uint8_t v, host_isr_t capt);
+};
+
+#endif /* HOST_HAL_T_HPP */
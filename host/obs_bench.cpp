@@ -0,0 +1,508 @@
+/**
+ * \file host/obs_bench.cpp
+ * \author Matteo Ragni
+ *
+ * **Benchmark of the wheel speed estimators on edge traces**
+ *
+ * The program feeds traces of encoder edges to the estimators of the wheel
+ * speed (\p high_gain_obs_t with several orders, arithmetics and gains,
+ * \p kalman_obs_t, and the M/T estimations of \p ENCODER_SPEED_MT and
+ * \p ENCODER_SPEED_MT_HG), as \p encoder_t does: the edges are counted every
+ * \p ENCODER_TIMING, and the angle is wrapped in a revolution with \p rebase.
+ * The M/T estimations take also the snapshot of the edges of each sample (the
+ * count and the time of the last edge, as \p last_edge of the reader), and
+ * evaluate the speed as \p encoder_t::period_speed and \p encoder_t::interpolation.
+ * The traces are synthesized from speed profiles, or read from a file
+ * recorded on the car.
+ *
+ * On the synthesized traces the true speed is known, and the program prints
+ * a CSV line for each estimator:
+ *
+ * | Column          | Metric                                                               |
+ * |-----------------|----------------------------------------------------------------------|
+ * | `estimator`     | name of the estimator (the gains are in brackets)                    |
+ * | `ns_per_sample` | host CPU time of a step (ns, includes a virtual call)                |
+ * | `lag_<f>hz_deg` | phase lag on \f$ 60 + 20 \sin(2 \pi f t) \f$ rad/s (degrees)         |
+ * | `noise_<w>_rms` | RMS error at the constant speed \f$w\f$ rad/s (rad/s)                |
+ * | `settling_ms`   | settling time of a step from 20 to 60 rad/s in a 5 % band (ms, -1 if not settled) |
+ *
+ * With a recorded trace (one edge per line: the time in us, and optionally the
+ * direction, 1 or -1; `#` starts a comment), the true speed is not known: the
+ * reference is the speed of the edges in a window of \p BENCH_WINDOW around
+ * each sample (a non causal M/T estimation, without lag), and the program prints
+ * `estimator,ns_per_sample,rms_vs_reference`.
+ *
+ * Usage:
+ * @code
+ * ./obs_bench [trace]
+ * @endcode
+ *
+ * The gains are evaluated at compile time (see \p hg_discretization_t): the
+ * candidates are the instances in \p main, add a line there to try new gains.
+ *
+ * \warning This file is a host only file. It is not compiled for the board.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <time.h>
+#include <vector>
+#include <Arduino.h>
+#include "configurations.hpp"
+#include "high_gain_obs_t.ino"
+#include "kalman_obs_t.ino"
+
+#define BENCH_DT 1e-5         /**< Integration step of the synthesized traces (s) */
+#define BENCH_SETTLE 1.0      /**< Transient discarded by the metrics (s) */
+#define BENCH_WINDOW 0.02     /**< Half window of the reference speed of the recorded traces (s) */
+#define BENCH_BAND 0.05       /**< Band of the settling time (fraction of the step) */
+#define BENCH_REPEAT 20       /**< Repetitions of a trace for the CPU time */
+
+/** \brief Gains of a candidate observer, in thousandths (doubles are not template parameters) */
+template < int L1, int L2, int EPSILON, int L3 = -1000 >
+struct bench_gains_t {
+  static constexpr size_t order = 3;                                      /**< Number of gains */
+  static constexpr double epsilon() { return EPSILON / 1000.0; }          /**< High gain value */
+  static constexpr double l(const size_t i) { return ((i == 0) ? L1 : ((i == 1) ? L2 : L3)) / 1000.0; } /**< Gains */
+};
+
+/** \brief Trace of encoder edges */
+typedef struct trace_t {
+  std::vector< double > time;       /**< Time of the edges (s) */
+  std::vector< int > direction;     /**< Direction of the edges (1 or -1) */
+  double duration;                  /**< Duration of the trace (s) */
+} trace_t;
+
+/** \brief Edges seen by a sample, as the reader of \p encoder_t gives them (\p last_edge) */
+typedef struct snapshot_t {
+  ticks_t count;     /**< Free running count of the edges */
+  timing_t last;     /**< Time of the last edge (us) */
+  timing_t now;      /**< Time of the sample (us) */
+  int8_t direction;  /**< Direction of the last edge (1 or -1) */
+} snapshot_t;
+
+/** \brief Samples of a trace, as \p encoder_t reads them every \p ENCODER_TIMING */
+typedef struct samples_t {
+  std::vector< float > theta;        /**< Angles in the current revolution (rad) */
+  std::vector< float > shift;        /**< Shifts of the origin before each sample (rad) */
+  std::vector< snapshot_t > edge;    /**< Snapshots of the edges */
+} samples_t;
+
+/** \brief Estimator under benchmark (a common interface for the observers) */
+struct estimator_t {
+  char name[48];                                                  /**< Name of the estimator */
+  virtual ~estimator_t() {}
+  virtual void reset() = 0;                                       /**< Resets the state */
+  virtual void rebase(const float d) = 0;                         /**< Shifts the origin of the angle */
+  virtual float step(const float y, const snapshot_t& s) = 0;     /**< One step on the angle and the edges, returns the speed */
+};
+
+/** \brief An observer as an \p estimator_t
+ * \tparam O the observer (single channel)
+ */
+template < typename O >
+struct estimator_of_t : estimator_t {
+  O o; /**< The observer */
+  /** \brief Constructor
+   * \param n name of the estimator
+   */
+  estimator_of_t(const char* n) : o() { snprintf(name, sizeof(name), "%s", n); }
+  void reset() { o.reset(); }
+  void rebase(const float d) { o.rebase(d); }
+  float step(const float y, const snapshot_t&) { return o(y); }
+};
+
+/** \brief M/T speed of the edges, as \p encoder_t::period_speed evaluates it */
+struct mt_t {
+  ticks_t count;      /**< Count of the last edge seen */
+  timing_t last;      /**< Time of the last edge seen (us) */
+  timing_t period;    /**< Last period between edges (us, 0 if not valid) */
+  bool valid;         /**< \p last belongs to the current sequence of edges */
+  int8_t direction;   /**< Direction of the last edges */
+  float omega;        /**< Last speed (rad/s) */
+
+  /** \brief Resets the state, no edges yet */
+  void reset() {
+    count = 0;
+    last = 0;
+    period = 0;
+    valid = false;
+    direction = 1;
+    omega = 0;
+  }
+
+  /**
+   * \brief Speed of the edges of a sample
+   * \param s the snapshot of the sample
+   * \return the speed, with the direction (rad/s)
+   */
+  float operator()(const snapshot_t& s) {
+    static const float edge_angle = 1e6 * M_PI / float(ENCODER_QUANTIZATION);  // rad us / s
+    ticks_t counter = s.count - count;
+    count = s.count;
+    if (counter && (s.direction != direction)) {
+      direction = s.direction;
+      valid = false;  // the period sequence restarts after a reversal
+    }
+    float w = fabs(omega);
+    if (counter) {
+      timing_t start = last;
+      bool v = valid;
+      last = s.last;
+      valid = true;
+      if (v && (s.last != start)) {
+        period = (s.last - start) / counter;
+        return omega = direction * edge_angle * float(counter) / float(s.last - start);
+      }
+    }
+    if (!valid)
+      return omega = 0.0;
+    timing_t elapsed = s.now - last;
+    if (elapsed >= timing_t(ENCODER_EDGE_TIMEOUT) * 1000) {
+      valid = false;
+      period = 0;
+      return omega = 0.0;
+    }
+    if (period && (elapsed > period))
+      w = edge_angle / float(elapsed);
+    return omega = direction * w;
+  }
+
+  /**
+   * \brief Angle turned since the last edge, as \p encoder_t::interpolation
+   * \param s the snapshot of the sample
+   * \return the angle, with the direction (rad)
+   */
+  float interpolation(const snapshot_t& s) const {
+    static const float edge = M_PI / float(ENCODER_QUANTIZATION);  // rad
+    if (!valid)
+      return 0.0;
+    float angle = fabs(omega) * float(s.now - last) * 1e-6;
+    return direction * ((angle < edge) ? angle : edge);
+  }
+};
+
+/** \brief M/T speed without observer (\p ENCODER_SPEED_MT) */
+struct mt_estimator_t : estimator_t {
+  mt_t mt; /**< The M/T speed */
+  /** \brief Constructor
+   * \param n name of the estimator
+   */
+  mt_estimator_t(const char* n) { snprintf(name, sizeof(name), "%s", n); }
+  void reset() { mt.reset(); }
+  void rebase(const float) {}
+  float step(const float, const snapshot_t& s) { return mt(s); }
+};
+
+/** \brief An observer on the angle interpolated with the edge timing (\p ENCODER_SPEED_MT_HG)
+ * \tparam O the observer (single channel)
+ */
+template < typename O >
+struct mt_observer_t : estimator_t {
+  mt_t mt; /**< The M/T speed of the interpolation */
+  O o;     /**< The observer */
+  /** \brief Constructor
+   * \param n name of the estimator
+   */
+  mt_observer_t(const char* n) : o() { snprintf(name, sizeof(name), "%s", n); }
+  void reset() {
+    mt.reset();
+    o.reset();
+  }
+  void rebase(const float d) { o.rebase(d); }
+  float step(const float y, const snapshot_t& s) {
+    mt(s);
+    return o(y + mt.interpolation(s));
+  }
+};
+
+/**
+ * \brief Synthesizes the edges of a speed profile
+ * \param omega speed at the time t (rad/s)
+ * \param duration duration of the trace (s)
+ * \return the trace
+ */
+template < typename F >
+static trace_t synthesize(F omega, const double duration) {
+  const double edge = M_PI / ENCODER_QUANTIZATION;
+  trace_t tr;
+  double angle = 0.0;
+  long last = 0;
+  tr.duration = duration;
+  for (double t = 0.0; t < duration; t += BENCH_DT) {
+    angle += omega(t + BENCH_DT / 2) * BENCH_DT;
+    long ticks = long(floor(angle / edge));
+    while (ticks != last) {
+      int d = (ticks > last) ? 1 : -1;
+      last += d;
+      tr.time.push_back(t + BENCH_DT);
+      tr.direction.push_back(d);
+    }
+  }
+  return tr;
+}
+
+/**
+ * \brief Reads a recorded trace
+ * \param path the file
+ * \param tr the trace
+ * \return false if the file cannot be read
+ */
+static bool load(const char* path, trace_t& tr) {
+  FILE* f = fopen(path, "r");
+  char line[128];
+  if (!f)
+    return false;
+  tr.duration = 0.0;
+  while (fgets(line, sizeof(line), f)) {
+    double us;
+    int d = 1;
+    if ((line[0] == '#') || (sscanf(line, "%lf %d", &us, &d) < 1))
+      continue;
+    tr.time.push_back(us * 1e-6);
+    tr.direction.push_back((d < 0) ? -1 : 1);
+    tr.duration = us * 1e-6;
+  }
+  fclose(f);
+  return !tr.time.empty();
+}
+
+/**
+ * \brief Samples a trace as \p encoder_t: every \p ENCODER_TIMING the angle in
+ * the current revolution, the shift of its origin, and the snapshot of the edges
+ * \param tr the trace
+ * \param x the samples
+ */
+static void sample(const trace_t& tr, samples_t& x) {
+  const double ts = ENCODER_TIMING / 1000.0;
+  const double edge = M_PI / ENCODER_QUANTIZATION;
+  const long revolution = 2 * ENCODER_QUANTIZATION;
+  long ticks = 0, base = 0;
+  size_t e = 0;
+  snapshot_t s = {0, 0, 0, 1};
+  for (double t = ts; t <= tr.duration; t += ts) {
+    for (; (e < tr.time.size()) && (tr.time[e] <= t); e++) {
+      ticks += tr.direction[e];
+      s.count++;
+      s.last = timing_t(llround(tr.time[e] * 1e6));
+      s.direction = tr.direction[e];
+    }
+    s.now = timing_t(llround(t * 1e6));
+    long rel = ticks - base;
+    long moved = 0;
+    if ((rel < 0) || (rel >= revolution)) {
+      moved = rel - ((rel % revolution) + revolution) % revolution;
+      base += moved;
+      rel -= moved;
+    }
+    x.shift.push_back(float(-moved * edge));
+    x.theta.push_back(float(rel * edge));
+    x.edge.push_back(s);
+  }
+}
+
+/**
+ * \brief Runs an estimator on a sampled trace
+ * \param est the estimator
+ * \param x the samples
+ * \param omega the estimated speeds
+ */
+static void run(estimator_t& est, const samples_t& x, std::vector< float >& omega) {
+  est.reset();
+  omega.resize(x.theta.size());
+  for (size_t k = 0; k < x.theta.size(); k++) {
+    if (x.shift[k] != 0.0)
+      est.rebase(x.shift[k]);
+    omega[k] = est.step(x.theta[k], x.edge[k]);
+  }
+}
+
+/**
+ * \brief CPU time of a step of an estimator
+ * \param est the estimator
+ * \param x the samples
+ * \return the time of a step (ns)
+ */
+static double cpu_time(estimator_t& est, const samples_t& x) {
+  std::vector< float > omega;
+  timespec a, b;
+  clock_gettime(CLOCK_MONOTONIC, &a);
+  for (int r = 0; r < BENCH_REPEAT; r++)
+    run(est, x, omega);
+  clock_gettime(CLOCK_MONOTONIC, &b);
+  return ((b.tv_sec - a.tv_sec) * 1e9 + (b.tv_nsec - a.tv_nsec)) / (double(BENCH_REPEAT) * x.theta.size());
+}
+
+/**
+ * \brief Phase of the component at the frequency \p f (after \p BENCH_SETTLE, on whole periods)
+ * \param x the signal, sampled every \p ENCODER_TIMING
+ * \param f the frequency (Hz)
+ * \return the phase (rad)
+ */
+static double phase(const std::vector< float >& x, const double f) {
+  const double ts = ENCODER_TIMING / 1000.0;
+  size_t start = size_t(BENCH_SETTLE / ts);
+  size_t n = size_t(floor((x.size() - start) * ts * f) / (ts * f));
+  double s = 0.0, c = 0.0;
+  for (size_t k = start; k < start + n; k++) {
+    double t = (k + 1) * ts;
+    s += x[k] * sin(2 * M_PI * f * t);
+    c += x[k] * cos(2 * M_PI * f * t);
+  }
+  return atan2(c, s);
+}
+
+/** \brief Speed profiles of the synthesized traces (see the file documentation) */
+struct profile_t {
+  double f;   /**< Frequency of the sine (Hz), or the constant speed (rad/s) */
+  /** \brief Speed of the sine */
+  double sine(const double t) const { return 60.0 + 20.0 * sin(2 * M_PI * f * t); }
+};
+
+static const double frequencies[] = {1.0, 2.0, 5.0, 10.0}; /**< Frequencies of the phase lag (Hz) */
+static const double speeds[] = {3.0, 30.0};                 /**< Speeds of the noise (rad/s) */
+
+/** \brief Synthesized traces and their samples */
+struct suite_t {
+  samples_t sine[4];   /**< Samples of the sines */
+  samples_t noise[2];  /**< Samples of the constant speeds */
+  samples_t step;      /**< Samples of the step */
+};
+
+/** \brief Builds the synthesized traces */
+static void build(suite_t& s) {
+  for (size_t i = 0; i < 4; i++) {
+    profile_t p = {frequencies[i]};
+    sample(synthesize([&p](double t) { return p.sine(t); }, BENCH_SETTLE + 4.0), s.sine[i]);
+  }
+  for (size_t i = 0; i < 2; i++) {
+    double w = speeds[i];
+    sample(synthesize([w](double) { return w; }, BENCH_SETTLE + 4.0), s.noise[i]);
+  }
+  sample(synthesize([](double t) { return (t < 2 * BENCH_SETTLE) ? 20.0 : 60.0; }, 2 * BENCH_SETTLE + 2.0), s.step);
+}
+
+/**
+ * \brief Prints the line of an estimator on the synthesized traces
+ * \param s the traces
+ * \param est the estimator
+ */
+static void report(const suite_t& s, estimator_t& est) {
+  const double ts = ENCODER_TIMING / 1000.0;
+  std::vector< float > omega, truth;
+  printf("%s,%.1f", est.name, cpu_time(est, s.noise[1]));
+
+  for (size_t i = 0; i < 4; i++) {
+    run(est, s.sine[i], omega);
+    profile_t p = {frequencies[i]};
+    truth.resize(omega.size());
+    for (size_t k = 0; k < truth.size(); k++)
+      truth[k] = float(p.sine((k + 1) * ts));
+    double lag = (phase(truth, p.f) - phase(omega, p.f)) * 180.0 / M_PI;
+    lag = lag - 360.0 * floor((lag + 180.0) / 360.0);
+    printf(",%.2f", lag);
+  }
+
+  for (size_t i = 0; i < 2; i++) {
+    double sum = 0.0;
+    size_t n = 0;
+    run(est, s.noise[i], omega);
+    for (size_t k = size_t(BENCH_SETTLE / ts); k < omega.size(); k++, n++)
+      sum += (omega[k] - speeds[i]) * (omega[k] - speeds[i]);
+    printf(",%.4f", sqrt(sum / n));
+  }
+
+  run(est, s.step, omega);
+  long out = -1;
+  size_t step = size_t(2 * BENCH_SETTLE / ts);
+  for (size_t k = step; k < omega.size(); k++)
+    if (fabs(omega[k] - 60.0) > BENCH_BAND * 40.0)
+      out = long(k);
+  if (out == long(omega.size()) - 1)
+    printf(",-1\n");
+  else
+    printf(",%.0f\n", (out < 0) ? 0.0 : (out + 1 - long(step)) * ts * 1000.0);
+}
+
+/**
+ * \brief Prints the line of an estimator on a recorded trace
+ * \param tr the trace
+ * \param est the estimator
+ */
+static void report(const trace_t& tr, estimator_t& est) {
+  const double ts = ENCODER_TIMING / 1000.0;
+  const double edge = M_PI / ENCODER_QUANTIZATION;
+  samples_t x;
+  std::vector< float > omega;
+  sample(tr, x);
+  double ns = cpu_time(est, x);
+  run(est, x, omega);
+
+  double sum = 0.0;
+  size_t n = 0, first = 0;
+  for (size_t k = size_t(BENCH_SETTLE / ts); k < omega.size(); k++) {
+    double t = (k + 1) * ts;
+    while ((first < tr.time.size()) && (tr.time[first] < t - BENCH_WINDOW))
+      first++;
+    long ticks = 0;
+    size_t last = first;
+    for (size_t e = first + 1; (e < tr.time.size()) && (tr.time[e] <= t + BENCH_WINDOW); e++) {
+      ticks += tr.direction[e];
+      last = e;
+    }
+    double ref = (last > first) ? ticks * edge / (tr.time[last] - tr.time[first]) : 0.0;
+    sum += (omega[k] - ref) * (omega[k] - ref);
+    n++;
+  }
+  printf("%s,%.1f,%.4f\n", est.name, ns, n ? sqrt(sum / n) : 0.0);
+}
+
+int main(int argc, char** argv) {
+  std::vector< estimator_t* > est;
+  est.push_back(new estimator_of_t< high_gain_obs_t< 2, ENCODER_TIMING > >("hg2"));
+  est.push_back(new estimator_of_t< high_gain_obs_t< 2, ENCODER_TIMING, q15_t > >("hg2_q15"));
+  est.push_back(new estimator_of_t< high_gain_obs_t< 2, ENCODER_TIMING, q31_t > >("hg2_q31"));
+  est.push_back(new estimator_of_t< kalman_obs_t< ENCODER_TIMING > >("kf"));
+  est.push_back(new mt_estimator_t("mt"));
+  est.push_back(new mt_observer_t< high_gain_obs_t< 2, ENCODER_TIMING > >("hg2_mt"));
+  // Candidate gains: [l1, l2, (l3,) epsilon]
+  est.push_back(new estimator_of_t< high_gain_obs_t< 2, ENCODER_TIMING, float, bench_gains_t< -5000, -6000, 50 > > >(
+      "hg2[-5,-6,0.05]"));
+  est.push_back(new estimator_of_t< high_gain_obs_t< 2, ENCODER_TIMING, float, bench_gains_t< -5000, -6000, 200 > > >(
+      "hg2[-5,-6,0.2]"));
+  est.push_back(new estimator_of_t< high_gain_obs_t< 2, ENCODER_TIMING, float, bench_gains_t< -2000, -1000, 100 > > >(
+      "hg2[-2,-1,0.1]"));
+  est.push_back(new estimator_of_t< high_gain_obs_t< 2, ENCODER_TIMING, float, bench_gains_t< -3000, -2000, 50 > > >(
+      "hg2[-3,-2,0.05]"));
+  est.push_back(new estimator_of_t< high_gain_obs_t< 3, ENCODER_TIMING, float, bench_gains_t< -5000, -6000, 100 > > >(
+      "hg3[-5,-6,-1,0.1]"));
+  est.push_back(
+      new estimator_of_t< high_gain_obs_t< 3, ENCODER_TIMING, float, bench_gains_t< -3000, -3000, 100, -1000 > > >(
+          "hg3[-3,-3,-1,0.1]"));
+
+  if (argc > 1) {
+    trace_t tr;
+    if (!load(argv[1], tr)) {
+      fprintf(stderr, "cannot read the trace %s\n", argv[1]);
+      return 1;
+    }
+    printf("estimator,ns_per_sample,rms_vs_reference\n");
+    for (size_t i = 0; i < est.size(); i++)
+      report(tr, *est[i]);
+  } else {
+    suite_t s;
+    build(s);
+    printf("estimator,ns_per_sample");
+    for (size_t i = 0; i < 4; i++)
+      printf(",lag_%ghz_deg", frequencies[i]);
+    for (size_t i = 0; i < 2; i++)
+      printf(",noise_%g_rms", speeds[i]);
+    printf(",settling_ms\n");
+    for (size_t i = 0; i < est.size(); i++)
+      report(s, *est[i]);
+  }
+
+  for (size_t i = 0; i < est.size(); i++)
+    delete est[i];
+  return 0;
+}
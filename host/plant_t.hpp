@@ -0,0 +1,149 @@
+#ifndef HOST_PLANT_T_HPP
+#define HOST_PLANT_T_HPP
+
+/**
+ * \file host/plant_t.hpp
+ * \author Matteo Ragni
+ *
+ * **Host model of the traction of the car**
+ *
+ * The class is the plant that closes the loop with the firmware on the
+ * host build. It reads the PWM written on the ESC pin, and it integrates the
+ * same Wiener model with input delay used by \p controller_t:
+ *
+ * \f{align}
+ *   \dot{x}(t) & = - a x(t) + a \mathrm{sat}(u(t - d)) \\
+ *   \omega(t) & = \phi(x(t)) = \frac{\sqrt{c_1^2 + 4 c_2 x(t)} - c_1}{2 c_2}
+ * \f}
+ *
+ * where \f$u\f$ is the ESC PWM remapped in \f$[0, 1]\f$ (the inverse of the
+ * map in \p esc_t), or in \f$[-1, 0]\f$ below the idle value (reverse, the
+ * model is symmetric: \f$\omega = \mathrm{sign}(x) \phi(|x|)\f$). The wheel
+ * angle is integrated as well, and each time it crosses a window of the encoder
+ * (\f$\pi / \mathrm{ENCODER\_QUANTIZATION}\f$) the encoder pins are toggled
+ * through \p host_hal_t::set_input, that in turn calls the pin change interrupt
+ * of the firmware. With \p ENCODER_DIRECTION_QUADRATURE the second channels
+ * are driven as well, half a window behind.
+ *
+ * The parameters default to the ones in \p configurations.hpp, but they can be
+ * changed for simulating a car that is different from the model
+ * (e.g. for testing the robustness of the controller).
+ *
+ * \warning This class is a host only class. It is not compiled for the board.
+ */
+
+#include <Arduino.h>
+#include "configurations.hpp"
+
+#define HOST_PLANT_DELAY_SIZE 16384 /**< Maximum input delay in integration steps */
+
+/** \brief Host model of the traction of the car (ESC, motor and encoders) */
+class plant_t {
+  double a;                            /**< Pole of the model (\f$a\f$) */
+  double c1;                           /**< First coefficient of the non linearity */
+  double c2;                           /**< Second coefficient of the non linearity */
+  double x;                            /**< State of the linear part of the model */
+  double theta;                        /**< Angle of the wheels (rad) */
+  double window;                       /**< Angle of an encoder window (rad) */
+  long index;                          /**< Window of the first channel (its level is the parity) */
+  long index_b;                        /**< Window of the second channel, half a window behind */
+  uint32_t dt;                         /**< Integration step in microseconds */
+  double u[HOST_PLANT_DELAY_SIZE];     /**< Delay line of the input */
+  size_t delay;                        /**< Delay in integration steps */
+  size_t head;                         /**< Head of the delay line */
+
+ public:
+  /** \brief Constructor with the nominal parameters of \p configurations.hpp
+   *
+   * \param dt_ integration step in microseconds (the host program must call
+   * \p step every \p dt_ microseconds of simulated time)
+   */
+  plant_t(uint32_t dt_) : dt(dt_) {
+    model(CTRL_MODEL_A, CTRL_NONLIN_A, CTRL_NONLIN_B, CTRL_SYSTEM_DELAY);
+    reset();
+  }
+
+  /** \brief Changes the parameters of the model
+   *
+   * \param a_ pole of the model
+   * \param c1_ first coefficient of the non linearity
+   * \param c2_ second coefficient of the non linearity
+   * \param delay_ms input delay in milliseconds
+   */
+  void model(double a_, double c1_, double c2_, uint32_t delay_ms) {
+    a = a_;
+    c1 = c1_;
+    c2 = c2_;
+    delay = (delay_ms * 1000) / dt;
+    if (delay >= HOST_PLANT_DELAY_SIZE)
+      delay = HOST_PLANT_DELAY_SIZE - 1;
+  }
+
+  /** \brief Resets the plant at rest */
+  void reset() {
+    x = 0;
+    theta = 0;
+    window = M_PI / double(ENCODER_QUANTIZATION);
+    index = 0;
+    index_b = -1;
+    head = 0;
+    for (size_t i = 0; i < HOST_PLANT_DELAY_SIZE; i++)
+      u[i] = 0;
+  }
+
+  /** \brief Integrates the plant for one step
+   *
+   * Reads the PWM on the ESC pin, integrates the model (exact discretization
+   * of the linear part) and toggles the encoder pins for each window
+   * crossed during the step, in the order of the angle.
+   */
+  void step() {
+    double pwm = double(host_hal_t::pwm_read(ESC)) - DUTY_ESC_IDLE;
+    double q = pwm / double((pwm >= 0) ? (DUTY_ESC_MAX - DUTY_ESC_IDLE) : (DUTY_ESC_IDLE - DUTY_ESC_MIN));
+    if (q < -1.0)
+      q = -1.0;
+    if (q > 1.0)
+      q = 1.0;
+    u[head] = q;
+    q = u[(head + HOST_PLANT_DELAY_SIZE - delay) % HOST_PLANT_DELAY_SIZE];
+    head = (head + 1) % HOST_PLANT_DELAY_SIZE;
+
+    double e = exp(-a * double(dt) * 1e-6);
+    x = e * x + (1 - e) * q;
+    theta += omega() * double(dt) * 1e-6;
+
+    long a = long(floor(theta / window));
+    long b = long(floor(theta / window - 0.5));
+    while ((index != a) || (index_b != b)) {
+      // Forward the first channel leads: its edges are at k, the second at k + 0.5
+      bool forward = (a > index) || (b > index_b);
+      if (forward ? (index_b < index) : (index_b == index)) {
+        index_b += forward ? 1 : -1;
+#if ENCODER_DIRECTION == ENCODER_DIRECTION_QUADRATURE
+        host_hal_t::set_input(R_WHEEL_ENCODER_B, index_b & 0x01);
+        host_hal_t::set_input(L_WHEEL_ENCODER_B, index_b & 0x01);
+#endif
+      } else {
+        index += forward ? 1 : -1;
+        host_hal_t::set_input(R_WHEEL_ENCODER, index & 0x01);
+        host_hal_t::set_input(L_WHEEL_ENCODER, index & 0x01);
+      }
+    }
+  }
+
+  /**
+   * \brief Current wheel speed of the model
+   * \return the wheel speed in rad/s (negative in reverse)
+   */
+  double omega() const {
+    double w = (sqrt(c1 * c1 + 4 * c2 * fabs(x)) - c1) / (2 * c2);
+    return (x < 0) ? -w : w;
+  }
+  /**
+   * \brief Current wheel angle of the model
+   * \return the wheel angle in rad
+   */
+  double angle() const { return theta; }
+};
+
+#endif /* HOST_PLANT_T_HPP */
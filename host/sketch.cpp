@@ -0,0 +1,30 @@
+/**
+ * \file host/sketch.cpp
+ * \author Matteo Ragni
+ *
+ * **The sketch, as the Arduino IDE builds it**
+ *
+ * The Arduino IDE concatenates all the \p .ino files of the sketch in a single
+ * translation unit: first the main sketch (\p erumby.ino), then the others in
+ * alphabetical order. The templates implemented in the \p .ino files
+ * (e.g. \p high_gain_obs_t) rely on this, thus the host build does the same.
+ *
+ * \warning Keep the list in sync with the \p .ino files of the sketch.
+ */
+
+#include <Arduino.h>
+
+#include "erumby.ino"
+
+#include "capture_reader_t.ino"
+#include "communication_t.ino"
+#include "controller_t.ino"
+#include "erumby_t.ino"
+#include "high_gain_obs_t.ino"
+#include "kalman_obs_t.ino"
+#include "lookup_table_t.ino"
+#include "profiler_t.ino"
+#include "pwm_reader_t.ino"
+#include "radio_t.ino"
+#include "ticker_t.ino"
+#include "tuner_t.ino"
@@ -0,0 +1,145 @@
+/**
+ * \file host/sp_check.cpp
+ * \author Matteo Ragni
+ *
+ * **Smith predictor with respect to its recursion**
+ *
+ * The program runs the Smith predictor of the speed controller
+ * (\p smith_predictor_t with the non linearity of the ESC, constructed with the
+ * pole only, as \p controller_t constructs its \p esc_sp_t) against a plain
+ * implementation of the recursion of its documentation, that stores the states
+ * \f$x_k\f$ in the delay and evaluates \f$\phi\f$ on the read (as the
+ * predictor did before storing the outputs). The input is a sequence of steps
+ * and random values, also outside \f$[0, 1]\f$ (saturated by the predictor).
+ * The program prints a line for each check:
+ *
+ * | Check     | Predictor                        | Reference                            |
+ * |-----------|----------------------------------|--------------------------------------|
+ * | `predict` | \p state_predict, pole only      | \f$\phi(x_k)\f$                      |
+ * | `pole`    | \p state_predict, pole only      | \f$\phi(1 - a_{sp}^k)\f$ (a step)    |
+ * | `delay`   | \p state, after \p model         | \f$\phi(x_{k-n+1})\f$                |
+ *
+ * @code
+ * <check> <max difference> <bound> <ok|FAIL>
+ * @endcode
+ *
+ * A predictor without its pole (zero gains) outputs 0, and fails the first two
+ * checks. The program fails (exit code 1) if a difference is above
+ * \p SP_CHECK_BOUND.
+ *
+ * \warning This file is a host only file. It is not compiled for the board.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <Arduino.h>
+#include "configurations.hpp"
+#include "controller_t.ino"
+#include "lookup_table_t.ino"
+
+#define SP_CHECK_STEPS 5000  /**< Steps of the predictor */
+#define SP_CHECK_BOUND 1e-3  /**< Bound of the differences (rad/s) */
+
+/** \brief The Smith predictor of the controller, with the non linearity of the ESC */
+class esc_model_t : public smith_predictor_t< CTRL_TIMING, CTRL_SYSTEM_DELAY_MAX > {
+  const float phi(const float u) const override { return controller_t< float >::phi(u); }
+
+ public:
+  /**
+   * \brief Constructor with the pole only (as \p esc_sp_t)
+   * \param a the pole of the model
+   */
+  esc_model_t(const float a) : smith_predictor_t< CTRL_TIMING, CTRL_SYSTEM_DELAY_MAX >(a) {}
+};
+
+/** \brief Recursion of the Smith predictor, with the states in the delay */
+class reference_t {
+  const float a_sp;        /**< State gain */
+  const float b_sp;        /**< Input gain */
+  std::vector< float > x;  /**< States, the last one at the back */
+
+ public:
+  /**
+   * \brief Constructor, the state is 0
+   * \param a the pole of the model
+   */
+  reference_t(const float a)
+      : a_sp(1 / (1 + a * CTRL_TIMING / 1000.0)),
+        b_sp(a_sp * a * CTRL_TIMING / 1000.0),
+        x(CTRL_SYSTEM_DELAY_MAX / CTRL_TIMING, 0.0) {}
+
+  /**
+   * \brief Steps the recursion
+   * \param u the input (saturated in \f$[0, 1]\f$)
+   */
+  void step(const float u) {
+    float q = (u < 0.0) ? 0.0 : ((u > 1.0) ? 1.0 : u);
+    x.push_back(a_sp * x.back() + b_sp * q);
+  }
+
+  /**
+   * \brief Output of the model
+   * \param n the delay in steps (1 is the last state)
+   * \return \f$\phi(x_{k-n+1})\f$
+   */
+  float output(const size_t n) const { return controller_t< float >::phi(x[x.size() - n]); }
+
+  /**
+   * \brief State gain of the discretization
+   * \return \f$a_{sp}\f$
+   */
+  float pole() const { return a_sp; }
+};
+
+/**
+ * \brief Input of the predictor at a step
+ * \param k the step
+ * \return steps of 1 s (to 1, 0.3, 0), then random values in \f$[-0.2, 1.2]\f$
+ */
+static float input(const size_t k) {
+  static const size_t second = 1000 / CTRL_TIMING;
+  if (k < 3 * second)
+    return (k < second) ? 1.0 : ((k < 2 * second) ? 0.3 : 0.0);
+  return -0.2 + 1.4 * float(rand()) / float(RAND_MAX);
+}
+
+/**
+ * \brief Prints the line of a check
+ * \param check name of the check
+ * \param max the maximum difference
+ * \return true if the difference is within the bound
+ */
+static bool report(const char* check, const double max) {
+  bool ok = max <= SP_CHECK_BOUND;
+  printf("%-8s %12.3e %10.1e %s\n", check, max, SP_CHECK_BOUND, ok ? "ok" : "FAIL");
+  return ok;
+}
+
+int main() {
+  static const size_t n = CTRL_SYSTEM_DELAY / CTRL_TIMING;
+  static const size_t second = 1000 / CTRL_TIMING;
+  esc_model_t sp(CTRL_MODEL_A), delayed(CTRL_MODEL_A);
+  reference_t ref(CTRL_MODEL_A);
+  double predict = 0, pole = 0, delay = 0;
+  bool ok = true;
+  srand(1);
+  delayed.model(CTRL_MODEL_A, CTRL_SYSTEM_DELAY);
+  printf("%-8s %12s %10s\n", "check", "max", "bound");
+
+  for (size_t k = 0; k < SP_CHECK_STEPS; k++) {
+    float u = input(k);
+    sp(u);
+    delayed(u);
+    ref.step(u);
+    predict = fmax(predict, fabs(sp.state_predict() - ref.output(1)));
+    delay = fmax(delay, fabs(delayed.state() - ref.output(n)));
+    if (k < second)
+      pole = fmax(pole, fabs(sp.state_predict() - controller_t< float >::phi(1 - pow(ref.pole(), k + 1))));
+  }
+
+  ok = report("predict", predict) && ok;
+  ok = report("pole", pole) && ok;
+  ok = report("delay", delay) && ok;
+  return ok ? 0 : 1;
+}
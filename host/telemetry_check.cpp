@@ -0,0 +1,114 @@
+/**
+ * \file host/telemetry_check.cpp
+ * \author Matteo Ragni
+ *
+ * **Telemetry of the i2c in the degraded mode**
+ *
+ * The program packs the telemetry of \p communication_t for a stand-in of
+ * \p erumby_t, and reads it as the Raspberry PI does (\p Wire::master_read).
+ * The overruns of the real time loop are emulated on the tick of \p ticker_t:
+ *
+ * | Phase      | Loop                                    | Expected telemetry                   |
+ * |------------|-----------------------------------------|--------------------------------------|
+ * | `nominal`  | on time                                 | new wheel speeds, no stale bit       |
+ * | `degraded` | \p OVERRUN_DEGRADE overruns             | old wheel speeds, \p TELEMETRY_STALE |
+ * | `recover`  | \p OVERRUN_RECOVER iterations on time   | new wheel speeds, no stale bit       |
+ *
+ * The wheel speeds of the stand-in change at each phase. In all the phases the
+ * low byte of the status must be the state of the identification. The program prints
+ * a line for each phase, and fails (exit code 1) if the telemetry is not the expected one:
+ *
+ * @code
+ * <phase> <omega_rr> <omega_rl> <status> <ok|FAIL>
+ * @endcode
+ *
+ * \warning This file is a host only file. It is not compiled for the board.
+ */
+
+#include <stdio.h>
+#include <Arduino.h>
+#include <Wire.h>
+#include "communication_t.hpp"
+#include "ticker_t.hpp"
+
+/** \brief Stand-in for \p erumby_t, with the wheel speeds set by the program */
+class check_erumby_t : public erumby_base_t {
+ public:
+  float w; /**< Speed of the wheels (rad/s) */
+
+  check_erumby_t() : w(0) {}
+  erumby_mode_t mode() { return Auto; }
+  float omega_r() { return w; }
+  float omega_l() { return w + 1.0; }
+  float omega() { return w + 0.5; }
+  float variance_r() { return 0.25; }
+  float variance_l() { return 0.25; }
+  const cmd_t traction() const { return DUTY_ESC_IDLE; }
+  void traction(cmd_t) {}
+  void speed(float) {}
+  void tune() {}
+  tune_state_t tuning() { return TuneRunning; }
+  const cmd_t steer() const { return DUTY_SERVO_MIDDLE; }
+  void steer(cmd_t) {}
+  void stop() {}
+  void alarm(const char*) {}
+  void alarm(const char*, const char*) {}
+};
+
+/**
+ * \brief One iteration of the real time loop
+ * \param overrun the next tick is raised before the end of the iteration
+ */
+static void iteration(bool overrun) {
+  ticker_t::isr();
+  ticker_t::pending();
+  if (overrun)
+    ticker_t::isr();
+  ticker_t::done();
+  if (overrun)
+    ticker_t::pending();  // the late tick is served by the next iteration
+}
+
+/**
+ * \brief Packs and reads the telemetry, and prints the line of a phase
+ * \param comms the communication
+ * \param phase name of the phase
+ * \param w expected speed of the right wheel (rad/s)
+ * \param stale the stale bit is expected
+ * \return true if the telemetry is the expected one
+ */
+static bool check(communication_t* comms, const char* phase, float w, bool stale) {
+  uint8_t data[16];
+  comms->loop_secure();
+  Wire.master_read(data, 16);
+  int16_t rr = int16_t(data[0] << 8 | data[1]), rl = int16_t(data[2] << 8 | data[3]);
+  uint16_t status = uint16_t(data[14] << 8 | data[15]);
+  bool ok = (rr == int16_t(round(100 * w))) && (rl == int16_t(round(100 * (w + 1.0)))) &&
+            (bool(status & TELEMETRY_STALE) == stale) && ((status & 0xFF) == TuneRunning);
+  printf("%-9s %6d %6d 0x%04x %s\n", phase, rr, rl, status, ok ? "ok" : "FAIL");
+  return ok;
+}
+
+int main() {
+  check_erumby_t m;
+  communication_t* comms = communication_t::create_comms(&m);
+  bool ok = true;
+  ticker_t::init();
+  printf("%-9s %6s %6s %6s\n", "phase", "rr", "rl", "status");
+
+  m.w = 10.0;
+  iteration(false);
+  ok = check(comms, "nominal", 10.0, false) && ok;
+
+  for (uint8_t i = 0; i < OVERRUN_DEGRADE; i++)
+    iteration(true);
+  m.w = 20.0;
+  bool stale = (OVERRUN_ACTIONS & DEGRADE_TELEMETRY) != 0;
+  ok = check(comms, "degraded", stale ? 10.0 : 20.0, stale) && ok;
+
+  for (uint16_t i = 0; i < OVERRUN_RECOVER; i++)
+    iteration(false);
+  m.w = 30.0;
+  ok = check(comms, "recover", 30.0, false) && ok;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,67 @@
+/**
+ * \file host/ticker_check.cpp
+ * \author Matteo Ragni
+ *
+ * **Jitter of the tick with the compare match routine held off**
+ *
+ * The program starts the tick of \p ticker_t on the emulated timer 3, and
+ * serves the ticks \p TICKER_CHECK_LATE microseconds after their compare match:
+ *
+ * | Case      | Compare match routine                                        |
+ * |-----------|--------------------------------------------------------------|
+ * | `served`  | executed at the compare match (raised counts the tick)       |
+ * | `held`    | not executed yet, only the flag \p OCF3A is set in \p TIFR3  |
+ *
+ * The second case is the one of \p pending called with the interrupts off just
+ * after a compare match: the tick must be served anyway, with the same jitter, and
+ * the routine that runs afterwards must not count an overrun in \p done. The
+ * program prints a line for each case, and fails (exit code 1) if the tick is not
+ * served, its jitter is not \p TICKER_CHECK_LATE, or an overrun is counted:
+ *
+ * @code
+ * <case> <pending> <jitter> <missed> <ok|FAIL>
+ * @endcode
+ *
+ * \warning This file is a host only file. It is not compiled for the board.
+ */
+
+#include <stdio.h>
+#include <Arduino.h>
+#include "ticker_t.hpp"
+
+#define TICKER_CHECK_LATE 100 /**< Delay of the loop after the compare match (us) */
+
+/**
+ * \brief Serves the tick of the next period, and prints the line of a case
+ * \param name name of the case
+ * \param held the compare match routine is held off (as with the interrupts off)
+ * \return true if the tick is served with the expected jitter, without overruns
+ */
+static bool check(const char* name, bool held) {
+  if (held)
+    TIMSK3 &= ~_BV(OCIE3A);
+  host_hal_t::advance(LOOP_TIMING * 1000L);
+  bool p = ticker_t::pending();
+  if (held) {
+    // The interrupts are enabled again: the routine runs, and clears its flag
+    TIMSK3 |= _BV(OCIE3A);
+    TIFR3 &= ~_BV(OCF3A);
+    ticker_t::isr();
+  }
+  ticker_t::done();
+  bool ok = p && (ticker_t::get_jitter() == TICKER_CHECK_LATE) && (ticker_t::get_missed() == 0);
+  printf("%-8s %8d %8lu %8lu %s\n", name, int(p), (unsigned long)ticker_t::get_jitter(),
+         (unsigned long)ticker_t::get_missed(), ok ? "ok" : "FAIL");
+  return ok;
+}
+
+int main() {
+  bool ok = true;
+  ticker_t::init();
+  host_hal_t::advance(TICKER_CHECK_LATE);
+  printf("%-8s %8s %8s %8s\n", "case", "pending", "jitter", "missed");
+
+  ok = check("served", false) && ok;
+  ok = check("held", true) && ok;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,146 @@
+/**
+ * \file host/tune_check.cpp
+ * \author Matteo Ragni
+ *
+ * **Identification of the speed controller on the plant model**
+ *
+ * The program runs the experiment of \p tuner_t on the plant model
+ * (\p closed_loop_t, without the controller) for plants that differ from the
+ * nominal one in \p configurations.hpp (as a new motor or battery pack):
+ *
+ * | Plant     | \f$a\f$ | \f$d\f$ (ms) | \f$c_1, c_2\f$     |
+ * |-----------|---------|--------------|--------------------|
+ * | `nominal` | 3.17    | 80           | nominal            |
+ * | `slow`    | 2.0     | 120          | nominal            |
+ * | `fast`    | 5.0     | 40           | nominal            |
+ * | `weak`    | 3.17    | 80           | 1.3 times nominal  |
+ * | `strong`  | 4.0     | 60           | 0.8 times nominal  |
+ * | `instant` | 1000    | 0            | nominal            |
+ * | `sluggish`| 0.5     | 80           | nominal            |
+ *
+ * The last two are degenerate: the time constant of `instant` is shorter than a
+ * step of the controller, and `sluggish` does not reach the steady state in
+ * \p TUNE_SETTLE. Their identification must fail (\p tuner_t::identify), and
+ * the program prints for them only the state of the identification.
+ *
+ * The experiment runs every \p CTRL_TIMING with the speed of the plant as
+ * measure. The program prints for each plant the identified parameters and
+ * their errors, then it closes the loop on the plant with the nominal
+ * parameters and with the identified ones (\p controller_t::install), on
+ * the steps 50, 120, 30 rad/s (1.5 s each):
+ *
+ * @code
+ * <plant> <a> <delay> <c1> <c2> <kp> <ki> <error a> <error c1> <error c2> <tracking nominal> <tracking tuned> <ok|FAIL>
+ * @endcode
+ *
+ * where the errors of \f$a\f$, \f$c_1\f$ and \f$c_2\f$ are relative, and the tracking
+ * is the rms of the error of the plant speed (rad/s). The program fails (exit code 1)
+ * if a relative error is above \p TUNE_CHECK_ERROR, if the delay is wrong by more than
+ * a step, if the identification does not finish, or if it finishes on a degenerate plant.
+ *
+ * \warning This file is a host only file. It is not compiled for the board.
+ */
+
+#include <stdio.h>
+#include <Arduino.h>
+#include "configurations.hpp"
+#include "controller_t.ino"
+#include "lookup_table_t.ino"
+#include "tuner_t.ino"
+#include "closed_loop_t.hpp"
+
+#define TUNE_CHECK_STEP_US 100 /**< Integration step of the plant */
+#define TUNE_CHECK_ERROR 0.1   /**< Bound of the relative errors of the identified parameters */
+#define TUNE_CHECK_SECONDS 4.5 /**< Duration of the closed loop */
+
+/** \brief Plant of the check */
+typedef struct plant_case_t {
+  const char* name; /**< Name of the plant */
+  double a;         /**< Pole */
+  uint32_t delay;   /**< Delay (ms) */
+  double c;         /**< Scale of the coefficients of the non linearity */
+  bool valid;       /**< The identification must finish */
+} plant_case_t;
+
+static const plant_case_t plants[] = {
+    {"nominal", CTRL_MODEL_A, CTRL_SYSTEM_DELAY, 1.0, true}, {"slow", 2.0, 120, 1.0, true},
+    {"fast", 5.0, 40, 1.0, true},                            {"weak", CTRL_MODEL_A, CTRL_SYSTEM_DELAY, 1.3, true},
+    {"strong", 4.0, 60, 0.8, true},                          {"instant", 1000.0, 0, 1.0, false},
+    {"sluggish", 0.5, CTRL_SYSTEM_DELAY, 1.0, false}};
+
+/**
+ * \brief Builds the plant of a case
+ * \param c the case
+ * \param plant the plant
+ */
+static void model(const plant_case_t& c, plant_t& plant) {
+  plant.model(c.a, c.c * CTRL_NONLIN_A, c.c * CTRL_NONLIN_B, c.delay);
+  plant.reset();
+}
+
+/**
+ * \brief Runs the experiment on a plant
+ * \param c the case
+ * \param tuner the tuner, at the end of the experiment
+ */
+static void experiment(const plant_case_t& c, tuner_t& tuner) {
+  closed_loop_t< float > l(TUNE_CHECK_STEP_US);
+  double omega = 0;
+  model(c, l.get_plant());
+
+  tuner.start();
+  while (tuner.state() == TuneRunning)
+    omega = l.actuate(tuner(float(omega)));
+}
+
+static double stairs(double t) { return (t < 1.5) ? 50.0 : ((t < 3.0) ? 120.0 : 30.0); }
+
+static const profile_t profile = {"stairs", stairs, 3.0}; /**< Reference of the closed loop */
+
+/**
+ * \brief Closes the loop on a plant
+ * \param c the case
+ * \param params the parameters of the controller
+ * \return the rms of the tracking error
+ */
+static double loop(const plant_case_t& c, const ctrl_params_t& params) {
+  closed_loop_t< float > l(TUNE_CHECK_STEP_US);
+  model(c, l.get_plant());
+  l.get_controller().install(params);
+  return l.run(profile, TUNE_CHECK_SECONDS, NULL);
+}
+
+int main() {
+  bool ok = true;
+  printf("%-8s %6s %5s %10s %10s %8s %8s %7s %7s %7s %8s %8s\n", "plant", "a", "delay", "c1", "c2", "kp", "ki", "err a",
+         "err c1", "err c2", "nominal", "tuned");
+  for (size_t i = 0; i < sizeof(plants) / sizeof(plants[0]); i++) {
+    const plant_case_t& c = plants[i];
+    tuner_t tuner;
+    experiment(c, tuner);
+    if (!c.valid) {
+      bool rejected = tuner.state() == TuneFailed;
+      printf("%-8s identification %s %s\n", c.name, rejected ? "rejected" : "accepted", rejected ? "ok" : "FAIL");
+      ok = rejected && ok;
+      continue;
+    }
+    if (tuner.state() != TuneDone) {
+      printf("%-8s identification failed FAIL\n", c.name);
+      ok = false;
+      continue;
+    }
+
+    const ctrl_params_t& p = tuner.params();
+    double ea = fabs(p.a - c.a) / c.a;
+    double e1 = fabs(p.c1 - c.c * CTRL_NONLIN_A) / (c.c * CTRL_NONLIN_A);
+    double e2 = fabs(p.c2 - c.c * CTRL_NONLIN_B) / (c.c * CTRL_NONLIN_B);
+    long ed = long(p.delay) - long(c.delay);
+    bool good = (ea <= TUNE_CHECK_ERROR) && (e1 <= TUNE_CHECK_ERROR) && (e2 <= TUNE_CHECK_ERROR) &&
+                (ed <= long(CTRL_TIMING)) && (ed >= -long(CTRL_TIMING));
+    printf("%-8s %6.3f %5u %10.3e %10.3e %8.5f %8.5f %7.3f %7.3f %7.3f %8.3f %8.3f %s\n", c.name, p.a,
+           unsigned(p.delay), p.c1, p.c2, p.kp, p.ki, ea, e1, e2, loop(c, ctrl_params_nominal()), loop(c, p),
+           good ? "ok" : "FAIL");
+    ok = good && ok;
+  }
+  return ok ? 0 : 1;
+}
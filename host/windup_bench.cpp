@@ -0,0 +1,96 @@
+/**
+ * \file host/windup_bench.cpp
+ * \author Matteo Ragni
+ *
+ * **Settling of the speed controller with and without anti-windup**
+ *
+ * The program closes the loop of \p controller_t on the plant model
+ * (\p closed_loop_t), as \p ctrl_compare. Each profile runs twice: once
+ * without limits (the integral of the PI grows also while \p esc_t saturates
+ * the control) and once with the limits of \p esc_t (\p controller_t::limits,
+ * as on the board). The reference profiles are:
+ *
+ * | Profile    | Reference                                          |
+ * |------------|----------------------------------------------------|
+ * | `step`     | step to 150 rad/s                                  |
+ * | `high`     | step to 210 rad/s (close to \f$\phi(1)\f$)         |
+ * | `down`     | 180 rad/s, step to 40 rad/s at 2.5 s               |
+ * | `ramp`     | from 0 to 200 rad/s in 1 s                         |
+ * | `overload` | 250 rad/s (not reachable) for 2 s, then 100 rad/s  |
+ *
+ * Each profile lasts \p WINDUP_SECONDS. The program prints a line for each
+ * profile and controller:
+ *
+ * @code
+ * <profile> <controller> <anti-windup> <overshoot> <settling> <tracking rms>
+ * @endcode
+ *
+ * where the overshoot (rad/s) and the settling time (ms) are measured after
+ * the last change of the reference: the settling time is the time after which
+ * the speed stays within \p WINDUP_BAND of the final reference (a settling
+ * time as long as the rest of the profile means that the speed did not settle).
+ * The tracking rms (rad/s) is evaluated on the whole profile.
+ *
+ * \warning This file is a host only file. It is not compiled for the board.
+ */
+
+#include <stdio.h>
+#include <Arduino.h>
+#include "configurations.hpp"
+#include "controller_t.ino"
+#include "lookup_table_t.ino"
+#include "closed_loop_t.hpp"
+
+#define WINDUP_SECONDS 6.0 /**< Duration of a profile */
+#define WINDUP_STEP_US 100 /**< Integration step of the plant */
+#define WINDUP_BAND 0.02   /**< Settling band, relative to the final reference */
+
+static double step(double) { return 150.0; }
+static double high(double) { return 210.0; }
+static double down(double t) { return (t < 2.5) ? 180.0 : 40.0; }
+static double ramp(double t) { return (t < 1.0) ? 200.0 * t : 200.0; }
+static double overload(double t) { return (t < 2.0) ? 250.0 : 100.0; }
+
+static const profile_t profiles[] = {
+    {"step", step, 0.0}, {"high", high, 0.0}, {"down", down, 2.5}, {"ramp", ramp, 1.0}, {"overload", overload, 2.0}};
+
+#define WINDUP_SAMPLES (size_t(WINDUP_SECONDS * 1000.0) / CTRL_TIMING) /**< Control steps of a profile */
+
+/**
+ * \brief Closes the loop on the plant for a profile and prints its line
+ *
+ * \tparam T arithmetic of the controller
+ * \param p the profile
+ * \param controller name of the controller
+ * \param anti_windup the controller has the limits of \p esc_t
+ */
+template < typename T >
+static void loop(const profile_t& p, const char* controller, bool anti_windup) {
+  static double omega[WINDUP_SAMPLES];
+  closed_loop_t< T > l(WINDUP_STEP_US, anti_windup);
+  double tracking = l.run(p, WINDUP_SECONDS, omega), overshoot = 0, settled = 0;
+
+  for (size_t k = 0; k < WINDUP_SAMPLES; k++) {
+    double t = double(k * CTRL_TIMING) / 1000.0;
+    double r = p.omega(t), e = omega[k] - r;
+    if (t < p.last)
+      continue;
+    double o = (r > p.omega(0) || p.last == 0) ? e : -e;  // beyond the reference, in the direction of the step
+    overshoot = (o > overshoot) ? o : overshoot;
+    if (fabs(e) > WINDUP_BAND * r)
+      settled = t + double(CTRL_TIMING) / 1000.0 - p.last;
+  }
+  printf("%-9s %-10s %-5s %10.3f %10.0f %10.3f\n", p.name, controller, anti_windup ? "on" : "off", overshoot,
+         settled * 1000.0, tracking);
+}
+
+int main() {
+  printf("%-9s %-10s %-5s %10s %10s %10s\n", "profile", "controller", "aw", "overshoot", "settling", "tracking");
+  for (size_t i = 0; i < sizeof(profiles) / sizeof(profiles[0]); i++) {
+    loop< float >(profiles[i], "float", false);
+    loop< float >(profiles[i], "float", true);
+    loop< q15_t >(profiles[i], "q15", false);
+    loop< q15_t >(profiles[i], "q15", true);
+  }
+  return 0;
+}
@@ -0,0 +1,232 @@
+#ifndef ISR_SHARED_T_HPP
+#define ISR_SHARED_T_HPP
+
+/**
+ * \file isr_shared_t.hpp
+ * \author Matteo Ragni
+ *
+ * **Tear free snapshots of the state shared with the interrupt routines**
+ *
+ * The AVR reads and writes a single byte at a time: a 16 bit (or larger)
+ * variable written by an interrupt routine may be read by the loop half before
+ * and half after the interrupt (a torn read). The same holds for a structure
+ * written by the loop and read by an interrupt routine. The classes in this
+ * file give consistent snapshots without disabling the interrupts:
+ *
+ * | Class             | Writer            | Reader            | Technique       |
+ * |-------------------|-------------------|-------------------|-----------------|
+ * | \p seqlock_t      | interrupt routine | loop              | sequence counter|
+ * | \p double_buffer_t| loop              | interrupt routine | double buffer   |
+ *
+ * Both rely on the fact that on a single core the interrupt routine is never
+ * interrupted by the loop: the routine always completes its access. The
+ * interrupt side must be a single writer that is not reentrant: a writer
+ * interrupted by another write of the same value (a nested interrupt routine,
+ * declared with \p ISR_NOBLOCK or enabling the interrupts with \p sei) would
+ * leave an even sequence on a half written value. The writes and the
+ * read-modify-write of the counters are thus done in an \p isr_guard_t, that
+ * costs a few cycles in a routine with the interrupts already disabled.
+ *
+ * Counters of events in an interrupt routine do not need a snapshot: the routine
+ * increments a free running counter, and the loop takes the (modular)
+ * difference with the last value it has seen (see \p pwm_reader_base_t::take_counter).
+ * The loop never writes the counter, thus no event is lost. A counter larger
+ * than a byte is read with \p read_counter.
+ */
+
+#include <Arduino.h>
+
+/** \brief Compiler barrier: memory accesses are not moved across it */
+#define ISR_SHARED_BARRIER() __asm__ __volatile__("" ::: "memory")
+
+/** \brief Interrupts disabled for the lifetime of the guard
+ *
+ * The constructor saves the status register and disables the interrupts, the
+ * destructor restores the status register (thus the interrupts are enabled
+ * again only if they were enabled before, as \p ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+ * of avr-libc). In an interrupt routine (not nested) the interrupts are
+ * already disabled, and the guard changes nothing.
+ *
+ * Usage example:
+ * @code
+ * void interrupt_callback() {
+ *   isr_guard_t guard;
+ *   ticks_t c = counter + 1;  // not interrupted by another edge
+ *   counter = c;
+ *   stamp.write(edge_stamp_t{c, micros()});
+ * }
+ * @endcode
+ */
+class isr_guard_t {
+  uint8_t sreg; /**< Status register at the construction */
+
+ public:
+  /** \brief Saves the status register, and disables the interrupts */
+  isr_guard_t() : sreg(SREG) {
+    cli();
+    ISR_SHARED_BARRIER();
+  }
+  /** \brief Restores the status register (and the interrupt flag) */
+  ~isr_guard_t() {
+    ISR_SHARED_BARRIER();
+    SREG = sreg;
+  }
+};
+
+/** \brief Value written by an interrupt routine and read by the loop
+ *
+ * The writer increments the sequence before and after the write: the
+ * sequence is odd while the value is being written. The reader copies the value
+ * and repeats the copy if the sequence was odd, or changed during the copy.
+ * The loop retries only if an interrupt lands inside the copy, and the copy
+ * is a few cycles long.
+ *
+ * Usage example:
+ * @code
+ * seqlock_t< pulse_t > pulse;
+ *
+ * ISR(PCINT0_vect) {
+ *   pulse.write(micros() - edge);
+ * }
+ *
+ * void real_time_loop() {
+ *   pulse_t p = pulse.read();  // never torn
+ * }
+ * @endcode
+ *
+ * \warning Only one writer (a single interrupt routine, not reentrant).
+ * \tparam T type of the value (copyable)
+ */
+template < typename T >
+class seqlock_t {
+  T value;               /**< The shared value */
+  volatile uint8_t seq;  /**< Sequence: odd while the writer is writing */
+
+ public:
+  /** \brief Empty constructor, the value is default constructed */
+  seqlock_t() : value(), seq(0) {}
+  /**
+   * \brief Constructor with an initial value
+   * \param v the initial value
+   */
+  seqlock_t(const T& v) : value(v), seq(0) {}
+
+  /** \brief Writes the value (writer side, inside the interrupt routine)
+   *
+   * The write is never interrupted (see \p isr_guard_t): a nested write
+   * would leave the sequence even on a torn value.
+   *
+   * \param v the new value
+   */
+  void write(const T& v) {
+    isr_guard_t guard;
+    seq++;
+    ISR_SHARED_BARRIER();
+    value = v;
+    ISR_SHARED_BARRIER();
+    seq++;
+  }
+
+  /** \brief Last written value (writer side only, no check)
+   *
+   * \return the value
+   */
+  const T& peek() const { return value; }
+
+  /** \brief Consistent copy of the value (reader side)
+   *
+   * \return the value
+   */
+  T read() const {
+    uint8_t s;
+    T v;
+    do {
+      s = seq;
+      ISR_SHARED_BARRIER();
+      v = value;
+      ISR_SHARED_BARRIER();
+    } while ((s & 0x01) || (s != seq));
+    return v;
+  }
+};
+
+/** \brief Consistent read of a counter incremented by an interrupt routine
+ *
+ * The counter is read twice, until the two reads are equal. A torn read mixes
+ * the low byte before an increment with the high byte after it (or vice versa),
+ * and it never equals the value after the increment, thus two equal reads are
+ * not torn. The counter must change by one (up or down) at each event.
+ *
+ * \tparam T type of the counter (integer)
+ * \param c the counter
+ * \return the value of the counter
+ */
+template < typename T >
+inline T read_counter(const volatile T& c) {
+  T v;
+  do {
+    v = c;
+  } while (v != c);
+  return v;
+}
+
+/** \brief Value written by the loop and read by an interrupt routine
+ *
+ * The loop writes the back buffer, then publishes it by flipping the
+ * front index (a single byte). The routine reads the front buffer, that the
+ * loop never writes. After the flip, the new back buffer is a copy of the front,
+ * thus the loop may update only some fields.
+ *
+ * Usage example:
+ * @code
+ * double_buffer_t< outdata_t > out;
+ *
+ * void real_time_loop() {
+ *   out.back().omega = get_omega();
+ *   out.publish();
+ * }
+ *
+ * void on_request() {  // i2c interrupt
+ *   send(out.front());
+ * }
+ * @endcode
+ *
+ * \warning Only one writer (the loop).
+ * \tparam T type of the value (copyable)
+ */
+template < typename T >
+class double_buffer_t {
+  T buffer[2];             /**< Front and back buffers */
+  volatile uint8_t index;  /**< Index of the front buffer */
+
+ public:
+  /** \brief Empty constructor, the buffers are value initialized (zero for plain structures) */
+  double_buffer_t() : buffer(), index(0) {}
+
+  /** \brief Back buffer (writer side)
+   *
+   * \return the buffer to write (it is published by \p publish)
+   */
+  T& back() { return buffer[index ^ 0x01]; }
+
+  /** \brief Publishes the back buffer (writer side)
+   *
+   * The back buffer becomes the front buffer, and the new back
+   * buffer is initialized with a copy of it.
+   */
+  void publish() {
+    uint8_t next = index ^ 0x01;
+    ISR_SHARED_BARRIER();
+    index = next;
+    ISR_SHARED_BARRIER();
+    buffer[next ^ 0x01] = buffer[next];
+  }
+
+  /** \brief Front buffer (reader side, inside the interrupt routine)
+   *
+   * \return the last published value
+   */
+  const T& front() const { return buffer[index]; }
+};
+
+#endif /* ISR_SHARED_T_HPP */
@@ -0,0 +1,212 @@
+#ifndef KALMAN_OBS_HPP
+#define KALMAN_OBS_HPP
+
+/**
+ * \file kalman_obs_t.hpp
+ * \author Matteo Ragni
+ *
+ * The class implements a steady state Kalman filter for the angle of a wheel,
+ * an alternative to \p high_gain_obs_t that gives also the variance of the
+ * estimated speed. The model is a constant acceleration, driven by a white jerk,
+ * sampled every \f$t_s\f$ and observed through the angle of the encoder:
+ *
+ * \f{align}
+ *   x_k & = F x_{k-1} + w_k, & F & = \begin{bmatrix} 1 & t_s & t_s^2/2 \\ 0 & 1 & t_s \\ 0 & 0 & 1 \end{bmatrix} \\
+ *   y_k & = H x_k + v_k, & H & = \begin{bmatrix} 1 & 0 & 0 \end{bmatrix}
+ * \f}
+ *
+ * with \f$x = [\theta, \omega, \alpha]^\top\f$, \f$\mathrm{E}[v_k^2] = r\f$ (\p KF_MEASUREMENT_NOISE)
+ * and the covariance of \f$w_k\f$ given by the spectral density \f$q\f$ of the jerk
+ * (\p KF_PROCESS_NOISE):
+ *
+ * \f[
+ *   Q = q \begin{bmatrix} t_s^5/20 & t_s^4/8 & t_s^3/6 \\ t_s^4/8 & t_s^3/3 & t_s^2/2 \\ t_s^3/6 & t_s^2/2 & t_s \end{bmatrix}
+ * \f]
+ *
+ * The gain is the steady state one: the Riccati equation is iterated by the
+ * compiler, and the filter runs only the prediction and the correction of the
+ * state (no covariance update on the board).
+ */
+
+#include <Arduino.h>
+#include "configurations.hpp"
+#include "types.hpp"
+
+/** \brief Symmetric \f$3 \times 3\f$ covariance (a literal type, for the constexpr code) */
+struct kf_covariance_t {
+  double p00; /**< \f$P(0, 0)\f$ */
+  double p01; /**< \f$P(0, 1)\f$ */
+  double p02; /**< \f$P(0, 2)\f$ */
+  double p11; /**< \f$P(1, 1)\f$ */
+  double p12; /**< \f$P(1, 2)\f$ */
+  double p22; /**< \f$P(2, 2)\f$ */
+
+  /** \brief Constructor from the upper triangle */
+  constexpr kf_covariance_t(const double a00, const double a01, const double a02, const double a11, const double a12,
+                            const double a22)
+      : p00(a00), p01(a01), p02(a02), p11(a11), p12(a12), p22(a22) {}
+};
+
+/** \brief Steady state solution of the Kalman filter, at compile time
+ *
+ * With the prior covariance \f$P\f$, the correction is (\f$H\f$ selects the angle):
+ *
+ * \f[
+ *   K = \frac{P H^\top}{H P H^\top + r}, \qquad P^+ = P - K H P
+ * \f]
+ *
+ * and the prediction is \f$F P^+ F^\top + Q\f$. The iteration starts from
+ * \f$P = 0\f$ and it is evaluated \p steps times (the recursion halves the steps,
+ * thus its depth is only logarithmic).
+ *
+ * \tparam MILLIS discretization time step in milliseconds
+ */
+template < timing_t MILLIS >
+struct kf_discretization_t {
+  static constexpr size_t steps = 4096; /**< Iterations of the Riccati equation */
+
+  /** \brief Time step of the filter (s) */
+  static constexpr double ts() { return double(MILLIS) / 1000.0; }
+  /** \brief \f$t_s^2 / 2\f$ */
+  static constexpr double h() { return ts() * ts() / 2.0; }
+  /** \brief Spectral density of the jerk */
+  static constexpr double q() { return KF_PROCESS_NOISE; }
+  /** \brief Variance of the angle measure */
+  static constexpr double r() { return KF_MEASUREMENT_NOISE; }
+
+  /** \brief Correction of the covariance \f$P^+ = P - K H P\f$ */
+  static constexpr kf_covariance_t update(const kf_covariance_t p) {
+    return kf_covariance_t(p.p00 - p.p00 * p.p00 / (p.p00 + r()), p.p01 - p.p00 * p.p01 / (p.p00 + r()),
+                           p.p02 - p.p00 * p.p02 / (p.p00 + r()), p.p11 - p.p01 * p.p01 / (p.p00 + r()),
+                           p.p12 - p.p01 * p.p02 / (p.p00 + r()), p.p22 - p.p02 * p.p02 / (p.p00 + r()));
+  }
+  /** \brief Prediction of the covariance \f$F P F^\top + Q\f$ */
+  static constexpr kf_covariance_t predict(const kf_covariance_t p) {
+    return kf_covariance_t(
+        p.p00 + 2 * ts() * p.p01 + 2 * h() * p.p02 + ts() * ts() * p.p11 + 2 * ts() * h() * p.p12 + h() * h() * p.p22 +
+            q() * ts() * ts() * ts() * ts() * ts() / 20.0,
+        p.p01 + ts() * p.p11 + h() * p.p12 + ts() * (p.p02 + ts() * p.p12 + h() * p.p22) +
+            q() * ts() * ts() * ts() * ts() / 8.0,
+        p.p02 + ts() * p.p12 + h() * p.p22 + q() * ts() * ts() * ts() / 6.0,
+        p.p11 + 2 * ts() * p.p12 + ts() * ts() * p.p22 + q() * ts() * ts() * ts() / 3.0,
+        p.p12 + ts() * p.p22 + q() * ts() * ts() / 2.0, p.p22 + q() * ts());
+  }
+  /** \brief \p n iterations of the Riccati equation from the prior \p p */
+  static constexpr kf_covariance_t riccati(const kf_covariance_t p, const size_t n) {
+    return (n == 0) ? p : ((n == 1) ? predict(update(p)) : riccati(riccati(p, n / 2), n - n / 2));
+  }
+  /** \brief Steady state prior covariance */
+  static constexpr kf_covariance_t prior() { return riccati(kf_covariance_t(0, 0, 0, 0, 0, 0), steps); }
+  /** \brief Steady state covariance after the correction */
+  static constexpr kf_covariance_t posterior() { return update(prior()); }
+  /** \brief Gain of the steady state filter
+   * \param i the state (0 angle, 1 speed, 2 acceleration)
+   */
+  static constexpr double gain(const size_t i) {
+    return ((i == 0) ? prior().p00 : ((i == 1) ? prior().p01 : prior().p02)) / (prior().p00 + r());
+  }
+  /** \brief The iteration converged: one more step does not change the gains (relative \f$10^{-6}\f$) */
+  static constexpr bool converged() {
+    return (riccati(prior(), 1).p00 - prior().p00 <= 1e-6 * prior().p00) &&
+           (prior().p00 - riccati(prior(), 1).p00 <= 1e-6 * prior().p00) &&
+           (riccati(prior(), 1).p02 - prior().p02 <= 1e-6 * prior().p02) &&
+           (prior().p02 - riccati(prior(), 1).p02 <= 1e-6 * prior().p02);
+  }
+};
+
+/** \brief Steady state Kalman filter for the angle, speed and acceleration of a wheel
+ *
+ * The filter has the interface of \p high_gain_obs_t (the two are
+ * alternatives in \p encoder_t, see \p ENCODER_SPEED), and the variance of
+ * the estimated speed. The gains and the variance are constants evaluated by
+ * the compiler (see \p kf_discretization_t): the filter keeps in RAM only its state.
+ *
+ * As \p high_gain_obs_t, the filter can run \p C independent channels in a
+ * single pass (the states are interleaved by channel).
+ *
+ * Usage example:
+ * @code
+ * kalman_obs_t< ENCODER_TIMING > kf;
+ * float omega = kf(theta);
+ * float sigma = sqrt(kf.variance());
+ * @endcode
+ *
+ * \warning The variance is the one of the model: it holds if the wheel follows the
+ * model (the acceleration is a random walk with the density \p KF_PROCESS_NOISE),
+ * after the transient of the filter.
+ *
+ * \tparam MILLIS discretization time step in milliseconds
+ * \tparam C number of channels
+ */
+template < timing_t MILLIS, size_t C = 1 >
+class kalman_obs_t {
+  typedef kf_discretization_t< MILLIS > D; /**< Steady state solution */
+
+  static_assert(D::converged(), "kalman_obs_t: the Riccati equation did not converge, check the noises");
+
+  static constexpr float k0 = D::gain(0);          /**< Gain of the angle */
+  static constexpr float k1 = D::gain(1);          /**< Gain of the speed */
+  static constexpr float k2 = D::gain(2);          /**< Gain of the acceleration */
+  static constexpr float ts = D::ts();             /**< Time step of the filter (s) */
+  static constexpr float h = D::h();               /**< \f$t_s^2/2\f$ */
+  static constexpr float var = D::posterior().p11; /**< Variance of the speed */
+
+  float x[3][C]; /**< State of the filter: angle, speed and acceleration, interleaved by channel */
+
+ public:
+  /** \brief Empty constructor, the state is zero (the gains are constants) */
+  kalman_obs_t() : x() {}
+
+  /** \brief Evaluates the next step of all the channels
+   *
+   * Predicts the state with the model and corrects it with the
+   * innovation \f$e = y - H F \hat{x}\f$.
+   *
+   * \param y last observations (the angles)
+   * \param w the estimated speeds
+   */
+  void operator()(const float (&y)[C], float (&w)[C]);
+
+  /** \brief Evaluates the next step of the filter (one channel)
+   *
+   * \param y last observation (the angle)
+   * \return the estimated speed
+   */
+  const float operator()(const float y);
+
+  /** \brief Resets the internal state of the filter (all the channels) */
+  void reset();
+
+  /** \brief Shifts the origin of the observed angle
+   *
+   * The filter is invariant to a constant offset on the angle and on the
+   * first state (as \p high_gain_obs_t::rebase).
+   *
+   * \param delta the shift of the input
+   * \param c the channel
+   */
+  void rebase(const float delta, const size_t c = 0);
+
+  /**
+   * \brief Variance of the estimated speed
+   * \return the steady state variance of the speed ((rad/s)\f$^2\f$)
+   */
+  static const float variance() { return var; }
+
+  /**
+   * \brief Attribute reader for the internal state of the filter
+   * \param i index of the i-th state of the filter
+   * \param c the channel
+   * \return the value of the i-th state of the filter
+   */
+  const float state(const size_t i, const size_t c = 0) const { return x[i][c]; }
+
+  /**
+   * \brief Attribute reader for the internal state of the filter (first channel)
+   * \param i index of the i-th state of the filter
+   * \return the value of the i-th state of the filter
+   */
+  const float operator[](const size_t i) const { return state(i); }
+};
+
+#endif /* KALMAN_OBS_HPP */
@@ -0,0 +1,36 @@
+#include "kalman_obs_t.hpp"
+
+template < timing_t MILLIS, size_t C >
+void kalman_obs_t< MILLIS, C >::operator()(const float (&y)[C], float (&w)[C]) {
+  for (size_t k = 0; k < C; k++) {
+    float theta = x[0][k] + ts * x[1][k] + h * x[2][k];
+    float omega = x[1][k] + ts * x[2][k];
+    float e = y[k] - theta;
+
+    x[0][k] = theta + k0 * e;
+    x[1][k] = omega + k1 * e;
+    x[2][k] = x[2][k] + k2 * e;
+    w[k] = x[1][k];
+  }
+}
+
+template < timing_t MILLIS, size_t C >
+const float kalman_obs_t< MILLIS, C >::operator()(const float y) {
+  static_assert(C == 1, "kalman_obs_t: the scalar step is for a single channel");
+  float in[1] = {y};
+  float out[1];
+  (*this)(in, out);
+  return out[0];
+}
+
+template < timing_t MILLIS, size_t C >
+void kalman_obs_t< MILLIS, C >::reset() {
+  for (size_t i = 0; i < 3; i++)
+    for (size_t k = 0; k < C; k++)
+      x[i][k] = 0.0;
+}
+
+template < timing_t MILLIS, size_t C >
+void kalman_obs_t< MILLIS, C >::rebase(const float delta, const size_t c) {
+  x[0][c] += delta;
+}
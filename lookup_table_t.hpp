@@ -16,9 +16,28 @@
  * Evaluation requires the time for searching the mnearest breakpoint,
  * a sum and a multiplication. The longer the table the longer the
  * searching time (there is no searching cache).
+ *
+ * A table of a known function can be built instead by the compiler, in
+ * the flash (\p lookup_table_t with a generator): the breakpoints are
+ * evenly spaced, thus the segment is found with a multiplication (no
+ * searching, the length of the table costs only flash).
  */
 
 #include <Arduino.h>
+#include "types.hpp"
+
+/** \brief 1-D linear interpolating lookup table
+ *
+ * Without a generator (\p G is \p void) the table is built at runtime, in
+ * RAM, from the breakpoints (see \p lookup_table_t<T, B, void>). With a
+ * generator the table is built by the compiler, in the flash.
+ *
+ * \tparam T type used in the lookup table (input and output must be equal)
+ * \tparam B number of breakpoints for the lookup table.
+ * \tparam G generator of the table (\p void for a table in RAM)
+ */
+template < typename T, size_t B, typename G = void >
+class lookup_table_t;
 
 /** \brief 1-D linear interpolating lookup table
  * 
@@ -59,7 +78,7 @@
  * \tparam B number of breakpoints for the lookup table.
  */
 template < typename T, size_t B >
-class lookup_table_t {
+class lookup_table_t< T, B, void > {
   T x[B + 1]; /**< Stores breakpoint values for searching, increased by one */
   T m[B + 1]; /**< Stores interpolation coefficient */
   T q[B + 1]; /**< Stores offset coeffient */
@@ -184,4 +203,129 @@ class lookup_table_t {
   const T x_max() const { return x[B]; }
 };
 
+/** \brief Coefficients of a lookup table built by the compiler, in the flash
+ *
+ * \tparam L the table (\p lookup_table_t with a generator)
+ * \tparam I the indexes of the coefficients
+ */
+template < typename L, typename I = typename make_indices_t< L::size >::type >
+struct lookup_flash_t;
+
+/** \brief Coefficients of a lookup table built by the compiler, in the flash
+ *
+ * \tparam L the table (\p lookup_table_t with a generator)
+ * \tparam I the indexes of the coefficients
+ */
+template < typename L, size_t... I >
+struct lookup_flash_t< L, indices_t< I... > > {
+  static const float data[sizeof...(I)]; /**< Offset and slope of each segment (read with \p pgm_read_float) */
+};
+
+template < typename L, size_t... I >
+const float lookup_flash_t< L, indices_t< I... > >::data[sizeof...(I)] PROGMEM = {float(L::entry(I))...};
+
+/** \brief 1-D linear interpolating lookup table of a known function, in the flash
+ *
+ * The compiler samples the function of the generator on \p B evenly
+ * spaced breakpoints, and stores offset and slope of each segment in the
+ * flash. The evaluation finds the segment with a multiplication, reads two
+ * coefficients and interpolates: the time does not depend on \p B. Outside
+ * the domain the table saturates at the first and at the last value.
+ *
+ * The generator is a class with the static \p constexpr functions:
+ *
+ * | Function          | Description                                                 |
+ * |-------------------|-------------------------------------------------------------|
+ * | `x_min()`         | first breakpoint                                            |
+ * | `x_max()`         | last breakpoint                                             |
+ * | `f(x)`            | the function                                                |
+ * | `curvature(a, b)` | an upper bound of \f$|f''|\f$ in \f$[a, b]\f$               |
+ *
+ * The bound of the curvature gives the maximum error of the linear
+ * interpolation on a segment of width \f$h\f$:
+ *
+ * \f[
+ *   |f(x) - \hat{f}(x)| \leq \frac{h^2}{8} \max_{[x_i, x_{i+1}]} |f''|
+ * \f]
+ *
+ * and \p error is the maximum on the segments, evaluated by the compiler
+ * (thus it can be checked with a \p static_assert). The rounding of the
+ * coefficients to float adds about one unit in the last place of \f$f\f$.
+ *
+ * Usage example:
+ * @code
+ * struct square_t {
+ *   static constexpr double x_min() { return 0.0; }
+ *   static constexpr double x_max() { return 1.0; }
+ *   static constexpr double f(const double x) { return x * x; }
+ *   static constexpr double curvature(const double, const double) { return 2.0; }
+ * };
+ * typedef lookup_table_t< float, 33, square_t > square_table_t;
+ * static_assert(square_table_t::error() < 1e-3, "square_table_t: too few breakpoints");
+ * float z = square_table_t::eval(0.5);  // z is 0.25
+ * @endcode
+ *
+ * \tparam T \p float (the coefficients are read with \p pgm_read_float)
+ * \tparam B number of breakpoints for the lookup table (at least 2)
+ * \tparam G generator of the table
+ */
+template < typename T, size_t B, typename G >
+class lookup_table_t {
+  static_assert(B >= 2, "lookup_table_t: a table needs at least two breakpoints");
+  static_assert((sizeof(T) == sizeof(float)) && (T(0.5) != T(0)), "lookup_table_t: the tables in the flash are float");
+
+  static constexpr T first = G::x_min();                        /**< First breakpoint */
+  static constexpr T last = G::x_max();                         /**< Last breakpoint */
+  static constexpr T low = G::f(G::x_min());                    /**< Value below the first breakpoint */
+  static constexpr T high = G::f(G::x_max());                   /**< Value above the last breakpoint */
+  static constexpr T scale = (B - 1) / (G::x_max() - G::x_min()); /**< Segments for unit of the input */
+
+  /** \brief Maximum interpolation error on the segments \f$i, \dots, i + n - 1\f$ (halves the range) */
+  static constexpr double error(const size_t i, const size_t n) {
+    return (n == 1) ? width() * width() / 8.0 * G::curvature(breakpoint(i), breakpoint(i + 1))
+                    : ((error(i, n / 2) > error(i + n / 2, n - n / 2)) ? error(i, n / 2) : error(i + n / 2, n - n / 2));
+  }
+
+ public:
+  static constexpr size_t size = 2 * (B - 1); /**< Number of the coefficients in the flash */
+
+  /** \brief Width of a segment */
+  static constexpr double width() { return (G::x_max() - G::x_min()) / double(B - 1); }
+  /** \brief The i-th breakpoint */
+  static constexpr double breakpoint(const size_t i) { return G::x_min() + width() * double(i); }
+  /** \brief Slope of the i-th segment */
+  static constexpr double slope(const size_t i) { return (G::f(breakpoint(i + 1)) - G::f(breakpoint(i))) / width(); }
+  /** \brief Offset of the i-th segment (the value in zero of its line) */
+  static constexpr double offset(const size_t i) { return G::f(breakpoint(i)) - slope(i) * breakpoint(i); }
+  /** \brief The k-th coefficient in the flash: offset and slope, for each segment */
+  static constexpr double entry(const size_t k) { return (k % 2 == 0) ? offset(k / 2) : slope(k / 2); }
+  /** \brief Upper bound of the interpolation error on the domain */
+  static constexpr double error() { return error(0, B - 1); }
+
+  /** \brief Evaluates using the table
+   *
+   * \param z input in the lookup table
+   * \return evaluated point from the lookup table
+   */
+  static const T eval(T z);
+
+  /** \brief Evaluates using the table
+   *
+   * \param z input in the lookup table
+   * \return evaluated point from the lookup table
+   */
+  const T operator()(T z) const { return eval(z); }
+
+  /**
+   * \brief Minimum breakpoint value
+   * \return minimum breakpoint value
+   */
+  const T x_min() const { return first; }
+  /**
+   * \brief Maximum breakpoint value
+   * \return maximum breakpoint value
+   */
+  const T x_max() const { return last; }
+};
+
 #endif /* LOOKUP_TABLE_T_HPP */
\ No newline at end of file
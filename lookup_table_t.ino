@@ -1,7 +1,7 @@
 #include "lookup_table_t.hpp"
 
 template < typename T, size_t B >
-void lookup_table_t< T, B >::init(const T x_[B], const T y_[B]) {
+void lookup_table_t< T, B, void >::init(const T x_[B], const T y_[B]) {
   T y[B + 1];
 
   for (size_t i = 0; i < B; i++) {
@@ -26,7 +26,7 @@ void lookup_table_t< T, B >::init(const T x_[B], const T y_[B]) {
 }
 
 template < typename T, size_t B >
-const bool lookup_table_t< T, B >::is_valid() const {
+const bool lookup_table_t< T, B, void >::is_valid() const {
   for (size_t i = 1; i < B; i++) {
     if (x[i] <= x[i - 1])
       return false;
@@ -35,9 +35,22 @@ const bool lookup_table_t< T, B >::is_valid() const {
 }
 
 template < typename T, size_t B >
-const T lookup_table_t< T, B >::eval(T z) const {
+const T lookup_table_t< T, B, void >::eval(T z) const {
   size_t i = 0;
   while ((z >= x[i]) && (i < B))
     i++;
   return q[i] + m[i] * z;
-}
\ No newline at end of file
+}
+
+template < typename T, size_t B, typename G >
+const T lookup_table_t< T, B, G >::eval(T z) {
+  if (z <= first)
+    return low;
+  if (z >= last)
+    return high;
+  size_t i = size_t((z - first) * scale);
+  if (i > B - 2)
+    i = B - 2;
+  const float* c = lookup_flash_t< lookup_table_t >::data + 2 * i;
+  return pgm_read_float(c) + pgm_read_float(c + 1) * z;
+}
@@ -0,0 +1,139 @@
+#ifndef PROFILER_T_HPP
+#define PROFILER_T_HPP
+
+/**
+ * \file profiler_t.hpp
+ * \author Matteo Ragni
+ *
+ * **Per stage profiler of the real time loop**
+ *
+ * The profiler measures how the \p LOOP_TIMING budget is split between the
+ * stages of the loop (the tasks of \p scheduler_t, and the whole
+ * \p erumby_t::loop). The time base is the counter of timer 3 (see
+ * \p ticker_t::count), that runs freely at 0.5 us per count: taking a
+ * timestamp costs a 16 bit register read, with no call to \p micros.
+ *
+ * For each stage the profiler keeps:
+ *  - number of samples, minimum, maximum and mean duration
+ *  - a histogram with \p PROFILER_BINS logarithmic bins:
+ *
+ * | Bin | Duration        |
+ * |-----|-----------------|
+ * | 0   | < 8 us          |
+ * | 1   | [8, 16) us      |
+ * | 2   | [16, 32) us     |
+ * | ... | ...             |
+ * | 7   | >= 512 us       |
+ *
+ * The statistics are printed on the Serial by \p report, one stage per call, and
+ * the stage is reset after printing (the statistics of a line are relative to the
+ * window since the previous line of the same stage). The report is scheduled as a
+ * low rate task, thus the car never stops. Each line is in the form:
+ *
+ * @code
+ * P <stage> <samples> <min us> <mean us> <max us> <bin 0> ... <bin 7>
+ * @endcode
+ *
+ * The profiler is compiled only if \p PROFILER is defined (it is not by
+ * default in \p configurations.hpp, the host build defines it).
+ *
+ * \warning A stage longer than \p LOOP_TIMING cannot be measured (the counter
+ * wraps each period).
+ */
+
+#include <Arduino.h>
+#include "configurations.hpp"
+#include "ticker_t.hpp"
+#include "types.hpp"
+
+#define PROFILER_STAGES 12                     /**< Number of stages in the profiler */
+#define PROFILER_LOOP (PROFILER_STAGES - 1)    /**< Stage for the whole \p erumby_t::loop */
+#define PROFILER_BINS 8                        /**< Number of bins in the histogram */
+#define PROFILER_BIN_SHIFT 4                   /**< The first bin is for less than 2^4 counts (8 us) */
+
+/** \brief Per stage profiler of the real time loop
+ *
+ * The class is a static class, since there is only one real time loop.
+ *
+ * Usage example:
+ * @code
+ * uint16_t t = profiler_t::start();
+ * enc->loop();
+ * profiler_t::stop(0, t);
+ * @endcode
+ */
+class profiler_t {
+  /** \brief Statistics of a stage */
+  typedef struct stage_t {
+    const char* name;              /**< Name of the stage (\p NULL if unused) */
+    uint16_t samples;              /**< Number of samples */
+    uint16_t min;                  /**< Minimum duration (counts) */
+    uint16_t max;                  /**< Maximum duration (counts) */
+    uint32_t sum;                  /**< Sum of the durations (counts) */
+    uint16_t hist[PROFILER_BINS];  /**< Histogram of the durations */
+  } stage_t;
+
+  static stage_t stages[PROFILER_STAGES]; /**< Statistics of the stages */
+  static uint8_t next;                    /**< Next stage to report */
+
+ public:
+  /** \brief Initializes the statistics and the Serial */
+  static void init();
+
+  /**
+   * \brief Sets the name of a stage (a stage without name is never reported)
+   * \param stage the stage
+   * \param name the name (a string literal, it is not copied)
+   */
+  static void name(const uint8_t stage, const char* name) {
+    if (stage < PROFILER_STAGES)
+      stages[stage].name = name;
+  }
+
+  /**
+   * \brief Timestamp of the start of a stage
+   * \return the timestamp to pass to \p stop
+   */
+  static inline uint16_t start() { return ticker_t::count(); }
+
+  /**
+   * \brief Records the duration of a stage
+   * \param stage the stage
+   * \param t0 the timestamp returned by \p start
+   */
+  static void stop(const uint8_t stage, const uint16_t t0);
+
+  /** \brief Prints the statistics of the next stage and resets it */
+  static void report();
+
+  /**
+   * \brief Resets the statistics of a stage
+   * \param stage the stage
+   */
+  static void reset(const uint8_t stage);
+
+  /**
+   * \brief Number of samples of a stage
+   * \param stage the stage
+   * \return the number of samples since the last reset
+   */
+  static uint16_t samples(const uint8_t stage) { return stages[stage].samples; }
+  /**
+   * \brief Maximum duration of a stage
+   * \param stage the stage
+   * \return the maximum duration since the last reset (us)
+   */
+  static float max(const uint8_t stage) { return float(stages[stage].max) * 1000.0 / TICKER_COUNTS_PER_MS; }
+  /**
+   * \brief Mean duration of a stage
+   * \param stage the stage
+   * \return the mean duration since the last reset (us)
+   */
+  static float mean(const uint8_t stage) {
+    if (!stages[stage].samples)
+      return 0;
+    return float(stages[stage].sum) * 1000.0 / (float(stages[stage].samples) * TICKER_COUNTS_PER_MS);
+  }
+};
+
+#endif /* PROFILER_T_HPP */
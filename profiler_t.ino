@@ -0,0 +1,81 @@
+#include "profiler_t.hpp"
+
+#ifdef PROFILER
+
+profiler_t::stage_t profiler_t::stages[PROFILER_STAGES];
+uint8_t profiler_t::next = 0;
+
+void profiler_t::init() {
+  for (uint8_t i = 0; i < PROFILER_STAGES; i++) {
+    stages[i].name = NULL;
+    reset(i);
+  }
+  name(PROFILER_LOOP, "loop");
+  next = 0;
+  Serial.begin(SERIAL_SPEED);
+}
+
+void profiler_t::stop(const uint8_t stage, const uint16_t t0) {
+  uint16_t t1 = ticker_t::count();
+  uint16_t d = (t1 >= t0) ? (t1 - t0) : (t1 + TICKER_COUNTS - t0);
+  stage_t& s = stages[stage];
+
+  if (s.samples == 0xFFFF)
+    return;
+  s.samples++;
+  s.sum += d;
+  if (d < s.min)
+    s.min = d;
+  if (d > s.max)
+    s.max = d;
+
+  uint8_t bin = 0;
+  d >>= PROFILER_BIN_SHIFT;
+  while (d && (bin < PROFILER_BINS - 1)) {
+    d >>= 1;
+    bin++;
+  }
+  s.hist[bin]++;
+}
+
+void profiler_t::report() {
+  if (ticker_t::degraded(DEGRADE_PROFILER))
+    return;
+  for (uint8_t i = 0; i < PROFILER_STAGES; i++) {
+    uint8_t stage = next;
+    next = (next + 1) % PROFILER_STAGES;
+    if (!stages[stage].name || !stages[stage].samples)
+      continue;
+
+    stage_t& s = stages[stage];
+    Serial.print("P ");
+    Serial.print(s.name);
+    Serial.print(' ');
+    Serial.print(s.samples, DEC);
+    Serial.print(' ');
+    Serial.print((s.min * 1000L) / TICKER_COUNTS_PER_MS, DEC);
+    Serial.print(' ');
+    Serial.print(long(mean(stage)), DEC);
+    Serial.print(' ');
+    Serial.print((s.max * 1000L) / TICKER_COUNTS_PER_MS, DEC);
+    for (uint8_t b = 0; b < PROFILER_BINS; b++) {
+      Serial.print(' ');
+      Serial.print(s.hist[b], DEC);
+    }
+    Serial.println();
+    reset(stage);
+    return;
+  }
+}
+
+void profiler_t::reset(const uint8_t stage) {
+  stage_t& s = stages[stage];
+  s.samples = 0;
+  s.min = 0xFFFF;
+  s.max = 0;
+  s.sum = 0;
+  for (uint8_t b = 0; b < PROFILER_BINS; b++)
+    s.hist[b] = 0;
+}
+
+#endif
@@ -13,22 +13,26 @@
  *
  * There are two classes of pins which are considered:
  *  - pins for which the \p attachInterrupt function can be used, which
- *    are handled by \p pwm_reader_attachable_t and have a digital read
+ *    are handled by \p pwm_reader_attachable_t
  *  - pins for which we must configure the registers to intercept the
  *    interrupts, which are handled by \p pwm_reader_t
  *
- * The implementation is made in a way that for the user the declaration
- * of a pwm input pin as simple as possible. For example:
+ * Both classes are templates on the pin: the port, the position of the pin
+ * in the port and the interrupt are resolved at compile time (see
+ * \p pcint_pin_t and \p attachable_pin_t), and a pin that cannot be
+ * read does not compile. For example:
  * @code
- * pwm_reader_t pwm = pwm_reader_t(52); // Attach to pin 52
+ * pwm_reader_t< 52 > pwm; // Attach to pin 52
  *
  * // to get the current read
  * pwm.get_pulse();
+ *
+ * pwm_reader_t< 7 > err; // error: the pin has no pin change interrupt
  * @endcode
  *
  * For the specific board considered:
  *  - attachable pins: 2, 3, 18, 19, 20, 21 (no more can be added)
- *  - non-attachable pin: 52, 53, A8, A9 (more can be implemented)
+ *  - non-attachable pin: 10 to 13 and 50 to 53 (port B), A8 to A15 (port K)
  *
  * The non attachable interrupt are particularly troublesome, because
  * it is necessary to set up the registers. For each pin it is necessary
@@ -36,6 +40,12 @@
  *  - the belonging port (e.g. 52 and 53 are in PORT_B, A8 and A9 in PORT_K)
  *  - the position on the port (also known as mask, a 8-bit value)
  *
+ * Each port has a single interrupt routine. The routine reads the port once,
+ * and compares it with the previous reading: only the readers of the pins that
+ * changed are called, through a table indexed by the position of the pin
+ * in the port (an edge of the encoder does not cost a call to the readers of the
+ * other pins of the port).
+ *
  * The algorithm for reading the pulse is quite simple, and it is performed
  * in an interrupt routine:
  * @code
@@ -46,114 +56,192 @@
  *    evaluate the pulse time
  *  @endcode
  * The classes have also a counter and a stabilized pulse value for some
- * specific applications.
+ * specific applications. The pulses are shared with the loop through a
+ * \p seqlock_t (never torn), and the counter is free running (see
+ * \p pwm_reader_base_t::take_counter).
+ *
+ * A \p pwm_reader_t publishes the count and the timestamp of the last edge
+ * (\p pwm_reader_base_t::last_edge, used by the encoders to measure the period
+ * between edges).
  */
 
 #include <Arduino.h>
 #include "configurations.hpp"
+#include "isr_shared_t.hpp"
 #include "types.hpp"
 
 #define DUTY_MODE_DELTA 500                      /**< A delta for reading the mode (erumby remote specific) */
 #define DUTY_MODE_STABILIZER 10                  /**< Number of read for stabilization */
-typedef void (*pwm_attachable_callback_t)(void); /**< Callback type for attachable pins */
-typedef pin_t (*pwm_port_reader_t)(void);        /**< Callback for non attachable pins */
+#define PWM_READER_TICKS_PER_MS 1000             /**< Time base of the edge timestamps (\p micros) */
+#define PCINT_PORT_B 0                           /**< Pin change group of port B (\p PCINT0_vect, \p PCMSK0) */
+#define PCINT_PORT_K 2                           /**< Pin change group of port K (\p PCINT2_vect, \p PCMSK2) */
 
-/** \brief Class for reading non attachable pins
+/** \brief Last edge of a reader, published by the interrupt routine */
+typedef struct edge_stamp_t {
+  ticks_t count;  /**< free running counter of the edges, the last one included */
+  timing_t time;  /**< timestamp of the last edge */
+} edge_stamp_t;
+
+/** \brief Compile time description of a pin with pin change interrupt
  *
- * Looking at the Arduino documentation there are only few pins
- * which are interrupt capable. This class allows to use pins that are not
- * in that list to read pwms, even if this requires some additonal informations
+ * The pin change interrupts of the Arduino Mega header are on two ports:
  *
- * The class reads the pwm on some interrupt cabable, non attachable pin.
- * This means that we need to handle the register configuration to make the
- * microcontroller to check for interrupts. Three informations are rquired for
- * the setup:
- *  - number of pin
- *  - which port the pin belongs (each port handles 8 pins)
- *  - map of the pin on the port (position in the port of the pin)
- * this information must be hardcoded in the class. As for now the information
- * have been coded only for the following pins:
+ * | Pin        | Port              | Map                         |
+ * |------------|-------------------|-----------------------------|
+ * | 53 ... 50  | `B (PCINT0_vect)` | `0b 0000 0001` ... `0b 0000 1000` |
+ * | 10 ... 13  | `B (PCINT0_vect)` | `0b 0001 0000` ... `0b 1000 0000` |
+ * | A8 ... A15 | `K (PCINT2_vect)` | `0b 0000 0001` ... `0b 1000 0000` |
  *
- * | Pin | Port              | Map            |
- * |-----|-------------------|----------------|
- * | 52  | `B (PCINT0_vect)` | `0b 0000 0010` |
- * | 53  | `B (PCINT0_vect)` | `0b 0000 0001` |
- * | A8  | `K (PCINT2_vect)` | `0b 0000 0001` |
- * | A9  | `K (PCINT2_vect)` | `0b 0000 0010` |
+ * Any other pin fails the \p static_assert.
  *
- * For each port there is only 1 interrupt routine, thus the interrupt callback
- * handles if we have a modification on our pin or not.
+ * \tparam PIN the pin on the board
+ */
+template < pin_t PIN >
+struct pcint_pin_t {
+  static const bool on_port_B = ((PIN >= 50) && (PIN <= 53)) || ((PIN >= 10) && (PIN <= 13)); /**< The pin is on port B */
+  static const bool on_port_K = (PIN >= A8) && (PIN <= A8 + 7);                                /**< The pin is on port K */
+  static_assert(on_port_B || on_port_K, "pwm_reader_t: the pin has no pin change interrupt (port B or K)");
+
+  static const uint8_t group = on_port_B ? PCINT_PORT_B : PCINT_PORT_K;                        /**< Pin change group */
+  static const uint8_t index = (on_port_B ? (PIN >= 50 ? 53 - PIN : PIN - 6) : PIN - A8) & 0x07; /**< Position in the port */
+  static const pin_t map = 1 << index;                                                         /**< Mask of the pin in the port */
+};
+
+/** \brief Compile time description of an attachable pin
+ *
+ * | Pin | Interrupt | Port | Map            |
+ * |-----|-----------|------|----------------|
+ * | 2   | 0         | `E`  | `0b 0001 0000` |
+ * | 3   | 1         | `E`  | `0b 0010 0000` |
+ * | 18  | 5         | `D`  | `0b 0000 1000` |
+ * | 19  | 4         | `D`  | `0b 0000 0100` |
+ * | 20  | 3         | `D`  | `0b 0000 0010` |
+ * | 21  | 2         | `D`  | `0b 0000 0001` |
  *
- * \warning Do not inherit from this class!
- * \warning If the pin connected does not belong to the table the
- * sketch blocks the execution showing an error, by pulsing the led of the board.
- * The error code is a loop of `[ + + + + - + - + - ]`:
- *  - On for 2s,
- *  - Off for 0.5s,
- *  - On for 0.5s,
- *  - Off for 0.5s,
- *  - On for 0.5s,
- *  - Off for 0.5s
+ * Any other pin fails the \p static_assert.
+ *
+ * \tparam PIN the pin on the board
  */
-class pwm_reader_t {
-  pin_t pin;                     /**< physical pin on the board */
-  pin_t map;                     /**< position of the pin in the port */
-  pulse_t edge_time;             /**< timing of the last high edge */
-  pin_t read;                    /**< last pin reading (high/low) */
-  pulse_t pulse;                 /**< duration of the high edge (the pwm reading) */
-  counter_t counter;             /**< counter (actually used for the encoder) */
-  pwm_port_reader_t port_reader; /**< reader for the specific pin */
+template < pin_t PIN >
+struct attachable_pin_t {
+  static const int8_t irq = digitalPinToInterrupt(PIN);                              /**< External interrupt number */
+  static_assert(irq >= 0, "pwm_reader_attachable_t: the pin is not attachable (2, 3, 18, 19, 20, 21)");
+
+  static const bool on_port_E = (PIN == 2) || (PIN == 3);                            /**< The pin is on port E (else D) */
+  static const pin_t map = 1 << ((on_port_E ? PIN + 2 : 21 - PIN) & 0x07);          /**< Mask of the pin in the port */
+  /**
+   * \brief Level of the pin (a single read of the input register)
+   * \return non zero if the pin is high
+   */
+  static inline pin_t level() { return (on_port_E ? PINE : PIND) & map; }
+};
+
+/** \brief State and port routines shared by all the \p pwm_reader_t
+ *
+ * The class holds the reading of a pin and the tables of the
+ * port routines, that are shared by the readers of all the pins.
+ * The readers are created only through \p pwm_reader_t.
+ *
+ * The readers are registered by address in the port tables, thus
+ * they cannot be copied.
+ *
+ * \warning Do not inherit from this class (except \p pwm_reader_t)!
+ */
+class pwm_reader_base_t {
+  pulse_t edge_time;             /**< timing of the last high edge (interrupt routine only) */
+  seqlock_t< pulse_t > pulse;    /**< duration of the high edge (the pwm reading) */
+  volatile ticks_t counter;      /**< free running counter of the edges (actually used for the encoder) */
+  ticks_t taken;                 /**< value of \p counter at the last take (loop only) */
+  volatile steps_t steps;        /**< free running counter of the edges, with the direction (quadrature) */
+  steps_t steps_taken;           /**< value of \p steps at the last take (loop only) */
+  pin_t direction_map;           /**< map of the quadrature channel in the port (0 if none) */
+  seqlock_t< edge_stamp_t > stamp; /**< count and timestamp of the last edge */
 
  public:
-  static pwm_reader_t* portB[8]; /**< pointer to pin with pwm on port B. Never manually edit this value. */
-  static pwm_reader_t* portK[8]; /**< pointer to pin with pwm on port K. Never manually edit this value. */
-  static pin_t portB_count;      /**< number of pin connected on port B. Never manually edit this value. */
-  static pin_t portK_count;      /**< number of pin connected on port K. Never manually edit this value. */
+  static pwm_reader_base_t* portB[8]; /**< reader of each pin of port B, by position (\p NULL if none). Never manually edit this value. */
+  static pwm_reader_base_t* portK[8]; /**< reader of each pin of port K, by position (\p NULL if none). Never manually edit this value. */
+  static pin_t portB_mask;            /**< mask of the pins of port B with a reader. Never manually edit this value. */
+  static pin_t portK_mask;            /**< mask of the pins of port K with a reader. Never manually edit this value. */
+  static pin_t portB_last;            /**< last reading of port B. Never manually edit this value. */
+  static pin_t portK_last;            /**< last reading of port K. Never manually edit this value. */
 
-  /** \brief Constructor for the pwm reader
-   *
-   * The constructor uses some of the static functions in order to get
-   * port and map and register the interrut callback for this pin to the
-   * overall callback of the port.
-   * It may raise an alarm if the pin is not included in the following table:
+  pwm_reader_base_t(const pwm_reader_base_t&) = delete;            /**< Not copyable (registered by address) */
+  pwm_reader_base_t& operator=(const pwm_reader_base_t&) = delete; /**< Not copyable (registered by address) */
+
+  /** \brief Interrupt callback of the pin
    *
-   * | Pin | Port              | Map            |
-   * |-----|-------------------|----------------|
-   * | 52  | `B (PCINT0_vect)` | `0b 0000 0010` |
-   * | 53  | `B (PCINT0_vect)` | `0b 0000 0001` |
-   * | A8  | `K (PCINT2_vect)` | `0b 0000 0001` |
-   * | A9  | `K (PCINT2_vect)` | `0b 0000 0010` |
+   * The callback is called by the routine of the port only when
+   * the pin has changed. The callback evaluates the duration of the pwm pulse.
+   * In this case, since it is used by the encoder, there is also some
+   * counter handling: the count and the timestamp of the edge are published
+   * (\p last_edge).
+   * With a quadrature channel, the edge is a step forward if the channel has
+   * a level different from the pin after the edge, else it is a step backward.
    *
-   * \param pin_ the pin for reading the pwm
+   * \param level the new level of the pin (non zero if high)
+   * \param port current reading of the port (for the quadrature channel)
+   * \param c_time the time of the edge (\p micros)
    */
-  pwm_reader_t(pin_t pin_) : pin(pin_), pulse(0), counter(0), read(0), edge_time(0) {
-    map = pwm_reader_t::pin_map(pin);
-    port_reader = pwm_reader_t::get_port_reader(pin);
-    pwm_reader_t::init_interrupt(this);
-  }
+  void interrupt_callback(const pin_t level, const pin_t port, const timing_t c_time);
 
-  /** \brief Interrupt callback registered at pin creation
+  /**
+   * \brief Current time, in the time base of the edge timestamps
+   * \return the current time (\p micros)
+   */
+  timing_t now() const { return micros(); }
+
+  /** \brief Count and timestamp of the last edge
    *
-   * This interrupt callback is registered for execution at object
-   * construction. The callback reads the status of the pin and evaluates
-   * the duration of the pwm pulse.
-   * In this case, since it is used by the encoder, there is also some
-   * counter handling.
+   * The two values are a consistent pair: the difference of the counts of
+   * two stamps is the number of edges between the two timestamps.
+   *
+   * \return the last edge (a count of 0 and time 0 if there are no edges)
    */
-  void interrupt_callback();
+  inline const edge_stamp_t last_edge() const { return stamp.read(); }
 
   /**
    * \brief Get current counter value
-   * \return the  number of impulse passed by since last reset
+   * \return the number of edges since the last reset (or take)
    */
-  inline const counter_t get_counter() { return counter; }
-  /** \brief Resets the counter to 0 */
-  inline void reset_counter() { counter = 0; }
+  inline const ticks_t get_counter() const { return read_counter(counter) - taken; }
+  /** \brief Resets the counters to 0 (the edges not yet taken are discarded) */
+  inline void reset_counter() {
+    taken = read_counter(counter);
+    steps_taken = read_counter(steps);
+  }
+  /** \brief Takes the edges since the last take (or reset)
+   *
+   * The interrupt routine increments a free running counter, that is never
+   * written by the loop: the edges landing between two calls are counted by
+   * the next call, none is lost. The counter has 16 bit, and the difference is
+   * modular: it is exact up to 65535 edges between two takes.
+   *
+   * \return the number of edges since the last take (or reset)
+   */
+  inline const ticks_t take_counter() {
+    ticks_t c = read_counter(counter);
+    ticks_t n = c - taken;
+    taken = c;
+    return n;
+  }
+  /** \brief Takes the steps since the last take (or reset)
+   *
+   * As \p take_counter, but the edges backward (see \p pwm_reader_t::quadrature)
+   * are subtracted. Without quadrature channel all the edges are forward.
+   *
+   * \return the steps since the last take (or reset), exact up to 32767 in a direction
+   */
+  inline const steps_t take_steps() {
+    steps_t c = read_counter(steps);
+    steps_t n = c - steps_taken;
+    steps_taken = c;
+    return n;
+  }
   /**
    * \brief Get the current pulse reading
    * \return the width of the last pulse since the last interrupt call
    */
-  inline const pulse_t get_pulse() { return pulse; }
+  inline const pulse_t get_pulse() const { return pulse.read(); }
 
   /** \brief The actual interrupt service routine for port B
    *
@@ -162,12 +250,12 @@ class pwm_reader_t {
    * The registration of the callback shall be done as follows:
    *
    * @code
-   * ISR(PCINT0_vect, ISR_NOBLOCK) {
-   *   pwm_reader_t::portB_isr();
+   * ISR(PCINT0_vect) {
+   *   pwm_reader_base_t::portB_isr();
    * }
    * @endcode
    *
-   * this is included in the implementation file \p pwm_reader_t.cpp
+   * this is included in the implementation file \p pwm_reader_t.ino
    */
   static void portB_isr();
 
@@ -178,16 +266,30 @@ class pwm_reader_t {
    * The registration of the callback shall be done as follows:
    *
    * @code
-   * ISR(PCINT2_vect, ISR_NOBLOCK) {
-   *   pwm_reader_t::portK_isr();
+   * ISR(PCINT2_vect) {
+   *   pwm_reader_base_t::portK_isr();
    * }
    * @endcode
    *
-   * this is included in the implementation file \p pwm_reader_t.cpp
+   * this is included in the implementation file \p pwm_reader_t.ino
    */
   static void portK_isr();
 
- private:
+ protected:
+  /** \brief Empty reader (not registered) */
+  pwm_reader_base_t()
+      : edge_time(0), pulse(0), counter(0), taken(0), steps(0), steps_taken(0), direction_map(0), stamp() {}
+
+  /** \brief Sets the quadrature channel
+   *
+   * \param map the map of the channel in the port of the pin (0 for none)
+   */
+  void set_direction_map(const pin_t map) {
+    noInterrupts();
+    direction_map = map;
+    interrupts();
+  }
+
   /** \brief Inits the interrupts on port B
    *
    * The function sets the pin as input with pullup, then
@@ -196,11 +298,13 @@ class pwm_reader_t {
    * register).
    * \warning Never use directly this function
    *
-   * \param pwm current \p pwm_reader_t obect pointer (\p this)
+   * \param pwm current reader pointer (\p this)
+   * \param pin the pin of the reader
+   * \param index the position of the pin in the port
    */
-  static void init_port_B(pwm_reader_t* pwm);
-  
-  /** \brief Inits the interrupts on port B
+  static void init_port_B(pwm_reader_base_t* pwm, const pin_t pin, const uint8_t index);
+
+  /** \brief Inits the interrupts on port K
    *
    * The function sets the pin as input with pullup, then
    * enables in the register \p PCMSK2 (pin change mask register
@@ -208,109 +312,137 @@ class pwm_reader_t {
    * register).
    * \warning Never use directly this function
    *
-   * \param pwm current \p pwm_reader_t obect pointer (\p this)
+   * \param pwm current reader pointer (\p this)
+   * \param pin the pin of the reader
+   * \param index the position of the pin in the port
    */
-  static void init_port_K(pwm_reader_t* pwm);
+  static void init_port_K(pwm_reader_base_t* pwm, const pin_t pin, const uint8_t index);
 
-  /** \brief Returns the map for a specific pin
-   *
-   * The function contains the map for each pin, where the map
-   * is the position of the pin in the port.
+ private:
+  /** \brief Calls the readers of the pins that changed
    *
-   * \param pin the pin for which the map is required
-   * \return the map for the pin
+   * \param table the readers of the port, by position of the pin
+   * \param changed mask of the pins that changed
+   * \param port current reading of the port
    */
-  static pin_t pin_map(pin_t pin);
+  static inline void dispatch(pwm_reader_base_t* const table[8], pin_t changed, const pin_t port) {
+    timing_t c_time = micros();
+    pin_t bit = 0x01;
+    for (uint8_t i = 0; changed; i++, changed >>= 1, bit <<= 1) {
+      if (changed & 0x01)
+        table[i]->interrupt_callback(port & bit, port, c_time);
+    }
+  }
+};
 
-  /** \brief Initialize the interrupt port
-   *
-   * Calls the correct port to initialize in function
-   * of the pin and the map.
+/** \brief Class for reading non attachable pins
+ *
+ * Looking at the Arduino documentation there are only few pins
+ * which are interrupt capable. This class allows to use pins that are not
+ * in that list to read pwms, even if this requires some additonal informations
+ *
+ * The class reads the pwm on some interrupt cabable, non attachable pin.
+ * This means that we need to handle the register configuration to make the
+ * microcontroller to check for interrupts. Three informations are rquired for
+ * the setup:
+ *  - number of pin
+ *  - which port the pin belongs (each port handles 8 pins)
+ *  - map of the pin on the port (position in the port of the pin)
+ * the port and the map are evaluated at compile time from the pin
+ * (\p pcint_pin_t). The pins currently used on the car are:
+ *
+ * | Pin | Port              | Map            |
+ * |-----|-------------------|----------------|
+ * | 52  | `B (PCINT0_vect)` | `0b 0000 0010` |
+ * | 53  | `B (PCINT0_vect)` | `0b 0000 0001` |
+ * | A8  | `K (PCINT2_vect)` | `0b 0000 0001` |
+ * | A9  | `K (PCINT2_vect)` | `0b 0000 0010` |
+ *
+ * For each port there is only 1 interrupt routine, thus the interrupt callback
+ * handles if we have a modification on our pin or not.
+ *
+ * \warning A pin without pin change interrupt does not compile.
+ * \tparam PIN the pin for reading the pwm
+ */
+template < pin_t PIN >
+class pwm_reader_t : public pwm_reader_base_t {
+  typedef pcint_pin_t< PIN > pcint; /**< Port and map of the pin */
+
+ public:
+  /** \brief Constructor for the pwm reader
    *
-   * \param pwm current \p pwm_reader_t obect pointer (\p this)
+   * The constructor registers the reader in the table of the
+   * port of the pin, and enables the pin change interrupt of the pin.
    */
-  static void init_interrupt(pwm_reader_t* pwm);
+  pwm_reader_t() {
+    if (pcint::group == PCINT_PORT_B)
+      init_port_B(this, PIN, pcint::index);
+    else
+      init_port_K(this, PIN, pcint::index);
+  }
 
-  /** \brief Returns the reading of the pin
+  /** \brief Reads the direction from a quadrature channel
    *
-   * Returns the reader for the pin of the port. This function
-   * returns a lambda with the procedure for reading the port.
+   * The second channel of a quadrature encoder is read in the interrupt
+   * routine of the pin (it has no interrupt), thus it must be on the same
+   * port: a channel on another port does not compile. Each edge of the pin
+   * is a step forward if the channel has a different level after the edge
+   * (the pin leads the channel), backward otherwise (see \p take_steps).
    *
-   * \param pin the pin to read
-   * \return the lambda that reads the port
+   * \tparam PIN_B the pin of the quadrature channel
    */
-  static pwm_port_reader_t get_port_reader(pin_t pin);
-
- public:
-  /** \brief Alarm function */
-  static void interrupt_error();
+  template < pin_t PIN_B >
+  void quadrature() {
+    static_assert(pcint_pin_t< PIN_B >::group == pcint::group,
+                  "pwm_reader_t: the quadrature channel must be on the port of the pin");
+    pinMode(PIN_B, INPUT_PULLUP);
+    set_direction_map(pcint_pin_t< PIN_B >::map);
+  }
 };
 
 /** \brief Class for an attachable pin that reads PWM
- * 
+ *
  * The class uses the number of pin to attack a callback for reading
  * the PWM value. Only pin that support \p attachInterrupt can be handled with this
- * class. As for now this class has been written for the Arduino Mega, which 
+ * class. As for now this class has been written for the Arduino Mega, which
  * has the following pin attachable: 2, 3, 18, 19, 20, 21. Requiring a pin different
- * from this one makes the arduino to fall in a error loop.
- * 
- * This class is written for **fastly varying** PWM signals and in fact internally 
+ * from this one does not compile.
+ *
+ * Each pin has its own callback (a static function of the class for the pin),
+ * that reads the input register of the port of the pin, without the
+ * lookups of \p digitalRead.
+ *
+ * This class is written for **fastly varying** PWM signals and in fact internally
  * it has some stabilization techniques for the PWM signal (in form of delays).
- * 
- * \warning If the pin connected does not belong to the set (2, 3, 18, 19, 20, 21) the
- * sketch blocks the execution showing an error, by pulsing the led of the board.
- * The error code is a loop of `[ + + + + - + - + - ]`:
- *  - On for 2s,
- *  - Off for 0.5s,
- *  - On for 0.5s,
- *  - Off for 0.5s,
- *  - On for 0.5s,
- *  - Off for 0.5s
- * 
- * \param pin_ a valid pin from which the user wants to read the PWM
+ *
+ * \warning Only one reader for each pin.
+ * \tparam PIN a valid pin from which the user wants to read the PWM
  */
+template < pin_t PIN >
 class pwm_reader_attachable_t {
-  pin_t pin;          /**< physical pin on the board */
-  pulse_t pulse;      /**< duration of the high edge (the pwm reading) */
-  pulse_t pulse_real; /**< a stabilized version of the reading (for fast varying signals) */
-  pulse_t edge_time;  /**< timing of the last high edge */
-  counter_t counter;  /**< counter (actually used for the encoder) */
-  pin_t read;         /**< Last reading of the pin, for triggering pulse width evaluation */
+  typedef attachable_pin_t< PIN > attachable; /**< Interrupt and port of the pin */
+
+  seqlock_t< pulse_t > pulse;      /**< duration of the high edge (the pwm reading) */
+  seqlock_t< pulse_t > pulse_real; /**< a stabilized version of the reading (for fast varying signals) */
+  pulse_t edge_time;               /**< timing of the last high edge (interrupt routine only) */
+  counter_t counter;               /**< counter of the readings far from \p pulse_real (interrupt routine only) */
 
  public:
-  static uint8_t pin_counter; /**< Number of pin attached with respect to total */
-  static pwm_reader_attachable_t* pin_table[6]; /**< Table of attached pin reference for callbacks */
-  static const pwm_attachable_callback_t callbacks[6]; /**< Actual callbacks for pin */
+  static pwm_reader_attachable_t* self; /**< The reader of the pin, for the callback. Never manually edit this value. */
 
   /** \brief Constructor for an attachable pin that reads PWM
-   * 
-   * The constructor uses the number of pin to attack a callback for reading
-   * the PWM value. Only pin that support \p attachInterrupt can be handled with this
-   * class. As for now this class has been written for the Arduino Mega, which 
-   * has the following pin attachable: 2, 3, 18, 19, 20, 21. Requiring a pin different
-   * from this one makes the arduino to fall in a error loop.
-   * 
-   * \warning If the pin connected does not belong to the set (2, 3, 18, 19, 20, 21) the
-   * sketch blocks the execution showing an error, by pulsing the led of the board.
-   * The error code is a loop of `[ + + + + - + - + - ]`:
-   *  - On for 2s,
-   *  - Off for 0.5s,
-   *  - On for 0.5s,
-   *  - Off for 0.5s,
-   *  - On for 0.5s,
-   *  - Off for 0.5s
-   * 
-   * \param pin_ a valid pin from which the user wants to read the PWM
+   *
+   * The constructor attaches the callback of the pin to the
+   * external interrupt of the pin.
    */
-  pwm_reader_attachable_t(pin_t pin_) : pin(pin_) {
-    counter = 0;
-    pulse = 0;
-    pulse_real = 0;
-    edge_time = 0;
-    read = 0;
-    pwm_reader_attachable_t::register_callback(this, pin);
+  pwm_reader_attachable_t() : pulse(0), pulse_real(0), edge_time(0), counter(0) {
+    self = this;
+    attachInterrupt(attachable::irq, pwm_reader_attachable_t::callback, CHANGE);
   }
 
+  pwm_reader_attachable_t(const pwm_reader_attachable_t&) = delete;            /**< Not copyable (registered by address) */
+  pwm_reader_attachable_t& operator=(const pwm_reader_attachable_t&) = delete; /**< Not copyable (registered by address) */
+
   /**
    * \brief Get current counter value
    * \return the  number of impulse passed by since last reset
@@ -320,99 +452,50 @@ class pwm_reader_attachable_t {
    * \brief Get the current pulse reading
    * \return the width of the last pulse since the last interrupt call
    */
-  inline pulse_t get_pulse() { return pulse; }
+  inline pulse_t get_pulse() { return pulse.read(); }
   /**
    * \brief Get the stabilized version of the pulse reading
-   * 
-   * Our application has a fast varying PWM signal to be read. In 
-   * order to have a better accuracy in reading the signal the class 
+   *
+   * Our application has a fast varying PWM signal to be read. In
+   * order to have a better accuracy in reading the signal the class
    * wait a certain ammount of time before giving the current value.
    * The waiting time is specified in terms of counts in \p DUTY_MODE_STABILIZER
-   * 
+   *
    * \return the width of the last pulse since the last interrupt call
    */
-  inline pulse_t get_pulse_real() { return pulse_real; }
+  inline pulse_t get_pulse_real() { return pulse_real.read(); }
 
   /** \brief Interrupt callback registered at pin creation
    *
    * This interrupt callback is registered for execution at object
    * construction. The callback reads the status of the pin and evaluates
    * the duration of the pwm pulse.
-   * 
-   * Since this kind of PWM are for fastly varying PWM signals, there is 
+   *
+   * Since this kind of PWM are for fastly varying PWM signals, there is
    * also some counter handling and reset.
    */
   void interrupt_callback() {
     uint16_t c_time = micros();
 
-    if (digitalRead(pin))
+    if (attachable::level())
       edge_time = c_time;
     else
-      pulse = c_time - edge_time;
+      pulse.write(c_time - edge_time);
 
-    if (abs(pulse_real - pulse) > DUTY_MODE_DELTA)
+    if (abs(int32_t(pulse_real.peek()) - int32_t(pulse.peek())) > DUTY_MODE_DELTA)
       counter++;
     else
       counter = 0;
 
     if (counter >= DUTY_MODE_STABILIZER) {
-      pulse_real = pulse;
+      pulse_real.write(pulse.peek());
       counter = 0;
     }
   }
 
  private:
-  /** \brief Register the callback for the current pin
-   * 
-   * This function stores the current \p pwm_reader_attachable_t instance to the
-   * static variable \p callbacks in order to actually call the interrup rooutine
-   * for the specific pin.
-   * The function only accepts the pin for which attachable interrupt
-   * is available, or it raise the \p interrupt_error.
-   * 
-   * \param self pointer to the instance of \p pwm_reader_attachable_t to be saved
-   * \param pin pin to be registered
-   * 
-   * \todo the \p pin can be removed, and \p self->pin used instead
-   */
-  static void register_callback(pwm_reader_attachable_t* self, pin_t pin) {
-    switch (pin) {
-      case (2):
-      case (3):
-      case (18):
-      case (19):
-      case (20):
-      case (21):
-        pwm_reader_attachable_t::pin_table[pwm_reader_attachable_t::pin_counter] = self;
-        attachInterrupt(digitalPinToInterrupt(pin),
-                        pwm_reader_attachable_t::callbacks[pwm_reader_attachable_t::pin_counter], CHANGE);
-        pwm_reader_attachable_t::pin_counter++;
-        break;
-      default:
-        pwm_reader_attachable_t::interrupt_error();
-        break;
-    }
-  }
-
-  /** \brief Alarm function */
-  static void interrupt_error() {
-    pinMode(ERROR_LED_PORT, OUTPUT);
-    digitalWrite(ERROR_LED_PORT, LOW);
-    while (1) {
-      digitalWrite(ERROR_LED_PORT, HIGH);
-      delay(2000);
-      digitalWrite(ERROR_LED_PORT, LOW);
-      delay(500);
-      digitalWrite(ERROR_LED_PORT, HIGH);
-      delay(500);
-      digitalWrite(ERROR_LED_PORT, LOW);
-      delay(500);
-      digitalWrite(ERROR_LED_PORT, HIGH);
-      delay(500);
-      digitalWrite(ERROR_LED_PORT, LOW);
-      delay(500);
-    }
-  }
+  /** \brief Callback attached to the external interrupt of the pin */
+  static void callback() { self->interrupt_callback(); }
 };
 
-#endif /* INTERRUPT_MANAGER_HPP */
\ No newline at end of file
+#endif /* INTERRUPT_MANAGER_HPP */
@@ -83,9 +83,9 @@
  */
 class radio_t {
   static radio_t * self; /**< The only instance of the radio_t class */
-  pwm_reader_t motor; /**< PWM reader for the trigger input */
-  pwm_reader_t steer; /**< PWM reader for the steer input */
-  pwm_reader_attachable_t mode; /**< PWM reader for the mode */
+  pwm_reader_t< TRACTION > motor; /**< PWM reader for the trigger input */
+  pwm_reader_t< STEERING > steer; /**< PWM reader for the steer input */
+  pwm_reader_attachable_t< MODE_PIN > mode; /**< PWM reader for the mode */
   erumby_mode_t curr_mode; /**< Current mode for the machine */
   erumby_base_t* m; /**< pointer to the erumby main instance */
 
@@ -11,9 +11,6 @@ radio_t * radio_t::create_radio(erumby_base_t * m_) {
 
 radio_t::radio_t(erumby_base_t* m_)
     : m(m_),
-      motor(pwm_reader_t(TRACTION)),
-      steer(pwm_reader_t(STEERING)),
-      mode(pwm_reader_attachable_t(MODE_PIN)),
       curr_mode(Secure) {
 #ifndef REMOTE_NOT_WORKING
   cmd_t motor_x[] = REMOTE_MOTOR_LUT_X;
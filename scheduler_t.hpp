@@ -0,0 +1,139 @@
+#ifndef SCHEDULER_T_HPP
+#define SCHEDULER_T_HPP
+
+/**
+ * \file scheduler_t.hpp
+ * \author Matteo Ragni
+ *
+ * **Multi rate scheduler for the real time loop**
+ *
+ * The real time loop runs at the base tick (\p LOOP_TIMING, see \p ticker_t),
+ * but not every module needs (or can use) the base rate. The scheduler
+ * groups the modules in rate groups: each task is registered with a
+ * period and a phase offset, both in base ticks, and it is executed only in
+ * the ticks where it is due. Phase offsets allow to spread tasks with the same
+ * period on different ticks, flattening the load of the loop.
+ *
+ * Each task has also a mask of the modes in which it runs, so that a
+ * single scheduler handles both the \p Auto and the \p Secure loop of \p erumby_t.
+ * The countdown of a task runs in every tick, regardless of the mode: a mode
+ * change never shifts the phase of a rate group.
+ *
+ * Usage example:
+ * @code
+ * scheduler_t< 4 > sched;
+ * sched.add([]() -> void { observer(); }, TASK_ALL, 1, 0);  // every tick
+ * sched.add([]() -> void { radio(); }, TASK_ALL, 5, 2);     // every 5 ticks, third tick
+ *
+ * void real_time_loop() {
+ *   sched.run(TASK_AUTO);
+ * }
+ * @endcode
+ *
+ * If \p PROFILER is defined, each task is a stage of \p profiler_t (the stage
+ * index is the registration index), and its name is the one given in \p add.
+ *
+ * \warning The tasks are executed in the order of registration. The
+ * scheduler does not preempt: the sum of the tasks due in the same tick must
+ * fit the base tick.
+ */
+
+#include <Arduino.h>
+#include "configurations.hpp"
+#include "profiler_t.hpp"
+#include "types.hpp"
+
+#define TASK_AUTO 0x01                      /**< Task runs in \p Auto mode */
+#define TASK_SECURE 0x02                    /**< Task runs in \p Secure (and \p Manual) mode */
+#define TASK_ALL (TASK_AUTO | TASK_SECURE)  /**< Task runs in every mode */
+
+typedef void (*task_t)(void); /**< Task callback type */
+
+/** \brief Multi rate scheduler for the real time loop
+ *
+ * The scheduler stores at most \p N tasks, without allocation. Each task
+ * is a callback with a period and a phase in base ticks. The scheduler
+ * does not use divisions (slow on AVR): each task has a countdown to its next
+ * activation.
+ *
+ * \tparam N maximum number of tasks
+ */
+template < size_t N >
+class scheduler_t {
+#ifdef PROFILER
+  static_assert(N < PROFILER_STAGES, "The profiler must have a stage for each task");
+#endif
+
+  /** \brief Entry of the task table */
+  typedef struct entry_t {
+    task_t task;         /**< Callback of the task */
+    uint8_t modes;       /**< Mask of the modes in which the task runs */
+    counter_t period;    /**< Period of the task in base ticks */
+    counter_t countdown; /**< Base ticks to the next activation */
+  } entry_t;
+
+  entry_t tasks[N]; /**< Task table */
+  size_t count;     /**< Number of registered tasks */
+
+ public:
+  /** \brief Empty constructor, no tasks */
+  scheduler_t() : count(0) {}
+
+  /** \brief Registers a task
+   *
+   * The task is executed for the first time in the tick \p phase (0 is the next
+   * tick), then every \p period ticks.
+   *
+   * \param task the callback of the task
+   * \param modes mask of the modes in which the task runs (\p TASK_AUTO, \p TASK_SECURE)
+   * \param period period of the task in base ticks (must be at least 1)
+   * \param phase phase offset in base ticks (must be less than \p period)
+   * \param name name of the task, for the profiler (a string literal)
+   * \return \p false if the table is full or the timing is not valid
+   */
+  bool add(task_t task, uint8_t modes, counter_t period, counter_t phase, const char* name = NULL) {
+    if ((count >= N) || (period == 0) || (phase >= period))
+      return false;
+    tasks[count].task = task;
+    tasks[count].modes = modes;
+    tasks[count].period = period;
+    tasks[count].countdown = phase;
+#ifdef PROFILER
+    profiler_t::name(count, name);
+#endif
+    count++;
+    return true;
+  }
+
+  /** \brief Executes the tasks due in the current tick
+   *
+   * Must be called exactly once per base tick.
+   *
+   * \param mode mask of the current mode (\p TASK_AUTO or \p TASK_SECURE)
+   */
+  void run(const uint8_t mode) {
+    for (size_t i = 0; i < count; i++) {
+      if (tasks[i].countdown == 0) {
+        tasks[i].countdown = tasks[i].period;
+        if (tasks[i].modes & mode) {
+#ifdef PROFILER
+          uint16_t t0 = profiler_t::start();
+          tasks[i].task();
+          profiler_t::stop(i, t0);
+#else
+          tasks[i].task();
+#endif
+        }
+      }
+      tasks[i].countdown--;
+    }
+  }
+
+  /**
+   * \brief Number of registered tasks
+   * \return the number of registered tasks
+   */
+  size_t size() const { return count; }
+};
+
+#endif /* SCHEDULER_T_HPP */
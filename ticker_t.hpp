@@ -0,0 +1,194 @@
+#ifndef TICKER_T_HPP
+#define TICKER_T_HPP
+
+/**
+ * \file ticker_t.hpp
+ * \author Matteo Ragni
+ *
+ * **Fixed rate tick for the real time loop**
+ *
+ * The class generates the tick of the real time loop with the hardware
+ * timer 3 of the Arduino Mega, configured in CTC mode (clear timer on compare).
+ * The timer raises an interrupt every \p LOOP_TIMING milliseconds, and the
+ * interrupt routine only counts the tick. The main \p loop polls the
+ * tick and executes \p erumby_t::loop when a tick is pending:
+ *
+ * @code
+ * void setup() {
+ *   ticker_t::init();
+ * }
+ *
+ * void loop() {
+ *   if (ticker_t::pending())
+ *     erumby->loop();
+ * }
+ * @endcode
+ *
+ * Since the period is generated by the hardware, the tick keeps a fixed phase
+ * regardless of how long each iteration takes: there is no drift, as it happens
+ * by polling \p micros (the overshoot of each iteration is never thrown away).
+ * This is what the discretization in \p high_gain_obs_t, \p pi_ctrl_t and
+ * \p smith_predictor_t assumes.
+ *
+ * When a tick is served, the class measures the **jitter**, that is the time between
+ * the compare match and the moment the loop starts. The jitter is read directly
+ * from the counter of the timer (\p TCNT3), thus it has the resolution of the
+ * timer (0.5 us with the prescaler at 8). The same counter is the free running
+ * time base of \p profiler_t, see \p ticker_t::count.
+ *
+ * The timer configuration, for a 16 MHz clock:
+ *
+ * | Register | Value                      | Description                          |
+ * |----------|----------------------------|--------------------------------------|
+ * | `TCCR3A` | `0`                        | Normal port operation                |
+ * | `TCCR3B` | `WGM32`, `CS31`            | CTC mode, prescaler 8 (0.5 us/count) |
+ * | `OCR3A`  | `TICKER_COUNTS - 1`        | 8000 counts for 4 ms                 |
+ * | `TIMSK3` | `OCIE3A`                   | Interrupt on compare match A         |
+ *
+ * At the end of each iteration, \p done checks for an **overrun**: if the next
+ * tick has already been raised, the iteration missed its deadline. The class
+ * counts the missed deadlines and the consecutive overruns. After
+ * \p OVERRUN_DEGRADE consecutive overruns the firmware enters a **degraded mode**,
+ * in which the actions selected in \p OVERRUN_ACTIONS are skipped, in order to
+ * recover the budget of the loop:
+ *
+ * | Action              | Effect in degraded mode                                  |
+ * |---------------------|----------------------------------------------------------|
+ * | `DEGRADE_TELEMETRY` | \p communication_t does not pack the wheel speeds        |
+ * | `DEGRADE_PROFILER`  | \p profiler_t does not print its report                  |
+ *
+ * The degraded mode is left after \p OVERRUN_RECOVER consecutive iterations on time.
+ *
+ * \warning Timer 1 is used by \p PWM.h for the ESC and servo pins, timer 0 by
+ * \p micros. Do not use timer 3 for anything else.
+ */
+
+#include <Arduino.h>
+#include "configurations.hpp"
+#include "types.hpp"
+
+#define TICKER_PRESCALER 8                                         /**< Prescaler of timer 3 */
+#define TICKER_COUNTS_PER_MS (F_CPU / (TICKER_PRESCALER * 1000L))  /**< Counts of the timer in a ms */
+#define TICKER_COUNTS (LOOP_TIMING * TICKER_COUNTS_PER_MS)         /**< Counts in a period */
+
+#define DEGRADE_TELEMETRY 0x01 /**< Degraded mode: skip the packing of the wheel speeds */
+#define DEGRADE_PROFILER 0x02  /**< Degraded mode: skip the report of the profiler */
+
+/** \brief Fixed rate tick for the real time loop
+ *
+ * The class generates the tick of the real time loop with the hardware
+ * timer 3 of the Arduino Mega, configured in CTC mode. The interrupt routine
+ * counts the raised ticks, while \p pending counts the served ticks and
+ * measures the jitter of the loop.
+ *
+ * The class is a static class, since there is only one real time loop.
+ */
+class ticker_t {
+  static volatile timing_t raised; /**< Ticks raised by the timer interrupt */
+  static timing_t served;          /**< Ticks served by the real time loop */
+  static timing_t jitter;          /**< Jitter of the last served tick (us) */
+  static timing_t jitter_max;      /**< Maximum jitter since the last reset (us) */
+  static timing_t missed;          /**< Number of iterations that missed the deadline */
+  static counter_t consecutive;    /**< Consecutive iterations that missed the deadline */
+  static counter_t on_time;        /**< Consecutive iterations on time (in degraded mode) */
+  static bool degraded_mode;       /**< The firmware is in degraded mode */
+
+ public:
+  /** \brief Configures timer 3 and starts the tick
+   *
+   * The counter is reset, thus the first tick is raised after
+   * \p LOOP_TIMING milliseconds.
+   */
+  static void init();
+
+  /** \brief Checks for a pending tick
+   *
+   * If a tick is pending, it is marked as served and the jitter
+   * is measured. If more than one tick is pending (the previous iteration took
+   * longer than the period), only the oldest one is served: the loop runs
+   * late, but it never skips the discretization step.
+   *
+   * A compare match whose interrupt routine has not run yet (its flag \p OCF3A
+   * is still set in \p TIFR3) is counted as a raised tick, otherwise the
+   * jitter would come out one period short.
+   *
+   * \return \p true if the real time loop must run
+   */
+  static bool pending();
+
+  /** \brief Marks the end of an iteration of the real time loop
+   *
+   * If the next tick has been already raised, the iteration has missed its
+   * deadline: the overrun counters are updated, and the degraded mode is
+   * entered after \p OVERRUN_DEGRADE consecutive overruns. The degraded mode is
+   * left after \p OVERRUN_RECOVER consecutive iterations on time.
+   */
+  static void done();
+
+  /** \brief Interrupt routine of the timer
+   *
+   * \warning Never use directly this function. It is registered in
+   * \p ticker_t.ino as:
+   * @code
+   * ISR(TIMER3_COMPA_vect) { ticker_t::isr(); }
+   * @endcode
+   */
+  static inline void isr() { raised++; }
+
+  /**
+   * \brief Ticks served by the real time loop
+   * \return the number of served ticks since the start
+   */
+  static timing_t get_ticks() { return served; }
+  /**
+   * \brief Jitter of the last served tick
+   * \return the time between the tick and the start of the loop (us)
+   */
+  static timing_t get_jitter() { return jitter; }
+  /**
+   * \brief Maximum jitter
+   * \return the maximum jitter since the last reset (us)
+   */
+  static timing_t get_jitter_max() { return jitter_max; }
+  /** \brief Resets the jitter statistics */
+  static void reset_jitter() { jitter_max = 0; }
+  /**
+   * \brief Missed deadlines
+   * \return the number of iterations that ended after the next tick
+   */
+  static timing_t get_missed() { return missed; }
+  /**
+   * \brief Consecutive overruns
+   * \return the number of consecutive iterations that missed the deadline
+   */
+  static counter_t get_consecutive() { return consecutive; }
+  /**
+   * \brief Checks if an action must be skipped for the degraded mode
+   * \param action the action (\p DEGRADE_TELEMETRY, \p DEGRADE_PROFILER)
+   * \return \p true if in degraded mode and the action is in \p OVERRUN_ACTIONS
+   */
+  static bool degraded(const uint8_t action) { return degraded_mode && (OVERRUN_ACTIONS & action); }
+  /**
+   * \brief Checks the degraded mode
+   * \return \p true if in degraded mode
+   */
+  static bool degraded() { return degraded_mode; }
+
+  /** \brief Current value of the timer counter
+   *
+   * The counter runs from 0 to \p TICKER_COUNTS - 1 in each period, with a
+   * resolution of 1 / \p TICKER_COUNTS_PER_MS ms. The difference of two reads
+   * in the same period (or in two consecutive periods, modulo \p TICKER_COUNTS)
+   * measures an interval of time without calling \p micros.
+   *
+   * \return the counter of timer 3
+   */
+  static inline uint16_t count() {
+    noInterrupts();
+    uint16_t c = TCNT3;
+    interrupts();
+    return c;
+  }
+};
+
+#endif /* TICKER_T_HPP */
@@ -0,0 +1,64 @@
+#include "ticker_t.hpp"
+
+volatile timing_t ticker_t::raised = 0;
+timing_t ticker_t::served = 0;
+timing_t ticker_t::jitter = 0;
+timing_t ticker_t::jitter_max = 0;
+timing_t ticker_t::missed = 0;
+counter_t ticker_t::consecutive = 0;
+counter_t ticker_t::on_time = 0;
+bool ticker_t::degraded_mode = false;
+
+void ticker_t::init() {
+  noInterrupts();
+  TCCR3A = 0;
+  TCCR3B = _BV(WGM32) | _BV(CS31);
+  OCR3A = TICKER_COUNTS - 1;
+  TCNT3 = 0;
+  TIMSK3 |= _BV(OCIE3A);
+  raised = 0;
+  served = 0;
+  interrupts();
+}
+
+bool ticker_t::pending() {
+  noInterrupts();
+  timing_t r = raised;
+  timing_t c = TCNT3;
+  // A compare match not yet served by the interrupt routine: if the counter has
+  // been read after it (small value) the tick is already raised, as in micros()
+  if ((TIFR3 & _BV(OCF3A)) && (c < TICKER_COUNTS / 2))
+    r++;
+  interrupts();
+
+  if (r == served)
+    return false;
+  jitter = (r - served - 1) * (LOOP_TIMING * 1000L) + (c * 1000L) / TICKER_COUNTS_PER_MS;
+  if (jitter > jitter_max)
+    jitter_max = jitter;
+  served++;
+  return true;
+}
+
+void ticker_t::done() {
+  noInterrupts();
+  timing_t r = raised;
+  if (TIFR3 & _BV(OCF3A))
+    r++;
+  interrupts();
+
+  if (r == served) {
+    consecutive = 0;
+    if (degraded_mode && (++on_time >= OVERRUN_RECOVER))
+      degraded_mode = false;
+    return;
+  }
+  missed++;
+  on_time = 0;
+  if (consecutive < 0xFF)
+    consecutive++;
+  if (consecutive >= OVERRUN_DEGRADE)
+    degraded_mode = true;
+}
+
+ISR(TIMER3_COMPA_vect) { ticker_t::isr(); }
@@ -0,0 +1,158 @@
+#ifndef TUNER_T_HPP
+#define TUNER_T_HPP
+
+/**
+ * \file tuner_t.hpp
+ * \author Matteo Ragni
+ *
+ * The class implements the identification of the model of the speed
+ * controller on the car (\p controller_t), and the tuning of the gains of its PI.
+ * It replaces the offline identification of the constants in \p configurations.hpp
+ * when the motor or the battery pack change.
+ *
+ * The experiment applies four steps of the control in open loop, each one
+ * for \p TUNE_SETTLE:
+ *
+ * | Phase | Control        | Measure                                                |
+ * |-------|----------------|--------------------------------------------------------|
+ * | 0     | \p TUNE_U_LOW  | \f$\omega_l\f$: mean speed on the last \p TUNE_AVERAGE |
+ * | 1     | \p TUNE_U_HIGH | \f$\omega_h\f$: mean speed on the last \p TUNE_AVERAGE |
+ * | 2     | \p TUNE_U_LOW  | (back to \f$\omega_l\f$)                               |
+ * | 3     | \p TUNE_U_HIGH | \f$t_{28}\f$, \f$t_{63}\f$: times of the step response |
+ *
+ * The model has unitary gain, thus at the steady state \f$x = u\f$ and the two
+ * points of the static map give the non linearity
+ * \f$u = \phi^{-1}(\omega) = c_1 \omega + c_2 \omega^2\f$:
+ *
+ * \f{align}
+ *   c_1 & = \frac{u_l \omega_h^2 - u_h \omega_l^2}{\omega_l \omega_h (\omega_h - \omega_l)}, &
+ *   c_2 & = \frac{u_h \omega_l - u_l \omega_h}{\omega_l \omega_h (\omega_h - \omega_l)}
+ * \f}
+ *
+ * In the last step the state crosses 28.3% and 63.2% of the step when the speed
+ * crosses \f$\phi(u_l + 0.283 (u_h - u_l))\f$ and \f$\phi(u_l + 0.632 (u_h - u_l))\f$,
+ * and the first order plus delay follows from the two points method:
+ *
+ * \f{align}
+ *   \tau & = 1.5 (t_{63} - t_{28}), & a & = 1 / \tau, & d & = t_{63} - \tau
+ * \f}
+ *
+ * where the times start when the control of the last step is applied, and they are
+ * interpolated between the steps of the controller (the delay is rounded to a step).
+ * With the delay compensated by the Smith predictor, the PI is tuned on the first order
+ * linearized at \f$\omega_m = (\omega_l + \omega_h) / 2\f$ (lambda tuning, with
+ * the closed loop time constant \f$\lambda\f$ = \p TUNE_LAMBDA):
+ *
+ * \f{align}
+ *   K & = \frac{1}{c_1 + 2 c_2 \omega_m}, & k_p & = \frac{\tau}{K \lambda}, & k_i & = \frac{1}{K \lambda}
+ * \f}
+ *
+ * The identification fails if the speeds are not increasing, if the response
+ * does not cross the two points, or if the model is not valid (\f$c_1, c_2 \le 0\f$).
+ * It fails also on the degenerate results: \f$\tau\f$ shorter than the two
+ * crossings can measure (\f$t_{63} - t_{28}\f$ less than a step of the controller),
+ * or longer than \p TUNE_SETTLE / 5 (the steps were not at steady state), a delay
+ * longer than \p CTRL_SYSTEM_DELAY_MAX, and gains (also not finite) out of a
+ * factor \p TUNE_GAIN_RANGE of the nominal ones.
+ *
+ * \warning The car moves in open loop during the experiment (up to the speed
+ * of \p TUNE_U_HIGH): it must be on a stand or on a free track.
+ */
+
+#include <Arduino.h>
+#include "configurations.hpp"
+#include "controller_t.hpp"
+#include "types.hpp"
+
+/** \brief Identification of the speed controller with steps of the control
+ *
+ * The class is a state machine that runs every \p CTRL_TIMING: it takes the
+ * measured speed and returns the control to apply to the ESC.
+ *
+ * Usage example:
+ * @code
+ * tuner_t tuner;
+ * tuner.start();
+ * while (tuner.state() == TuneRunning)
+ *   esc->ctrl(tuner(omega()));          // once for each step of the controller
+ * if (tuner.state() == TuneDone)
+ *   ctrl.install(tuner.params());
+ * @endcode
+ */
+class tuner_t {
+  static constexpr float ts = float(CTRL_TIMING) / 1000.0;     /**< Time step in seconds */
+  static constexpr timing_t settle = TUNE_SETTLE / CTRL_TIMING;  /**< Steps of a phase */
+  static constexpr timing_t average = TUNE_AVERAGE / CTRL_TIMING; /**< Steps of the mean speed */
+
+  static_assert(TUNE_AVERAGE > 0 && TUNE_AVERAGE < TUNE_SETTLE, "tuner_t: TUNE_AVERAGE must be in (0, TUNE_SETTLE)");
+  static_assert(TUNE_U_LOW > 0 && TUNE_U_LOW < TUNE_U_HIGH && TUNE_U_HIGH <= 1, "tuner_t: 0 < TUNE_U_LOW < TUNE_U_HIGH <= 1");
+
+  tune_state_t s;   /**< State of the identification */
+  uint8_t phase;    /**< Phase of the experiment */
+  timing_t k;       /**< Step in the phase */
+  float sum;        /**< Sum of the speeds in the window of the mean */
+  float omega_l;    /**< Mean speed with \p TUNE_U_LOW */
+  float omega_h;    /**< Mean speed with \p TUNE_U_HIGH */
+  float omega_prev; /**< Speed in the last step */
+  float omega_28;   /**< Speed at 28.3% of the step of the state */
+  float omega_63;   /**< Speed at 63.2% of the step of the state */
+  float t_28;       /**< Time of the crossing of \p omega_28 (negative before) */
+  float t_63;       /**< Time of the crossing of \p omega_63 (negative before) */
+  ctrl_params_t p;  /**< Identified parameters */
+
+  /** \brief Non linearity with the identified coefficients
+   * \param u input of the non linearity
+   * \return the speed
+   */
+  const float phi(const float u) const { return (sqrt(p.c1 * p.c1 + 4 * p.c2 * u) - p.c1) / (2 * p.c2); }
+
+  /** \brief Time of the crossing of a speed in the step response
+   *
+   * The time is interpolated between the last two steps.
+   *
+   * \param omega the current speed
+   * \param level the speed to cross
+   * \param t time of the crossing (negative if not crossed yet)
+   */
+  void cross(const float omega, const float level, float& t);
+
+  /** \brief End of the static map: the non linearity and the levels of the step response */
+  const bool nonlin();
+
+  /** \brief End of the experiment: the model and the gains */
+  const bool identify();
+
+ public:
+  /** \brief Empty constructor, the identification is idle */
+  tuner_t() : s(TuneIdle), p(ctrl_params_nominal()) {}
+
+  /** \brief Starts the experiment (from the first phase) */
+  void start();
+
+  /** \brief Stops the experiment, the identification is idle */
+  void reset() { s = TuneIdle; }
+
+  /** \brief Marks the identification as failed (e.g. the controller rejected the parameters) */
+  void fail() { s = TuneFailed; }
+
+  /** \brief Step of the experiment
+   *
+   * \param omega the measured speed
+   * \return the control to apply (zero if the experiment is not running)
+   */
+  const float operator()(const float omega);
+
+  /**
+   * \brief State of the identification
+   * \return the state
+   */
+  const tune_state_t state() const { return s; }
+
+  /**
+   * \brief The identified parameters
+   * \return the parameters (valid with \p TuneDone)
+   */
+  const ctrl_params_t& params() const { return p; }
+};
+
+#endif /* TUNER_T_HPP */
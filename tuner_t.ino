@@ -0,0 +1,83 @@
+#include "tuner_t.hpp"
+
+void tuner_t::start() {
+  s = TuneRunning;
+  phase = 0;
+  k = 0;
+  sum = 0;
+  omega_prev = 0;
+  t_28 = -1;
+  t_63 = -1;
+}
+
+const float tuner_t::operator()(const float omega) {
+  if (s != TuneRunning)
+    return 0;
+
+  if (k >= settle - average)
+    sum += omega;
+  if (phase == 3) {
+    cross(omega, omega_28, t_28);
+    cross(omega, omega_63, t_63);
+  }
+  omega_prev = omega;
+
+  if (++k == settle) {
+    if (phase == 0)
+      omega_l = sum / average;
+    if ((phase == 1) && !nonlin()) {
+      s = TuneFailed;
+      return 0;
+    }
+    if (phase == 3) {
+      s = identify() ? TuneDone : TuneFailed;
+      return 0;
+    }
+    phase++;
+    k = 0;
+    sum = 0;
+  }
+  return (phase & 0x01) ? TUNE_U_HIGH : TUNE_U_LOW;
+}
+
+void tuner_t::cross(const float omega, const float level, float& t) {
+  if ((t >= 0) || (omega < level))
+    return;
+  float f = (omega > omega_prev) ? (omega - level) / (omega - omega_prev) : 0;
+  t = ts * (float(k + 1) - f);
+}
+
+const bool tuner_t::nonlin() {
+  omega_h = sum / average;
+  if (!(omega_l > 0) || !(omega_h > omega_l))
+    return false;
+  float den = omega_l * omega_h * (omega_h - omega_l);
+  p.c1 = (TUNE_U_LOW * omega_h * omega_h - TUNE_U_HIGH * omega_l * omega_l) / den;
+  p.c2 = (TUNE_U_HIGH * omega_l - TUNE_U_LOW * omega_h) / den;
+  if (!(p.c1 > 0) || !(p.c2 > 0))
+    return false;
+  omega_28 = phi(TUNE_U_LOW + 0.283 * (TUNE_U_HIGH - TUNE_U_LOW));
+  omega_63 = phi(TUNE_U_LOW + 0.632 * (TUNE_U_HIGH - TUNE_U_LOW));
+  return true;
+}
+
+const bool tuner_t::identify() {
+  if ((t_28 < 0) || !(t_63 > t_28))
+    return false;
+  float tau = 1.5 * (t_63 - t_28);
+  float d = t_63 - tau;
+  float gain = 1 / (p.c1 + p.c2 * (omega_l + omega_h));  // K at (omega_l + omega_h) / 2
+  float lambda = float(TUNE_LAMBDA) / 1000.0;
+
+  // The crossings must be at least a step apart, and the steps must be at steady state
+  if (!(tau >= 1.5 * ts) || !(tau <= TUNE_SETTLE / 5000.0) || !(d <= CTRL_SYSTEM_DELAY_MAX / 1000.0))
+    return false;
+
+  p.a = 1 / tau;
+  p.delay = (d > 0) ? timing_t(d * 1000.0 / CTRL_TIMING + 0.5) * CTRL_TIMING : 0;
+  p.kp = tau / (gain * lambda);
+  p.ki = 1 / (gain * lambda);
+  // The comparisons are false also for the not finite gains
+  return (p.kp >= CTRL_KP / TUNE_GAIN_RANGE) && (p.kp <= CTRL_KP * TUNE_GAIN_RANGE) &&
+         (p.ki >= CTRL_KI / TUNE_GAIN_RANGE) && (p.ki <= CTRL_KI * TUNE_GAIN_RANGE);
+}
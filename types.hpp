@@ -11,6 +11,7 @@
  * defined in this file). This is a requirement of the compiler.
  */
 
+#include <stddef.h>
 #include <stdint.h>
 
 /** \brief Current machine mode. The mode is set by the \p radio_t class
@@ -49,15 +50,46 @@ typedef enum erumby_mode_t {
                is disabled as for now, since the remote traction and steer controls does not work. */
 } erumby_mode_t;
 
+/**
+ * \brief State of the identification of the speed controller
+ *
+ * \see tuner_t
+ */
+typedef enum tune_state_t {
+  TuneIdle,    /**< no identification since the last command of the Raspberry Pi */
+  TuneRunning, /**< the steps of the identification are running on the ESC */
+  TuneDone,    /**< the parameters are identified and installed in the controller */
+  TuneFailed   /**< the identification failed, the controller is not changed */
+} tune_state_t;
+
 typedef uint8_t pin_t;     /**< Pin type declaration (also used for map and ) */
 typedef uint16_t cmd_t;    /**< PWM command type declaration */
 typedef cmd_t pulse_t;     /**< PWM pulse type declaration */
 typedef cmd_t output_t;    /**< Output to i2c declaration */
 typedef int16_t input_t;   /**< Input from i2c declaration */
 typedef uint8_t counter_t; /**< PWM Counter type declaration */
+typedef uint16_t ticks_t;  /**< Free running counter of the encoder edges (wraps, take modular differences) */
+typedef int16_t steps_t;   /**< Free running counter of the encoder edges with direction (wraps, take modular differences) */
+typedef int32_t odometer_t; /**< Position of a wheel in encoder edges */
 typedef uint32_t timing_t; /**< tic/toc sync timers */
 typedef int16_t omega_t;   /**< types for angular speed in integer */
 
+/** \brief Sequence of indexes (as \p std::index_sequence, that is C++14)
+ *
+ * Used for filling the constant tables in the flash with the values
+ * evaluated by the compiler (e.g. \p hg_table_t).
+ */
+template < size_t... I >
+struct indices_t {};
+/** \brief Builds the sequence \f$0, \dots, K - 1\f$ in \p type */
+template < size_t K, size_t... I >
+struct make_indices_t : make_indices_t< K - 1, K - 1, I... > {};
+/** \brief Builds the sequence \f$0, \dots, K - 1\f$ in \p type (end of the recursion) */
+template < size_t... I >
+struct make_indices_t< 0, I... > {
+  typedef indices_t< I... > type; /**< The sequence */
+};
+
 /**
  * \brief Forward declaration for \p erumby_t
  * 
@@ -82,9 +114,13 @@ class erumby_base_t {
   virtual float omega_r() = 0;
   virtual float omega_l() = 0;
   virtual float omega() = 0;
+  virtual float variance_r() = 0;
+  virtual float variance_l() = 0;
   virtual const cmd_t traction() const = 0;
   virtual void traction(cmd_t v) = 0;
   virtual void speed(float v) = 0;
+  virtual void tune() = 0;
+  virtual tune_state_t tuning() = 0;
   virtual const cmd_t steer() const = 0;
   virtual void steer(cmd_t v) = 0;
   virtual void stop() = 0;